@@ -0,0 +1,306 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QString>
+
+#include <plog/Appenders/IAppender.h>
+#include <plog/Appenders/RollingFileAppender.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include <plog/Init.h>
+#include <plog/Record.h>
+#include <plog/Util.h>
+
+#ifdef _WIN32
+#include <plog/WinApi.h>
+#endif
+
+#include "fnd/NonCopyMovable.h"
+
+namespace HomeCompa::FliLib
+{
+
+// records are formatted on the calling thread and pushed into a bounded lock-free ring, a single writer thread hands them to the sink in batches
+template <typename Formatter, typename Sink>
+class AsyncAppender final : public plog::IAppender
+{
+	NON_COPY_MOVABLE(AsyncAppender)
+
+	struct Cell
+	{
+		std::atomic<size_t> sequence { 0 };
+		plog::util::nstring text;
+	};
+
+public:
+	static constexpr size_t CAPACITY       = 8192;
+	static constexpr size_t BATCH_SIZE     = 64 * 1024;
+	static constexpr auto   FLUSH_INTERVAL = std::chrono::milliseconds(50);
+
+public:
+	template <typename... Args>
+	explicit AsyncAppender(Args&&... args)
+		: m_sink(std::forward<Args>(args)...)
+		, m_cells(CAPACITY)
+		, m_mask { m_cells.size() - 1 }
+	{
+		static_assert(std::has_single_bit(CAPACITY));
+		for (size_t i = 0; i < m_cells.size(); ++i)
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+
+		m_thread = std::thread(&AsyncAppender::Run, this);
+	}
+
+	~AsyncAppender() override
+	{
+		{
+			std::lock_guard lock(m_guard);
+			m_stopped = true;
+		}
+		m_condition.notify_one();
+		m_thread.join();
+	}
+
+public: // plog::IAppender
+	void write(const plog::Record& record) override
+	{
+		auto text = Formatter::format(record);
+		while (!TryPush(text))
+		{
+			if (record.getSeverity() > Sink::BLOCK_SEVERITY)
+			{
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			m_condition.notify_one();
+			std::this_thread::yield();
+		}
+
+		if (m_enqueuePos.load(std::memory_order_relaxed) - m_dequeuePos.load(std::memory_order_relaxed) > m_mask / 2)
+			m_condition.notify_one();
+	}
+
+private:
+	bool TryPush(plog::util::nstring& text)
+	{
+		auto pos = m_enqueuePos.load(std::memory_order_relaxed);
+		while (true)
+		{
+			auto&      cell = m_cells[pos & m_mask];
+			const auto diff = static_cast<std::ptrdiff_t>(cell.sequence.load(std::memory_order_acquire) - pos);
+			if (diff < 0)
+				return false;
+
+			if (diff > 0)
+			{
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				cell.text = std::move(text);
+				cell.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+	}
+
+	bool TryPop(plog::util::nstring& text)
+	{
+		const auto pos  = m_dequeuePos.load(std::memory_order_relaxed);
+		auto&      cell = m_cells[pos & m_mask];
+		if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+			return false;
+
+		text = std::move(cell.text);
+		cell.sequence.store(pos + m_cells.size(), std::memory_order_release);
+		m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	void Run()
+	{
+		plog::util::nstring batch;
+		for (auto stopped = false; !stopped;)
+		{
+			{
+				std::unique_lock lock(m_guard);
+				m_condition.wait_for(lock, FLUSH_INTERVAL, [this] {
+					return m_stopped || m_enqueuePos.load(std::memory_order_relaxed) - m_dequeuePos.load(std::memory_order_relaxed) > m_mask / 2;
+				});
+				stopped = m_stopped;
+			}
+
+			Drain(batch);
+		}
+	}
+
+	void Drain(plog::util::nstring& batch)
+	{
+		plog::util::nstring text;
+		while (TryPop(text))
+		{
+			batch.append(text);
+			if (batch.size() >= BATCH_SIZE)
+				Write(batch);
+		}
+
+		if (const auto dropped = m_dropped.exchange(0, std::memory_order_relaxed))
+#ifdef _WIN32
+			batch.append(std::to_wstring(dropped)).append(L" log records dropped\n");
+#else
+			batch.append(std::to_string(dropped)).append(" log records dropped\n");
+#endif
+
+		Write(batch);
+	}
+
+	void Write(plog::util::nstring& batch)
+	{
+		if (batch.empty())
+			return;
+
+		m_sink.Write(batch);
+		batch.clear();
+	}
+
+private:
+	Sink                    m_sink;
+	std::vector<Cell>       m_cells;
+	const size_t            m_mask;
+	std::atomic<size_t>     m_enqueuePos { 0 };
+	std::atomic<size_t>     m_dequeuePos { 0 };
+	std::atomic<size_t>     m_dropped { 0 };
+	std::mutex              m_guard;
+	std::condition_variable m_condition;
+	bool                    m_stopped { false };
+	std::thread             m_thread;
+};
+
+class ConsoleSink
+{
+	NON_COPY_MOVABLE(ConsoleSink)
+
+public:
+	// a console may drop records below error when the ring is full
+	static constexpr auto BLOCK_SEVERITY = plog::error;
+
+public:
+	ConsoleSink()
+	{
+#ifdef _WIN32
+		if (_isatty(_fileno(stdout)))
+			m_console = plog::GetStdHandle(plog::stdHandle::kOutput);
+#endif
+	}
+
+	~ConsoleSink() = default;
+
+	void Write(const plog::util::nstring& batch) const
+	{
+#ifdef _WIN32
+		// a console gets wide text as plog::ConsoleAppender writes it, the ansi code page garbles cyrillic there
+		if (m_console)
+		{
+			plog::WriteConsoleW(m_console, batch.c_str(), static_cast<plog::DWORD>(batch.size()), nullptr, nullptr);
+			return;
+		}
+
+		const auto narrow = plog::util::toNarrow(batch, plog::codePage::kActive);
+		std::fwrite(narrow.data(), 1, narrow.size(), stdout);
+#else
+		std::fwrite(batch.data(), 1, batch.size(), stdout);
+#endif
+		std::fflush(stdout);
+	}
+
+#ifdef _WIN32
+private:
+	plog::HANDLE m_console { nullptr };
+#endif
+};
+
+class RollingFileSink
+{
+	NON_COPY_MOVABLE(RollingFileSink)
+
+	// the batch is already formatted, the appender only encodes, writes and rolls it
+	struct Preformatted
+	{
+		static plog::util::nstring header()
+		{
+			return {};
+		}
+
+		static plog::util::nstring format(const plog::Record& record)
+		{
+			return record.getMessage();
+		}
+	};
+
+public:
+	// the log file keeps every record, a full ring makes the callers wait
+	static constexpr auto BLOCK_SEVERITY = plog::verbose;
+	static constexpr auto MAX_FILE_SIZE  = size_t { 10 * 1024 * 1024 };
+	static constexpr auto MAX_FILES      = 5;
+
+public:
+	explicit RollingFileSink(const QString& fileName)
+		: m_appender(std::filesystem::path(fileName.toStdWString()).c_str(), MAX_FILE_SIZE, MAX_FILES)
+	{
+	}
+
+	~RollingFileSink() = default;
+
+	void Write(const plog::util::nstring& batch)
+	{
+		plog::Record record(plog::none, "", 0, "", nullptr, PLOG_DEFAULT_INSTANCE_ID);
+		record << batch;
+		m_appender.write(record);
+	}
+
+private:
+	plog::RollingFileAppender<Preformatted> m_appender;
+};
+
+template <typename Formatter>
+using AsyncConsoleAppender = AsyncAppender<Formatter, ConsoleSink>;
+
+template <typename Formatter>
+using AsyncFileAppender = AsyncAppender<Formatter, RollingFileSink>;
+
+// sets plog up with both sinks behind rings, so warning bursts from worker threads do not serialize on the file appender lock
+template <typename ConsoleFormatter>
+class AsyncLoggingInitializer
+{
+	NON_COPY_MOVABLE(AsyncLoggingInitializer)
+
+public:
+	explicit AsyncLoggingInitializer(const QString& fileName)
+		: m_file(fileName)
+	{
+		plog::init(plog::verbose, &m_file).addAppender(&m_console);
+	}
+
+	~AsyncLoggingInitializer()
+	{
+		plog::get()->setMaxSeverity(plog::none);
+	}
+
+private:
+	AsyncFileAppender<plog::TxtFormatter>  m_file;
+	AsyncConsoleAppender<ConsoleFormatter> m_console;
+};
+
+} // namespace HomeCompa::FliLib
@@ -0,0 +1,299 @@
+#include "BlobStore.h"
+
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <ranges>
+#include <unordered_map>
+#include <vector>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QtEndian>
+
+#include "ZipStreamWriter.h"
+#include "ZipTail.h"
+#include "log.h"
+#include "zip.h"
+
+using namespace HomeCompa::FliLib;
+
+namespace
+{
+
+constexpr char REFERENCE_PREFIX[] = "fliblob:";
+constexpr char PACK_PREFIX[]      = "pack";
+constexpr char PACK_EXTENSION[]   = ".zip";
+
+constexpr qsizetype REFERENCE_PREFIX_SIZE       = std::size(REFERENCE_PREFIX) - 1;
+constexpr qsizetype PACK_PREFIX_SIZE            = std::size(PACK_PREFIX) - 1;
+constexpr qsizetype PACK_EXTENSION_SIZE         = std::size(PACK_EXTENSION) - 1;
+constexpr qsizetype HASH_SIZE                   = 64;
+constexpr qint64    LOCAL_FILE_HEADER_SIZE      = 30;
+constexpr uint32_t  LOCAL_FILE_HEADER_SIGNATURE = 0x04034b50;
+constexpr uint16_t  METHOD_STORED               = 0;
+
+struct Location
+{
+	size_t   pack;
+	uint64_t offset;
+	uint64_t size;
+};
+
+using Files = std::vector<std::unique_ptr<QFile>>;
+
+} // namespace
+
+struct BlobStore::Impl
+{
+	const QDir dir;
+
+	mutable std::mutex                            guard;
+	mutable bool                                  loaded { false };
+	mutable QStringList                           packs;
+	mutable std::unordered_map<QString, Location> index;
+	mutable std::unordered_map<size_t, Files>     files;
+
+	std::unique_ptr<ZipStreamWriter>    writer;
+	QString                             writerPack;
+	std::unordered_map<QString, size_t> pending;
+	size_t                              pendingSize { 0 };
+
+	explicit Impl(const QString& folder)
+		: dir { folder }
+	{
+	}
+
+	bool Contains(const QString& hash) const
+	{
+		std::lock_guard lock(guard);
+		Load();
+		return index.contains(hash) || pending.contains(hash);
+	}
+
+	QByteArray Read(const QString& hash) const
+	{
+		Location               location {};
+		std::unique_ptr<QFile> file;
+		{
+			std::lock_guard lock(guard);
+			Load();
+
+			const auto it = index.find(hash);
+			if (it == index.end())
+				throw std::invalid_argument(QString("blob %1 not found in %2").arg(hash, dir.path()).toStdString());
+
+			location = it->second;
+			file     = AcquireFile(location.pack);
+		}
+
+		// the store is shared by all readers, so the blob is read outside the lock with a handle owned by this call
+		auto body = ReadBlob(*file, hash, location);
+
+		std::lock_guard lock(guard);
+		files[location.pack].push_back(std::move(file));
+		return body;
+	}
+
+	bool Add(const QString& hash, QByteArray body, const QDateTime& time)
+	{
+		std::lock_guard lock(guard);
+		Load();
+
+		if (index.contains(hash) || pending.contains(hash))
+			return false;
+
+		if (!writer)
+		{
+			if (!dir.exists() && !dir.mkpath("."))
+				throw std::ios_base::failure(QString("Cannot create %1").arg(dir.path()).toStdString());
+
+			writerPack = GetNextPackName();
+			writer     = std::make_unique<ZipStreamWriter>(dir.filePath(writerPack));
+		}
+
+		const auto size = static_cast<size_t>(body.size());
+		writer->Add(hash, std::move(body), time);
+		pending.try_emplace(hash, size);
+		pendingSize += size;
+		return true;
+	}
+
+	size_t GetPendingSize() const
+	{
+		std::lock_guard lock(guard);
+		return pendingSize;
+	}
+
+	size_t Flush()
+	{
+		std::lock_guard lock(guard);
+		if (!writer)
+			return 0;
+
+		const auto count = writer->Close();
+		writer.reset();
+		pending.clear();
+		pendingSize = 0;
+
+		AddPack(writerPack);
+		PLOGI << "pack " << writerPack << ": " << count << " blobs";
+		return count;
+	}
+
+private:
+	void Load() const
+	{
+		if (loaded)
+			return;
+
+		loaded = true;
+		for (const auto& pack : dir.entryList({ QString("%1*%2").arg(PACK_PREFIX, PACK_EXTENSION) }, QDir::Files, QDir::Name))
+			AddPack(pack);
+
+		PLOGD << dir.path() << ": " << packs.size() << " packs, " << index.size() << " blobs";
+	}
+
+	static QByteArray ReadBlob(QFile& file, const QString& hash, const Location& location)
+	{
+		const auto offset = location.offset;
+		const auto size   = location.size;
+		if (!file.seek(static_cast<qint64>(offset)))
+			throw std::ios_base::failure(QString("Cannot seek %1").arg(file.fileName()).toStdString());
+
+		const auto header = file.read(LOCAL_FILE_HEADER_SIZE);
+		if (header.size() != LOCAL_FILE_HEADER_SIZE || qFromLittleEndian<uint32_t>(header.constData()) != LOCAL_FILE_HEADER_SIGNATURE)
+			throw std::ios_base::failure(QString("%1: invalid local header of %2").arg(file.fileName(), hash).toStdString());
+		if (qFromLittleEndian<uint16_t>(header.constData() + 8) != METHOD_STORED)
+			throw std::ios_base::failure(QString("%1: %2 is compressed").arg(file.fileName(), hash).toStdString());
+
+		const auto dataOffset = static_cast<qint64>(offset) + LOCAL_FILE_HEADER_SIZE + qFromLittleEndian<uint16_t>(header.constData() + 26) + qFromLittleEndian<uint16_t>(header.constData() + 28);
+		if (!file.seek(dataOffset))
+			throw std::ios_base::failure(QString("Cannot seek %1").arg(file.fileName()).toStdString());
+
+		auto body = file.read(static_cast<qint64>(size));
+		if (static_cast<uint64_t>(body.size()) != size)
+			throw std::ios_base::failure(QString("%1: cannot read %2").arg(file.fileName(), hash).toStdString());
+
+		return body;
+	}
+
+	void AddPack(const QString& pack) const
+	{
+		const auto packIndex = static_cast<size_t>(packs.size());
+		const auto fileName  = dir.filePath(pack);
+		packs << pack;
+
+		for (auto& entry : ParseCentralDirectory(ReadCentralDirectory(fileName, ReadZipTail(fileName))))
+			index.try_emplace(std::move(entry.fileName), packIndex, entry.offset, entry.size);
+	}
+
+	std::unique_ptr<QFile> AcquireFile(const size_t pack) const
+	{
+		if (auto& idle = files[pack]; !idle.empty())
+		{
+			auto file = std::move(idle.back());
+			idle.pop_back();
+			return file;
+		}
+
+		auto file = std::make_unique<QFile>(dir.filePath(packs[static_cast<qsizetype>(pack)]));
+		if (!file->open(QIODevice::ReadOnly))
+			throw std::ios_base::failure(QString("Cannot open %1").arg(file->fileName()).toStdString());
+
+		return file;
+	}
+
+	QString GetNextPackName() const
+	{
+		int number = 0;
+		for (const auto& pack : packs)
+			number = std::max(number, pack.mid(PACK_PREFIX_SIZE, pack.size() - PACK_PREFIX_SIZE - PACK_EXTENSION_SIZE).toInt() + 1);
+
+		return QString("%1%2%3").arg(PACK_PREFIX).arg(number, 6, 10, QChar('0')).arg(PACK_EXTENSION);
+	}
+};
+
+QString BlobStore::GetFolder(const QString& imageArchive)
+{
+	return QDir::cleanPath(QString("%1/../%2").arg(QFileInfo(imageArchive).absolutePath(), FOLDER));
+}
+
+std::shared_ptr<BlobStore> BlobStore::Open(const QString& folder)
+{
+	static std::mutex                                            guard;
+	static std::unordered_map<QString, std::weak_ptr<BlobStore>> stores;
+
+	std::lock_guard lock(guard);
+	auto&           store = stores[QDir(folder).absolutePath()];
+	if (auto result = store.lock())
+		return result;
+
+	auto result = std::make_shared<BlobStore>(folder);
+	store       = result;
+	return result;
+}
+
+QString BlobStore::GetHash(const QByteArray& body)
+{
+	return QString::fromUtf8(QCryptographicHash::hash(body, QCryptographicHash::Sha256).toHex());
+}
+
+QByteArray BlobStore::CreateReference(const QString& hash)
+{
+	return REFERENCE_PREFIX + hash.toLatin1();
+}
+
+QString BlobStore::ParseReference(const QByteArray& body)
+{
+	return body.size() == REFERENCE_PREFIX_SIZE + HASH_SIZE && body.startsWith(REFERENCE_PREFIX) ? QString::fromLatin1(body.mid(REFERENCE_PREFIX_SIZE)) : QString {};
+}
+
+bool BlobStore::HasReferences(const QString& imageArchive)
+{
+	// only entries of the reference size are read, so an archive of plain images is checked by its central directory alone
+	auto candidates = ParseCentralDirectory(ReadCentralDirectory(imageArchive, ReadZipTail(imageArchive))) | std::views::filter([](const ZipEntry& entry) {
+						  return entry.size == static_cast<uint64_t>(REFERENCE_PREFIX_SIZE + HASH_SIZE);
+					  })
+	                | std::ranges::to<std::vector<ZipEntry>>();
+	if (candidates.empty())
+		return false;
+
+	const Zip zip(imageArchive);
+	return std::ranges::any_of(candidates, [&](const ZipEntry& entry) {
+		return !ParseReference(zip.Read(entry.fileName)->GetStream().readAll()).isEmpty();
+	});
+}
+
+BlobStore::BlobStore(const QString& folder)
+	: m_impl { std::make_unique<Impl>(folder) }
+{
+}
+
+BlobStore::~BlobStore() = default;
+
+bool BlobStore::Contains(const QString& hash) const
+{
+	return m_impl->Contains(hash);
+}
+
+QByteArray BlobStore::Read(const QString& hash) const
+{
+	return m_impl->Read(hash);
+}
+
+bool BlobStore::Add(const QString& hash, QByteArray body, const QDateTime& time)
+{
+	return m_impl->Add(hash, std::move(body), time);
+}
+
+size_t BlobStore::GetPendingSize() const
+{
+	return m_impl->GetPendingSize();
+}
+
+size_t BlobStore::Flush()
+{
+	return m_impl->Flush();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+
+#include "fnd/NonCopyMovable.h"
+
+#include "export/lib.h"
+
+namespace HomeCompa::FliLib
+{
+
+class LIB_EXPORT BlobStore
+{
+	NON_COPY_MOVABLE(BlobStore)
+
+public:
+	static constexpr auto FOLDER = "blobs";
+
+	static QString                    GetFolder(const QString& imageArchive);
+	static std::shared_ptr<BlobStore> Open(const QString& folder);
+
+	static QString    GetHash(const QByteArray& body);
+	static QByteArray CreateReference(const QString& hash);
+	static QString    ParseReference(const QByteArray& body);
+	static bool       HasReferences(const QString& imageArchive);
+
+public:
+	explicit BlobStore(const QString& folder);
+	~BlobStore();
+
+public:
+	bool       Contains(const QString& hash) const;
+	QByteArray Read(const QString& hash) const;
+
+	bool   Add(const QString& hash, QByteArray body, const QDateTime& time = {});
+	size_t GetPendingSize() const;
+	size_t Flush();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace HomeCompa::FliLib
@@ -0,0 +1,55 @@
+#include "ImageArchive.h"
+
+#include "BlobStore.h"
+#include "zip.h"
+
+using namespace HomeCompa::FliLib;
+
+struct ImageArchive::Impl
+{
+	const QString fileName;
+	const Zip     zip;
+
+	mutable std::shared_ptr<BlobStore> blobStore;
+
+	explicit Impl(QString fileName_)
+		: fileName { std::move(fileName_) }
+		, zip { fileName }
+	{
+	}
+
+	QByteArray Read(const QString& imageFile) const
+	{
+		auto       body = zip.Read(imageFile)->GetStream().readAll();
+		const auto hash = BlobStore::ParseReference(body);
+		if (hash.isEmpty())
+			return body;
+
+		if (!blobStore)
+			blobStore = BlobStore::Open(BlobStore::GetFolder(fileName));
+
+		return blobStore->Read(hash);
+	}
+};
+
+ImageArchive::ImageArchive(QString fileName)
+	: m_impl { std::make_unique<Impl>(std::move(fileName)) }
+{
+}
+
+ImageArchive::~ImageArchive() = default;
+
+QStringList ImageArchive::GetFileNameList() const
+{
+	return m_impl->zip.GetFileNameList();
+}
+
+QDateTime ImageArchive::GetFileTime(const QString& fileName) const
+{
+	return m_impl->zip.GetFileTime(fileName);
+}
+
+QByteArray ImageArchive::Read(const QString& fileName) const
+{
+	return m_impl->Read(fileName);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory>
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QStringList>
+
+#include "fnd/NonCopyMovable.h"
+
+#include "export/lib.h"
+
+namespace HomeCompa::FliLib
+{
+
+class LIB_EXPORT ImageArchive
+{
+	NON_COPY_MOVABLE(ImageArchive)
+
+public:
+	explicit ImageArchive(QString fileName);
+	~ImageArchive();
+
+public:
+	QStringList GetFileNameList() const;
+	QDateTime   GetFileTime(const QString& fileName) const;
+	QByteArray  Read(const QString& fileName) const;
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace HomeCompa::FliLib
@@ -0,0 +1,349 @@
+#include "ImageScaler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define FLILIB_SCALER_X86
+	#include <immintrin.h>
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+		#define FLILIB_TARGET_AVX2
+	#else
+		#define FLILIB_TARGET_AVX2 __attribute__((target("avx2,fma")))
+	#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	#define FLILIB_SCALER_NEON
+	#include <arm_neon.h>
+#endif
+
+namespace HomeCompa::FliLib
+{
+
+namespace
+{
+
+struct Contributions
+{
+	std::vector<int>   start;
+	std::vector<int>   count;
+	std::vector<float> weights;
+	int                stride { 0 };
+	int                maxCount { 0 };
+};
+
+double Sinc(double x)
+{
+	if (x == 0.0)
+		return 1.0;
+
+	x *= std::numbers::pi;
+	return std::sin(x) / x;
+}
+
+double Lanczos3(const double x)
+{
+	return x > -3.0 && x < 3.0 ? Sinc(x) * Sinc(x / 3.0) : 0.0;
+}
+
+double Box(const double x)
+{
+	return x >= -0.5 && x < 0.5 ? 1.0 : 0.0;
+}
+
+Contributions GetContributions(const int srcSize, const int dstSize, const ScaleFilter filter)
+{
+	const auto [function, radius] = filter == ScaleFilter::Area ? std::make_pair(&Box, 0.5) : std::make_pair(&Lanczos3, 3.0);
+
+	const auto scale       = static_cast<double>(srcSize) / dstSize;
+	const auto filterScale = std::max(scale, 1.0);
+	const auto support     = radius * filterScale;
+
+	Contributions result;
+	result.stride = static_cast<int>(std::ceil(support)) * 2 + 1;
+	result.start.resize(static_cast<size_t>(dstSize));
+	result.count.resize(static_cast<size_t>(dstSize));
+	result.weights.resize(static_cast<size_t>(dstSize) * static_cast<size_t>(result.stride));
+
+	std::vector<double> weights(static_cast<size_t>(result.stride));
+	for (int i = 0; i < dstSize; ++i)
+	{
+		const auto center = (i + 0.5) * scale;
+		const auto first  = std::max(static_cast<int>(center - support + 0.5), 0);
+		const auto last   = std::min(static_cast<int>(center + support + 0.5), srcSize);
+		const auto count  = std::min(last - first, result.stride);
+
+		double sum = 0.0;
+		for (int k = 0; k < count; ++k)
+			sum += weights[static_cast<size_t>(k)] = function((k + first - center + 0.5) / filterScale);
+
+		auto* dst = result.weights.data() + static_cast<size_t>(i) * static_cast<size_t>(result.stride);
+		for (int k = 0; k < count; ++k)
+			dst[k] = static_cast<float>(sum == 0.0 ? 0.0 : weights[static_cast<size_t>(k)] / sum);
+
+		result.start[static_cast<size_t>(i)] = first;
+		result.count[static_cast<size_t>(i)] = count;
+		result.maxCount                      = std::max(result.maxCount, count);
+	}
+
+	return result;
+}
+
+void HorizontalGray(const float* src, float* dst, const Contributions& contributions)
+{
+	for (size_t x = 0, sz = contributions.start.size(); x < sz; ++x)
+	{
+		const auto* weights = contributions.weights.data() + x * static_cast<size_t>(contributions.stride);
+		const auto* pixels  = src + contributions.start[x];
+
+		float acc = 0.0f;
+		for (int k = 0, count = contributions.count[x]; k < count; ++k)
+			acc += weights[k] * pixels[k];
+		dst[x] = acc;
+	}
+}
+
+void HorizontalRgba(const float* src, float* dst, const Contributions& contributions)
+{
+	for (size_t x = 0, sz = contributions.start.size(); x < sz; ++x)
+	{
+		const auto* weights = contributions.weights.data() + x * static_cast<size_t>(contributions.stride);
+		const auto* pixels  = src + static_cast<size_t>(contributions.start[x]) * 4;
+		const auto  count   = contributions.count[x];
+
+#if defined(FLILIB_SCALER_X86)
+		auto acc = _mm_setzero_ps();
+		for (int k = 0; k < count; ++k)
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(pixels + static_cast<ptrdiff_t>(k) * 4)));
+		_mm_storeu_ps(dst + x * 4, acc);
+#elif defined(FLILIB_SCALER_NEON)
+		auto acc = vdupq_n_f32(0.0f);
+		for (int k = 0; k < count; ++k)
+			acc = vmlaq_n_f32(acc, vld1q_f32(pixels + static_cast<ptrdiff_t>(k) * 4), weights[k]);
+		vst1q_f32(dst + x * 4, acc);
+#else
+		float acc[4] {};
+		for (int k = 0; k < count; ++k)
+			for (int c = 0; c < 4; ++c)
+				acc[c] += weights[k] * pixels[k * 4 + c];
+		std::copy(std::begin(acc), std::end(acc), dst + x * 4);
+#endif
+	}
+}
+
+void AxpyScalar(float* acc, const float* src, const float weight, const size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		acc[i] += weight * src[i];
+}
+
+#if defined(FLILIB_SCALER_X86)
+
+void AxpySse(float* acc, const float* src, const float weight, const size_t n)
+{
+	const auto w = _mm_set1_ps(weight);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(w, _mm_loadu_ps(src + i))));
+
+	AxpyScalar(acc + i, src + i, weight, n - i);
+}
+
+FLILIB_TARGET_AVX2 void AxpyAvx2(float* acc, const float* src, const float weight, const size_t n)
+{
+	const auto w = _mm256_set1_ps(weight);
+
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		_mm256_storeu_ps(acc + i, _mm256_fmadd_ps(w, _mm256_loadu_ps(src + i), _mm256_loadu_ps(acc + i)));
+		_mm256_storeu_ps(acc + i + 8, _mm256_fmadd_ps(w, _mm256_loadu_ps(src + i + 8), _mm256_loadu_ps(acc + i + 8)));
+	}
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(acc + i, _mm256_fmadd_ps(w, _mm256_loadu_ps(src + i), _mm256_loadu_ps(acc + i)));
+
+	AxpyScalar(acc + i, src + i, weight, n - i);
+}
+
+bool HasAvx2()
+{
+	#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4] {};
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	__cpuid(info, 1);
+	const bool fma     = (info[2] & (1 << 12)) != 0;
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!fma || !osxsave || (_xgetbv(0) & 0x6) != 0x6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+	#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	#endif
+}
+
+#elif defined(FLILIB_SCALER_NEON)
+
+void AxpyNeon(float* acc, const float* src, const float weight, const size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		vst1q_f32(acc + i, vmlaq_n_f32(vld1q_f32(acc + i), vld1q_f32(src + i), weight));
+		vst1q_f32(acc + i + 4, vmlaq_n_f32(vld1q_f32(acc + i + 4), vld1q_f32(src + i + 4), weight));
+	}
+	for (; i + 4 <= n; i += 4)
+		vst1q_f32(acc + i, vmlaq_n_f32(vld1q_f32(acc + i), vld1q_f32(src + i), weight));
+
+	AxpyScalar(acc + i, src + i, weight, n - i);
+}
+
+#endif
+
+using Axpy = void (*)(float* acc, const float* src, float weight, size_t n);
+
+Axpy GetAxpy()
+{
+#if defined(FLILIB_SCALER_X86)
+	static const Axpy axpy = HasAvx2() ? &AxpyAvx2 : &AxpySse;
+	return axpy;
+#elif defined(FLILIB_SCALER_NEON)
+	return &AxpyNeon;
+#else
+	return &AxpyScalar;
+#endif
+}
+
+void LoadGray(const uchar* src, float* dst, const int width)
+{
+	for (int x = 0; x < width; ++x)
+		dst[x] = src[x];
+}
+
+void LoadRgba(const uchar* src, float* dst, const int width, const bool hasAlpha)
+{
+	const auto* pixels = reinterpret_cast<const QRgb*>(src);
+	for (int x = 0; x < width; ++x, dst += 4)
+	{
+		const auto pixel = pixels[x];
+		const auto alpha = hasAlpha ? static_cast<float>(qAlpha(pixel)) : 255.0f;
+		const auto ratio = alpha / 255.0f;
+
+		dst[0] = static_cast<float>(qRed(pixel)) * ratio;
+		dst[1] = static_cast<float>(qGreen(pixel)) * ratio;
+		dst[2] = static_cast<float>(qBlue(pixel)) * ratio;
+		dst[3] = alpha;
+	}
+}
+
+int ToByte(const float value)
+{
+	return static_cast<int>(std::clamp(value, 0.0f, 255.0f) + 0.5f);
+}
+
+void StoreGray(const float* src, uchar* dst, const int width)
+{
+	for (int x = 0; x < width; ++x)
+		dst[x] = static_cast<uchar>(ToByte(src[x]));
+}
+
+void StoreRgba(const float* src, uchar* dst, const int width, const bool hasAlpha)
+{
+	auto* pixels = reinterpret_cast<QRgb*>(dst);
+	for (int x = 0; x < width; ++x, src += 4)
+	{
+		if (!hasAlpha)
+		{
+			pixels[x] = qRgb(ToByte(src[0]), ToByte(src[1]), ToByte(src[2]));
+			continue;
+		}
+
+		const auto alpha = ToByte(src[3]);
+		if (alpha == 0)
+		{
+			pixels[x] = qRgba(0, 0, 0, 0);
+			continue;
+		}
+
+		const auto ratio = 255.0f / std::clamp(src[3], 1.0f, 255.0f);
+		pixels[x]        = qRgba(ToByte(src[0] * ratio), ToByte(src[1] * ratio), ToByte(src[2] * ratio), alpha);
+	}
+}
+
+} // namespace
+
+QImage Scale(const QImage& image, const QSize& size, const ScaleFilter filter)
+{
+	if (image.isNull() || size.isEmpty() || image.size() == size)
+		return image;
+
+	const auto pixelFormat = image.pixelFormat();
+	const bool hasAlpha    = pixelFormat.alphaUsage() == QPixelFormat::UsesAlpha;
+	const bool grayScale   = !hasAlpha && pixelFormat.colorModel() == QPixelFormat::Grayscale;
+	const auto format      = grayScale ? QImage::Format_Grayscale8 : hasAlpha ? QImage::Format_ARGB32 : QImage::Format_RGB32;
+	const auto channels    = grayScale ? 1 : 4;
+
+	const auto src = image.convertToFormat(format);
+	QImage     dst(size, format);
+	if (dst.isNull())
+		return {};
+
+	const auto horizontal = GetContributions(src.width(), size.width(), filter);
+	const auto vertical   = GetContributions(src.height(), size.height(), filter);
+	const auto axpy       = GetAxpy();
+
+	const auto srcRowSize = static_cast<size_t>(src.width()) * channels;
+	const auto dstRowSize = static_cast<size_t>(size.width()) * channels;
+	const auto ringSize   = static_cast<size_t>(std::max(vertical.maxCount, 1));
+
+	std::vector<float> srcRow(srcRowSize);
+	std::vector<float> ring(ringSize * dstRowSize);
+	std::vector<float> dstRow(dstRowSize);
+
+	int nextRow = 0;
+	for (int y = 0; y < size.height(); ++y)
+	{
+		const auto first = vertical.start[static_cast<size_t>(y)];
+		const auto count = vertical.count[static_cast<size_t>(y)];
+
+		for (; nextRow < first + count; ++nextRow)
+		{
+			auto* row = ring.data() + static_cast<size_t>(nextRow) % ringSize * dstRowSize;
+			if (grayScale)
+			{
+				LoadGray(src.constScanLine(nextRow), srcRow.data(), src.width());
+				HorizontalGray(srcRow.data(), row, horizontal);
+			}
+			else
+			{
+				LoadRgba(src.constScanLine(nextRow), srcRow.data(), src.width(), hasAlpha);
+				HorizontalRgba(srcRow.data(), row, horizontal);
+			}
+		}
+
+		std::ranges::fill(dstRow, 0.0f);
+		const auto* weights = vertical.weights.data() + static_cast<size_t>(y) * static_cast<size_t>(vertical.stride);
+		for (int k = 0; k < count; ++k)
+			axpy(dstRow.data(), ring.data() + static_cast<size_t>(first + k) % ringSize * dstRowSize, weights[k], dstRowSize);
+
+		if (grayScale)
+			StoreGray(dstRow.data(), dst.scanLine(y), size.width());
+		else
+			StoreRgba(dstRow.data(), dst.scanLine(y), size.width(), hasAlpha);
+	}
+
+	dst.setDotsPerMeterX(image.dotsPerMeterX());
+	dst.setDotsPerMeterY(image.dotsPerMeterY());
+
+	return dst;
+}
+
+} // namespace HomeCompa::FliLib
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QImage>
+#include <QSize>
+
+#include "export/lib.h"
+
+namespace HomeCompa::FliLib
+{
+
+enum class ScaleFilter
+{
+	Lanczos3,
+	Area,
+};
+
+LIB_EXPORT QImage Scale(const QImage& image, const QSize& size, ScaleFilter filter = ScaleFilter::Lanczos3);
+
+}
@@ -0,0 +1,266 @@
+#include "Metrics.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include "log.h"
+
+using namespace HomeCompa::FliLib;
+
+namespace
+{
+
+constexpr auto METRICS = "metrics";
+
+struct Registry
+{
+	std::atomic_bool                             enabled { false };
+	std::mutex                                   guard;
+	std::vector<std::shared_ptr<ProgressMetric>> metrics;
+};
+
+Registry& GetRegistry()
+{
+	static Registry registry;
+	return registry;
+}
+
+struct Sample
+{
+	size_t                                count { 0 };
+	size_t                                bytes { 0 };
+	std::chrono::steady_clock::time_point time;
+};
+
+struct Row
+{
+	size_t  id;
+	QString stage;
+	double  total;
+	double  count;
+	double  bytes;
+	double  errors;
+	double  elapsed;
+	double  itemsPerSecond;
+	double  bytesPerSecond;
+	double  eta;
+	double  finished;
+};
+
+struct PrometheusMetric
+{
+	const char*  name;
+	const char*  type;
+	const char*  help;
+	double Row::*value;
+};
+
+constexpr PrometheusMetric PROMETHEUS_METRICS[] {
+	{      "items_total", "counter",                                  "Items processed",          &Row::count },
+	{   "items_expected",   "gauge",                                   "Items expected",          &Row::total },
+	{      "bytes_total", "counter",                                  "Bytes processed",          &Row::bytes },
+	{     "errors_total", "counter",                                     "Items failed",         &Row::errors },
+	{ "items_per_second",   "gauge", "Items per second since the previous publication", &Row::itemsPerSecond },
+	{ "bytes_per_second",   "gauge", "Bytes per second since the previous publication", &Row::bytesPerSecond },
+	{  "elapsed_seconds",   "gauge",                   "Seconds since the stage started",        &Row::elapsed },
+	{      "eta_seconds",   "gauge",                           "Estimated seconds left",            &Row::eta },
+	{         "finished",   "gauge",                                "Stage is finished",       &Row::finished },
+};
+
+QString EscapeLabel(QString value)
+{
+	return value.replace('\\', R"(\\)").replace('"', R"(\")").replace('\n', R"(\n)");
+}
+
+QByteArray ToPrometheus(const std::vector<Row>& rows)
+{
+	const auto tool = EscapeLabel(QCoreApplication::applicationName());
+
+	QByteArray result;
+	for (const auto& [name, type, help, value] : PROMETHEUS_METRICS)
+	{
+		result.append(QString("# HELP fli_progress_%1 %2\n# TYPE fli_progress_%1 %3\n").arg(name, help, type).toUtf8());
+		for (const auto& row : rows)
+			if (row.*value >= 0)
+				result.append(QString(R"(fli_progress_%1{tool="%2",id="%3",stage="%4"} %5)").arg(name, tool).arg(row.id).arg(EscapeLabel(row.stage)).arg(row.*value, 0, 'f', 3).toUtf8()).append('\n');
+	}
+
+	return result;
+}
+
+QByteArray ToJson(const std::vector<Row>& rows)
+{
+	QJsonArray stages;
+	for (const auto& row : rows)
+	{
+		QJsonObject stage {
+			{ "id", static_cast<qint64>(row.id) },
+			{ "stage", row.stage },
+			{ "total", static_cast<qint64>(row.total) },
+			{ "count", static_cast<qint64>(row.count) },
+			{ "bytes", static_cast<qint64>(row.bytes) },
+			{ "errors", static_cast<qint64>(row.errors) },
+			{ "elapsed", row.elapsed },
+			{ "itemsPerSecond", row.itemsPerSecond },
+			{ "bytesPerSecond", row.bytesPerSecond },
+			{ "finished", row.finished > 0 },
+		};
+		if (row.eta >= 0)
+			stage.insert("eta", row.eta);
+		stages.append(stage);
+	}
+
+	return QJsonDocument(QJsonObject {
+							 { "tool", QCoreApplication::applicationName() },
+							 { "pid", QCoreApplication::applicationPid() },
+							 { "timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate) },
+							 { "stages", stages },
+						 })
+	    .toJson();
+}
+
+} // namespace
+
+struct MetricsPublisher::Impl
+{
+	const QString                   fileName;
+	const bool                      json;
+	const std::chrono::milliseconds interval;
+
+	std::mutex                                        guard;
+	std::condition_variable                           condition;
+	bool                                              stopped { false };
+	bool                                              failed { false };
+	std::unordered_map<const ProgressMetric*, Sample> samples;
+	std::thread                                       thread;
+
+	Impl(QString fileName_, const std::chrono::milliseconds interval_)
+		: fileName { std::move(fileName_) }
+		, json { fileName.endsWith(".json", Qt::CaseInsensitive) }
+		, interval { interval_ }
+	{
+		if (fileName.isEmpty())
+			return;
+
+		GetRegistry().enabled = true;
+		thread                = std::thread(&Impl::Run, this);
+	}
+
+	~Impl()
+	{
+		if (fileName.isEmpty())
+			return;
+
+		{
+			std::lock_guard lock(guard);
+			stopped = true;
+		}
+		condition.notify_all();
+		thread.join();
+
+		Publish();
+		GetRegistry().enabled = false;
+	}
+
+	void Run()
+	{
+		std::unique_lock lock(guard);
+		while (!condition.wait_for(lock, interval, [this] {
+			return stopped;
+		}))
+		{
+			lock.unlock();
+			Publish();
+			lock.lock();
+		}
+	}
+
+	void Publish()
+	{
+		std::vector<std::shared_ptr<ProgressMetric>> metrics;
+		{
+			auto&           registry = GetRegistry();
+			std::lock_guard lock(registry.guard);
+			metrics = registry.metrics;
+		}
+
+		const auto       now = std::chrono::steady_clock::now();
+		std::vector<Row> rows;
+		rows.reserve(metrics.size());
+		for (size_t id = 0; id < metrics.size(); ++id)
+		{
+			const auto& metric   = *metrics[id];
+			const auto  count    = metric.count.load(std::memory_order_relaxed);
+			const auto  bytes    = metric.bytes.load(std::memory_order_relaxed);
+			const auto  finished = metric.finished.load(std::memory_order_relaxed);
+			const auto  elapsed  = std::chrono::duration<double>(now - metric.start).count();
+
+			auto&      sample = samples.try_emplace(&metric, Sample { .time = metric.start }).first->second;
+			const auto span   = std::chrono::duration<double>(now - sample.time).count();
+
+			auto& row          = rows.emplace_back(id, QString::fromStdString(metric.name));
+			row.total          = static_cast<double>(metric.total);
+			row.count          = static_cast<double>(count);
+			row.bytes          = static_cast<double>(bytes);
+			row.errors         = static_cast<double>(metric.errors.load(std::memory_order_relaxed));
+			row.elapsed        = elapsed;
+			row.itemsPerSecond = span > 0 ? static_cast<double>(count - sample.count) / span : 0.0;
+			row.bytesPerSecond = span > 0 ? static_cast<double>(bytes - sample.bytes) / span : 0.0;
+			row.finished       = finished ? 1.0 : 0.0;
+			row.eta            = -1.0;
+			if (finished || count >= metric.total)
+				row.eta = 0;
+			else if (count > 0)
+				row.eta = static_cast<double>(metric.total - count) * elapsed / static_cast<double>(count);
+
+			sample = { count, bytes, now };
+		}
+
+		QSaveFile file(fileName);
+		if (file.open(QIODevice::WriteOnly) && file.write(json ? ToJson(rows) : ToPrometheus(rows)) >= 0 && file.commit())
+			return;
+
+		if (!std::exchange(failed, true))
+			PLOGW << "Cannot write metrics to " << fileName;
+	}
+};
+
+QCommandLineOption MetricsPublisher::AddMetricsFileOption(QCommandLineParser& parser)
+{
+	QCommandLineOption option(METRICS, "Periodically write progress metrics, json for *.json else Prometheus text format", "path");
+	parser.addOption(option);
+	return option;
+}
+
+std::shared_ptr<ProgressMetric> MetricsPublisher::Register(std::string name, const size_t total)
+{
+	auto metric   = std::make_shared<ProgressMetric>();
+	metric->name  = std::move(name);
+	metric->total = total;
+
+	if (auto& registry = GetRegistry(); registry.enabled)
+	{
+		std::lock_guard lock(registry.guard);
+		registry.metrics.push_back(metric);
+	}
+
+	return metric;
+}
+
+MetricsPublisher::MetricsPublisher(QString fileName, const std::chrono::milliseconds interval)
+	: m_impl(std::make_unique<Impl>(std::move(fileName), interval))
+{
+}
+
+MetricsPublisher::~MetricsPublisher() = default;
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <QString>
+
+#include "fnd/NonCopyMovable.h"
+
+#include "export/lib.h"
+
+class QCommandLineOption;
+class QCommandLineParser;
+
+namespace HomeCompa::FliLib
+{
+
+struct ProgressMetric
+{
+	std::string                           name;
+	size_t                                total { 0 };
+	std::chrono::steady_clock::time_point start { std::chrono::steady_clock::now() };
+	std::atomic<size_t>                   count { 0 };
+	std::atomic<size_t>                   bytes { 0 };
+	std::atomic<size_t>                   errors { 0 };
+	std::atomic_bool                      finished { false };
+};
+
+class LIB_EXPORT MetricsPublisher
+{
+	NON_COPY_MOVABLE(MetricsPublisher)
+
+public:
+	static constexpr auto DEFAULT_INTERVAL = std::chrono::seconds(5);
+
+public:
+	static QCommandLineOption              AddMetricsFileOption(QCommandLineParser& parser);
+	static std::shared_ptr<ProgressMetric> Register(std::string name, size_t total);
+
+public:
+	explicit MetricsPublisher(QString fileName, std::chrono::milliseconds interval = DEFAULT_INTERVAL);
+	~MetricsPublisher();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace HomeCompa::FliLib
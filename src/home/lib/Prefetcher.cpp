@@ -0,0 +1,220 @@
+#include "Prefetcher.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <ranges>
+#include <thread>
+#include <unordered_map>
+
+#include <QCommandLineParser>
+#include <QFile>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#endif
+
+#include "log.h"
+
+using namespace HomeCompa::FliLib;
+
+namespace
+{
+
+constexpr auto PREFETCH        = "prefetch";
+constexpr auto PREFETCH_BUDGET = "prefetch-budget";
+
+constexpr qint64 CHUNK_SIZE = 1024 * 1024;
+constexpr size_t MEGABYTE   = 1024 * 1024;
+
+struct Prefetched
+{
+	size_t index;
+	size_t bytes;
+};
+
+} // namespace
+
+struct Prefetcher::Impl
+{
+	QStringList                            files;
+	std::vector<size_t>                    groups;
+	const size_t                           depth;
+	const size_t                           budget;
+	std::unordered_map<QString, ptrdiff_t> indices;
+
+	std::mutex              guard;
+	std::condition_variable condition;
+	ptrdiff_t               position { -1 };
+	size_t                  next { 0 };
+	std::deque<Prefetched>  prefetched;
+	bool                    stopped { false };
+
+	std::thread thread;
+
+	Impl(const std::vector<QStringList>& fileGroups, const PrefetchSettings& settings)
+		: depth { settings.depth }
+		, budget { settings.budget * MEGABYTE }
+	{
+		size_t group = 0;
+		for (const auto& fileGroup : fileGroups)
+		{
+			const auto size = files.size();
+			for (const auto& file : fileGroup)
+			{
+				if (!indices.try_emplace(file, files.size()).second)
+					continue;
+
+				files << file;
+				groups.push_back(group);
+			}
+			if (files.size() > size)
+				++group;
+		}
+
+		if (depth > 0 && budget > 0 && files.size() > 1)
+			thread = std::thread(&Impl::Process, this);
+	}
+
+	~Impl()
+	{
+		{
+			std::lock_guard lock(guard);
+			stopped = true;
+		}
+		condition.notify_all();
+		if (thread.joinable())
+			thread.join();
+	}
+
+	void Advance(const QString& file)
+	{
+		const auto it = indices.find(file);
+		if (it == indices.end())
+			return;
+
+		{
+			std::lock_guard lock(guard);
+			if (it->second <= position)
+				return;
+
+			position = it->second;
+			next     = std::max(next, static_cast<size_t>(position) + 1);
+			while (!prefetched.empty() && static_cast<ptrdiff_t>(prefetched.front().index) <= position)
+				prefetched.pop_front();
+		}
+		condition.notify_all();
+	}
+
+	size_t GetUsed() const
+	{
+		return std::accumulate(prefetched.cbegin(), prefetched.cend(), size_t { 0 }, [](const auto init, const auto& item) {
+			return init + item.bytes;
+		});
+	}
+
+	bool IsConsumed(const size_t index)
+	{
+		std::lock_guard lock(guard);
+		return stopped || static_cast<ptrdiff_t>(index) <= position;
+	}
+
+	void Process()
+	{
+		while (true)
+		{
+			size_t index = 0, bytes = 0;
+			{
+				std::unique_lock lock(guard);
+				condition.wait(lock, [&] {
+					return stopped || (position >= 0 && next < static_cast<size_t>(files.size()) && groups[next] <= groups[static_cast<size_t>(position)] + depth && GetUsed() < budget);
+				});
+				if (stopped)
+					return;
+
+				index = next++;
+				bytes = budget - GetUsed();
+				prefetched.emplace_back(index, 0);
+			}
+
+			const auto read = Read(index, bytes);
+
+			std::lock_guard lock(guard);
+			if (auto it = std::ranges::find(prefetched, index, &Prefetched::index); it != prefetched.end())
+				it->bytes = read;
+		}
+	}
+
+	size_t Read(const size_t index, const size_t limit)
+	{
+		QFile file(files[static_cast<qsizetype>(index)]);
+		if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+		{
+			PLOGW << "cannot prefetch " << file.fileName();
+			return 0;
+		}
+
+		const auto bytes = std::min(static_cast<size_t>(file.size()), limit);
+		PLOGD << "prefetch " << file.fileName() << ": " << bytes << " bytes";
+
+#if defined(__linux__)
+		posix_fadvise(file.handle(), 0, static_cast<off_t>(bytes), POSIX_FADV_WILLNEED);
+		posix_fadvise(file.handle(), 0, static_cast<off_t>(bytes), POSIX_FADV_SEQUENTIAL);
+#endif
+
+		QByteArray buffer(CHUNK_SIZE, Qt::Uninitialized);
+		size_t     read = 0;
+		while (read < bytes && !IsConsumed(index))
+		{
+			const auto count = file.read(buffer.data(), std::min(CHUNK_SIZE, static_cast<qint64>(bytes - read)));
+			if (count <= 0)
+				break;
+			read += static_cast<size_t>(count);
+		}
+
+		return read;
+	}
+};
+
+void Prefetcher::AddPrefetchOptions(QCommandLineParser& parser)
+{
+	const PrefetchSettings defaults;
+	parser.addOptions({
+		{ PREFETCH, QString("Number of upcoming archives to read ahead, 0 disables [%1]").arg(defaults.depth), "count" },
+		{ PREFETCH_BUDGET, QString("Read ahead budget, MB [%1]").arg(defaults.budget), "size" },
+	});
+}
+
+PrefetchSettings Prefetcher::GetPrefetchSettings(const QCommandLineParser& parser)
+{
+	PrefetchSettings settings;
+	bool             ok = false;
+	if (const auto value = parser.value(PREFETCH).toULongLong(&ok); ok)
+		settings.depth = static_cast<size_t>(value);
+	if (const auto value = parser.value(PREFETCH_BUDGET).toULongLong(&ok); ok)
+		settings.budget = static_cast<size_t>(value);
+	return settings;
+}
+
+Prefetcher::Prefetcher(QStringList files, const PrefetchSettings& settings)
+	: Prefetcher(files | std::views::transform([](QString& file) {
+					 return QStringList { std::move(file) };
+				 })
+	                 | std::ranges::to<std::vector<QStringList>>(),
+	             settings)
+{
+}
+
+Prefetcher::Prefetcher(const std::vector<QStringList>& groups, const PrefetchSettings& settings)
+	: m_impl { std::make_unique<Impl>(groups, settings) }
+{
+}
+
+Prefetcher::~Prefetcher() = default;
+
+void Prefetcher::Advance(const QString& file)
+{
+	m_impl->Advance(file);
+}
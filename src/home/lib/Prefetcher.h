@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <QStringList>
+
+#include "fnd/NonCopyMovable.h"
+
+#include "export/lib.h"
+
+class QCommandLineParser;
+
+namespace HomeCompa::FliLib
+{
+
+struct PrefetchSettings
+{
+	size_t depth { 2 };
+	size_t budget { 1024 };
+};
+
+class LIB_EXPORT Prefetcher
+{
+	NON_COPY_MOVABLE(Prefetcher)
+
+public:
+	static void             AddPrefetchOptions(QCommandLineParser& parser);
+	static PrefetchSettings GetPrefetchSettings(const QCommandLineParser& parser);
+
+public:
+	Prefetcher(QStringList files, const PrefetchSettings& settings);
+
+	/// depth counts groups, files of a group are read ahead together
+	Prefetcher(const std::vector<QStringList>& groups, const PrefetchSettings& settings);
+	~Prefetcher();
+
+	void Advance(const QString& file);
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace HomeCompa::FliLib
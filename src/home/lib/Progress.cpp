@@ -0,0 +1,146 @@
+#include "Progress.h"
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+#include "util/progress.h"
+
+#include "Metrics.h"
+
+using namespace HomeCompa::FliLib;
+
+namespace
+{
+
+constexpr size_t SHARD_COUNT     = 64;
+constexpr size_t CACHE_LINE_SIZE = 64;
+constexpr auto   RENDER_INTERVAL = std::chrono::milliseconds(250);
+
+struct alignas(CACHE_LINE_SIZE) Shard
+{
+	std::atomic<size_t> count { 0 };
+	std::atomic<size_t> bytes { 0 };
+	std::atomic<size_t> errors { 0 };
+};
+
+using Shards = std::array<Shard, SHARD_COUNT>;
+
+Shard& GetShard(Shards& shards) noexcept
+{
+	static std::atomic<size_t> nextIndex { 0 };
+	thread_local const size_t  index = nextIndex.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+	return shards[index];
+}
+
+size_t Sum(const Shards& shards, std::atomic<size_t> Shard::*value) noexcept
+{
+	return std::accumulate(shards.cbegin(), shards.cend(), size_t { 0 }, [&](const size_t init, const Shard& shard) {
+		return init + (shard.*value).load(std::memory_order_relaxed);
+	});
+}
+
+} // namespace
+
+struct Progress::Impl
+{
+	Shards                          shards;
+	std::atomic_bool                labelRequested { true };
+	Util::Progress                  progress;
+	std::shared_ptr<ProgressMetric> metric;
+	size_t                          rendered { 0 };
+
+	std::mutex              guard;
+	std::condition_variable condition;
+	QString                 label;
+	bool                    stopped { false };
+	std::thread             thread;
+
+	Impl(const size_t total, const char* name)
+		: progress(total, name)
+		, metric { MetricsPublisher::Register(name, total) }
+		, thread(&Impl::Run, this)
+	{
+	}
+
+	~Impl()
+	{
+		{
+			std::lock_guard lock(guard);
+			stopped = true;
+		}
+		condition.notify_all();
+		thread.join();
+
+		Render();
+		metric->finished = true;
+	}
+
+	void Run()
+	{
+		std::unique_lock lock(guard);
+		while (!condition.wait_for(lock, RENDER_INTERVAL, [this] {
+			return stopped;
+		}))
+		{
+			lock.unlock();
+			Render();
+			lock.lock();
+		}
+	}
+
+	void Render()
+	{
+		const auto count = Sum(shards, &Shard::count);
+		metric->count.store(count, std::memory_order_relaxed);
+		metric->bytes.store(Sum(shards, &Shard::bytes), std::memory_order_relaxed);
+		metric->errors.store(Sum(shards, &Shard::errors), std::memory_order_relaxed);
+
+		if (count == rendered)
+			return;
+
+		QString current;
+		{
+			std::lock_guard lock(guard);
+			current = label;
+		}
+		progress.Increment(count - std::exchange(rendered, count), current.toStdString());
+		labelRequested.store(true, std::memory_order_relaxed);
+	}
+};
+
+Progress::Progress(const size_t total, const char* name)
+	: m_impl(std::make_unique<Impl>(total, name))
+{
+}
+
+Progress::~Progress() = default;
+
+bool Progress::Add(const size_t count) noexcept
+{
+	GetShard(m_impl->shards).count.fetch_add(count, std::memory_order_relaxed);
+	return m_impl->labelRequested.load(std::memory_order_relaxed) && m_impl->labelRequested.exchange(false, std::memory_order_relaxed);
+}
+
+void Progress::SetLabel(QString label)
+{
+	std::lock_guard lock(m_impl->guard);
+	m_impl->label = std::move(label);
+}
+
+void Progress::AddBytes(const size_t bytes) noexcept
+{
+	GetShard(m_impl->shards).bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Progress::AddError(const size_t count) noexcept
+{
+	GetShard(m_impl->shards).errors.fetch_add(count, std::memory_order_relaxed);
+}
+
+size_t Progress::GetCount() const noexcept
+{
+	return Sum(m_impl->shards, &Shard::count);
+}
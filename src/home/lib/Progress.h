@@ -0,0 +1,50 @@
+#pragma once
+
+#include <concepts>
+#include <memory>
+
+#include <QString>
+
+#include "fnd/NonCopyMovable.h"
+
+#include "export/lib.h"
+
+namespace HomeCompa::FliLib
+{
+
+class LIB_EXPORT Progress
+{
+	NON_COPY_MOVABLE(Progress)
+
+public:
+	Progress(size_t total, const char* name);
+	~Progress();
+
+public:
+	void Increment(const size_t count, const QString& label)
+	{
+		if (Add(count))
+			SetLabel(label);
+	}
+
+	template <std::invocable LabelGetter>
+	void Increment(const size_t count, LabelGetter&& labelGetter)
+	{
+		if (Add(count))
+			SetLabel(std::forward<LabelGetter>(labelGetter)());
+	}
+
+	void   AddBytes(size_t bytes) noexcept;
+	void   AddError(size_t count = 1) noexcept;
+	size_t GetCount() const noexcept;
+
+private:
+	bool Add(size_t count) noexcept;
+	void SetLabel(QString label);
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace HomeCompa::FliLib
@@ -0,0 +1,416 @@
+#include "Resources.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#if defined(_WIN32)
+// clang-format off
+#include <Windows.h>
+#include <psapi.h>
+// clang-format on
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "log.h"
+
+using namespace HomeCompa::FliLib;
+
+namespace
+{
+
+constexpr auto   RESOURCES       = "resources";
+constexpr auto   SAMPLE_INTERVAL = std::chrono::milliseconds(100);
+constexpr double MEGABYTE        = 1024.0 * 1024.0;
+
+#if defined(FLI_COUNT_ALLOCATIONS)
+constexpr bool COUNT_ALLOCATIONS = true;
+#else
+constexpr bool COUNT_ALLOCATIONS = false;
+#endif
+
+std::atomic<uint64_t> allocationCount { 0 };
+std::atomic<uint64_t> allocatedBytes { 0 };
+
+struct Usage
+{
+	double   user { 0 };
+	double   system { 0 };
+	uint64_t read { 0 };
+	uint64_t written { 0 };
+	uint64_t rss { 0 };
+	uint64_t allocations { 0 };
+	uint64_t allocated { 0 };
+};
+
+#if defined(_WIN32)
+
+double ToSeconds(const FILETIME& time)
+{
+	return static_cast<double>(static_cast<uint64_t>(time.dwHighDateTime) << 32 | time.dwLowDateTime) / 1e7;
+}
+
+PROCESS_MEMORY_COUNTERS GetMemoryCounters()
+{
+	PROCESS_MEMORY_COUNTERS counters {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, static_cast<DWORD>(sizeof counters));
+	return counters;
+}
+
+uint64_t GetRss()
+{
+	return GetMemoryCounters().WorkingSetSize;
+}
+
+uint64_t GetPeakRss()
+{
+	return GetMemoryCounters().PeakWorkingSetSize;
+}
+
+void GetSystemUsage(Usage& usage)
+{
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+	{
+		usage.user   = ToSeconds(userTime);
+		usage.system = ToSeconds(kernelTime);
+	}
+
+	IO_COUNTERS io {};
+	if (GetProcessIoCounters(GetCurrentProcess(), &io))
+	{
+		usage.read    = io.ReadTransferCount;
+		usage.written = io.WriteTransferCount;
+	}
+}
+
+#else
+
+double ToSeconds(const timeval& time)
+{
+	return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) / 1e6;
+}
+
+uint64_t GetRss()
+{
+#if defined(__linux__)
+	std::ifstream stream("/proc/self/statm");
+	uint64_t      size = 0, resident = 0;
+	if (stream >> size >> resident)
+		return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+	return 0;
+}
+
+uint64_t GetPeakRss()
+{
+	rusage usage {};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+#if defined(__APPLE__)
+	return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+	return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+void GetSystemUsage(Usage& usage)
+{
+	if (rusage resourceUsage {}; getrusage(RUSAGE_SELF, &resourceUsage) == 0)
+	{
+		usage.user   = ToSeconds(resourceUsage.ru_utime);
+		usage.system = ToSeconds(resourceUsage.ru_stime);
+	}
+
+#if defined(__linux__)
+	std::ifstream stream("/proc/self/io");
+	for (std::string key; stream >> key;)
+	{
+		uint64_t value = 0;
+		stream >> value;
+		if (key == "rchar:")
+			usage.read = value;
+		else if (key == "wchar:")
+			usage.written = value;
+	}
+#endif
+}
+
+#endif
+
+Usage GetUsage()
+{
+	Usage usage;
+	GetSystemUsage(usage);
+	usage.rss         = GetRss();
+	usage.allocations = allocationCount.load(std::memory_order_relaxed);
+	usage.allocated   = allocatedBytes.load(std::memory_order_relaxed);
+	return usage;
+}
+
+struct Phase
+{
+	std::string name;
+	size_t      count { 0 };
+	double      wall { 0 };
+	Usage       usage;
+};
+
+struct ActivePhase
+{
+	size_t                                index;
+	std::chrono::steady_clock::time_point start;
+	Usage                                 usage;
+	uint64_t                              peakRss;
+};
+
+struct Registry
+{
+	std::atomic_bool         enabled { false };
+	std::thread::id          mainThreadId;
+	std::mutex               guard;
+	std::vector<Phase>       phases;
+	std::vector<ActivePhase> active;
+	uint64_t                 peakRss { 0 };
+};
+
+Registry& GetRegistry()
+{
+	static Registry registry;
+	return registry;
+}
+
+QString ToString(const double wall, const Usage& usage)
+{
+	auto result = QString("wall %1 s, user %2 s, system %3 s, peak rss %4 MB, read %5 MB, written %6 MB")
+	                  .arg(wall, 0, 'f', 1)
+	                  .arg(usage.user, 0, 'f', 1)
+	                  .arg(usage.system, 0, 'f', 1)
+	                  .arg(static_cast<double>(usage.rss) / MEGABYTE, 0, 'f', 0)
+	                  .arg(static_cast<double>(usage.read) / MEGABYTE, 0, 'f', 0)
+	                  .arg(static_cast<double>(usage.written) / MEGABYTE, 0, 'f', 0);
+	if constexpr (COUNT_ALLOCATIONS)
+		result.append(QString(", allocations %1 (%2 MB)").arg(usage.allocations).arg(static_cast<double>(usage.allocated) / MEGABYTE, 0, 'f', 0));
+	return result;
+}
+
+QJsonObject ToJson(const double wall, const Usage& usage)
+{
+	QJsonObject result {
+		{ "wallSeconds", wall },
+		{ "userSeconds", usage.user },
+		{ "systemSeconds", usage.system },
+		{ "peakRssBytes", static_cast<qint64>(usage.rss) },
+		{ "readBytes", static_cast<qint64>(usage.read) },
+		{ "writtenBytes", static_cast<qint64>(usage.written) },
+	};
+	if constexpr (COUNT_ALLOCATIONS)
+	{
+		result.insert("allocations", static_cast<qint64>(usage.allocations));
+		result.insert("allocatedBytes", static_cast<qint64>(usage.allocated));
+	}
+	return result;
+}
+
+} // namespace
+
+#if defined(FLI_COUNT_ALLOCATIONS)
+
+void* operator new(const std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	if (auto* ptr = std::malloc(size == 0 ? 1 : size))
+		return ptr;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+#endif
+
+struct ResourceReporter::Impl
+{
+	QString                               fileName;
+	std::chrono::steady_clock::time_point start { std::chrono::steady_clock::now() };
+
+	std::mutex              guard;
+	std::condition_variable condition;
+	bool                    stopped { false };
+	std::thread             thread;
+
+	explicit Impl(QString fileName_)
+		: fileName { std::move(fileName_) }
+	{
+		auto& registry        = GetRegistry();
+		registry.mainThreadId = std::this_thread::get_id();
+		registry.enabled.store(true, std::memory_order_release);
+
+		thread = std::thread(&Impl::Sample, this);
+	}
+
+	~Impl()
+	{
+		{
+			std::lock_guard lock(guard);
+			stopped = true;
+		}
+		condition.notify_all();
+		thread.join();
+
+		auto& registry = GetRegistry();
+		registry.enabled.store(false, std::memory_order_release);
+
+		const auto wall  = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		auto       total = GetUsage();
+
+		std::lock_guard lock(registry.guard);
+		total.rss = std::max({ total.rss, registry.peakRss, GetPeakRss() });
+		registry.active.clear();
+
+		PLOGI << "resources: " << ToString(wall, total);
+		for (const auto& phase : registry.phases)
+			PLOGI << "phase " << phase.name << " (" << phase.count << "): " << ToString(phase.wall, phase.usage);
+
+		if (!fileName.isEmpty())
+			Write(wall, total, registry.phases);
+	}
+
+private:
+	void Sample()
+	{
+		auto& registry = GetRegistry();
+
+		std::unique_lock lock(guard);
+		while (!condition.wait_for(lock, SAMPLE_INTERVAL, [this] {
+			return stopped;
+		}))
+		{
+			const auto      rss = GetRss();
+			std::lock_guard registryLock(registry.guard);
+			registry.peakRss = std::max(registry.peakRss, rss);
+			for (auto& phase : registry.active)
+				phase.peakRss = std::max(phase.peakRss, rss);
+		}
+	}
+
+	void Write(const double wall, const Usage& total, const std::vector<Phase>& phases) const
+	{
+		QJsonArray phasesJson;
+		for (const auto& phase : phases)
+		{
+			auto phaseJson = ToJson(phase.wall, phase.usage);
+			phaseJson.insert("name", QString::fromStdString(phase.name));
+			phaseJson.insert("count", static_cast<qint64>(phase.count));
+			phasesJson.append(phaseJson);
+		}
+
+		const auto json = QJsonDocument(QJsonObject {
+											{ "tool", QCoreApplication::applicationName() },
+											{ "pid", QCoreApplication::applicationPid() },
+											{ "timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate) },
+											{ "total", ToJson(wall, total) },
+											{ "phases", phasesJson },
+										})
+		                      .toJson();
+
+		QSaveFile file(fileName);
+		if (file.open(QIODevice::WriteOnly) && file.write(json) >= 0 && file.commit())
+			PLOGI << "resource report written to " << fileName;
+		else
+			PLOGW << "Cannot write resource report to " << fileName;
+	}
+};
+
+QCommandLineOption ResourceReporter::AddResourceReportOption(QCommandLineParser& parser)
+{
+	QCommandLineOption option(RESOURCES, "Write resource usage report as json", "path");
+	parser.addOption(option);
+	return option;
+}
+
+int ResourceReporter::BeginPhase(const char* name)
+{
+	auto& registry = GetRegistry();
+	if (!registry.enabled.load(std::memory_order_acquire) || std::this_thread::get_id() != registry.mainThreadId)
+		return -1;
+
+	const auto usage = GetUsage();
+
+	std::lock_guard lock(registry.guard);
+	auto            it = std::ranges::find(registry.phases, name, &Phase::name);
+	if (it == registry.phases.end())
+		it = registry.phases.insert(registry.phases.end(), Phase { .name = name });
+
+	registry.active.emplace_back(static_cast<size_t>(std::distance(registry.phases.begin(), it)), std::chrono::steady_clock::now(), usage, usage.rss);
+	return static_cast<int>(registry.active.size()) - 1;
+}
+
+void ResourceReporter::EndPhase(const int phase)
+{
+	if (phase < 0)
+		return;
+
+	auto&      registry = GetRegistry();
+	const auto usage    = GetUsage();
+	const auto now      = std::chrono::steady_clock::now();
+
+	std::lock_guard lock(registry.guard);
+	if (static_cast<size_t>(phase) >= registry.active.size())
+		return;
+
+	const auto active = registry.active[static_cast<size_t>(phase)];
+	registry.active.resize(static_cast<size_t>(phase));
+
+	auto& [name, count, wall, total] = registry.phases[active.index];
+	++count;
+	wall += std::chrono::duration<double>(now - active.start).count();
+	total.user += usage.user - active.usage.user;
+	total.system += usage.system - active.usage.system;
+	total.read += usage.read - active.usage.read;
+	total.written += usage.written - active.usage.written;
+	total.allocations += usage.allocations - active.usage.allocations;
+	total.allocated += usage.allocated - active.usage.allocated;
+	total.rss        = std::max({ total.rss, active.peakRss, usage.rss });
+	registry.peakRss = std::max(registry.peakRss, total.rss);
+}
+
+uint64_t ResourceReporter::PeakRss()
+{
+	return GetPeakRss();
+}
+
+ResourceReporter::ResourceReporter(QString fileName)
+	: m_impl(std::make_unique<Impl>(std::move(fileName)))
+{
+}
+
+ResourceReporter::~ResourceReporter() = default;
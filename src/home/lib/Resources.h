@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <QString>
+
+#include "fnd/NonCopyMovable.h"
+
+#include "export/lib.h"
+
+class QCommandLineOption;
+class QCommandLineParser;
+
+namespace HomeCompa::FliLib
+{
+
+class LIB_EXPORT ResourceReporter
+{
+	NON_COPY_MOVABLE(ResourceReporter)
+
+public:
+	static QCommandLineOption AddResourceReportOption(QCommandLineParser& parser);
+
+	static int  BeginPhase(const char* name);
+	static void EndPhase(int phase);
+
+	static uint64_t PeakRss();
+
+public:
+	explicit ResourceReporter(QString fileName);
+	~ResourceReporter();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace HomeCompa::FliLib
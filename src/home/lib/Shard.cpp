@@ -0,0 +1,191 @@
+#include "Shard.h"
+
+#include <algorithm>
+#include <format>
+#include <numeric>
+#include <ranges>
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+#include "log.h"
+#include "zip.h"
+
+using namespace HomeCompa::FliLib;
+
+namespace
+{
+
+constexpr auto SHARD       = "shard";
+constexpr auto SHARD_SPLIT = "shard-split";
+constexpr auto SHARD_MERGE = "shard-merge";
+
+size_t ToSize(const QString& value, const char* option)
+{
+	bool       ok     = false;
+	const auto result = value.toULongLong(&ok);
+	if (!ok)
+		throw std::invalid_argument(QString("invalid --%1 value: %2").arg(option, value).toStdString());
+	return static_cast<size_t>(result);
+}
+
+} // namespace
+
+bool ShardItem::IsPart() const noexcept
+{
+	return begin != 0 || end != total;
+}
+
+QString ShardItem::GetName() const
+{
+	const auto name = QFileInfo(archive).completeBaseName();
+	return IsPart() ? QString("%1.part%2-%3").arg(name).arg(begin).arg(end) : name;
+}
+
+void Shard::AddShardOptions(QCommandLineParser& parser)
+{
+	parser.addOptions({
+		{ SHARD, "Process only the given part of the archive list, index in [0, count)", "index/count" },
+		{ SHARD_SPLIT, "Split archives with more entries into entry ranges of this size while sharding", "entries" },
+		{ SHARD_MERGE, "Merge partial outputs of the given number of shards", "count" },
+	});
+}
+
+Shard Shard::FromCommandLine(const QCommandLineParser& parser)
+{
+	const auto split = parser.isSet(SHARD_SPLIT) ? ToSize(parser.value(SHARD_SPLIT), SHARD_SPLIT) : size_t { 0 };
+
+	if (parser.isSet(SHARD_MERGE))
+	{
+		if (parser.isSet(SHARD))
+			throw std::invalid_argument(QString("--%1 and --%2 are mutually exclusive").arg(SHARD, SHARD_MERGE).toStdString());
+		return Shard(0, ToSize(parser.value(SHARD_MERGE), SHARD_MERGE), split, true);
+	}
+
+	if (!parser.isSet(SHARD))
+		return {};
+
+	static const QRegularExpression rx(R"(^(\d+)/(\d+)$)");
+	const auto                      match = rx.match(parser.value(SHARD));
+	if (!match.hasMatch())
+		throw std::invalid_argument(QString("invalid --%1 value: %2, index/count expected").arg(SHARD, parser.value(SHARD)).toStdString());
+
+	return Shard(ToSize(match.captured(1), SHARD), ToSize(match.captured(2), SHARD), split);
+}
+
+ShardPlan Shard::FindParts(const QString& folder, const QString& archive, const size_t total, const QString& suffix)
+{
+	const auto               name = QFileInfo(archive).completeBaseName();
+	const QRegularExpression rx(QString(R"(^%1\.part(\d+)-(\d+)%2$)").arg(QRegularExpression::escape(name), QRegularExpression::escape(suffix)));
+
+	ShardPlan parts;
+	for (const auto& fileName : QDir(folder).entryList({ QString("%1.part*%2").arg(name, suffix) }, QDir::Files))
+		if (const auto match = rx.match(fileName); match.hasMatch())
+			parts.emplace_back(archive, total, static_cast<size_t>(match.captured(1).toULongLong()), static_cast<size_t>(match.captured(2).toULongLong()));
+
+	if (parts.empty())
+		return parts;
+
+	std::ranges::sort(parts, {}, &ShardItem::begin);
+
+	QStringList missing;
+	size_t      covered = 0;
+	for (const auto& part : parts)
+	{
+		if (part.begin < covered)
+			throw std::invalid_argument(QString("%1: part %2 overlaps previous parts").arg(name, part.GetName()).toStdString());
+		if (part.begin > covered)
+			missing << QString("%1-%2").arg(covered).arg(part.begin);
+		covered = part.end;
+	}
+	if (covered < total)
+		missing << QString("%1-%2").arg(covered).arg(total);
+
+	if (!missing.isEmpty())
+		throw std::invalid_argument(QString("%1: missing parts %2").arg(name, missing.join(", ")).toStdString());
+
+	return parts;
+}
+
+Shard::Shard(const size_t index, const size_t count, const size_t split, const bool merge)
+	: m_index { index }
+	, m_count { count }
+	, m_split { split }
+	, m_merge { merge }
+{
+	if (m_count == 0 || m_index >= m_count)
+		throw std::invalid_argument(std::format("invalid shard {}/{}", m_index, m_count));
+}
+
+bool Shard::IsEnabled() const noexcept
+{
+	return m_count > 1;
+}
+
+bool Shard::IsMerge() const noexcept
+{
+	return m_merge;
+}
+
+size_t Shard::GetCount() const noexcept
+{
+	return m_count;
+}
+
+ShardPlan Shard::Split(const QStringList& archives, const std::function<size_t(const QString&)>& getEntryCount) const
+{
+	ShardPlan plan;
+	for (const auto& archive : archives)
+	{
+		const auto total = getEntryCount ? getEntryCount(archive) : static_cast<size_t>(Zip(archive).GetFileNameList().size());
+		const auto step  = IsEnabled() && m_split > 0 ? m_split : std::max(total, size_t { 1 });
+		for (size_t begin = 0; begin < total || begin == 0; begin += step)
+			plan.emplace_back(archive, total, begin, std::min(begin + step, total));
+	}
+
+	return plan;
+}
+
+ShardPlan Shard::Select(const ShardPlan& plan) const
+{
+	if (!IsEnabled())
+		return plan;
+
+	std::vector<size_t> order(plan.size());
+	std::iota(order.begin(), order.end(), size_t { 0 });
+	std::ranges::stable_sort(order, std::greater {}, [&](const size_t index) {
+		return plan[index].end - plan[index].begin;
+	});
+
+	std::vector<size_t> load(m_count, 0);
+	std::vector<bool>   selected(plan.size(), false);
+	for (const auto index : order)
+	{
+		const auto shard = static_cast<size_t>(std::ranges::min_element(load) - load.begin());
+		load[shard]      += plan[index].end - plan[index].begin;
+		selected[index]  = shard == m_index;
+	}
+
+	ShardPlan result;
+	for (size_t index = 0; index < plan.size(); ++index)
+		if (selected[index])
+			result.push_back(plan[index]);
+
+	PLOGI << QString("shard %1/%2: %3 of %4 items, %5 entries").arg(m_index).arg(m_count).arg(result.size()).arg(plan.size()).arg(load[m_index]);
+	return result;
+}
+
+QString Shard::GetFileName(const QString& path) const
+{
+	return IsEnabled() && !path.isEmpty() ? QString("%1.shard%2of%3").arg(path).arg(m_index).arg(m_count) : path;
+}
+
+QStringList Shard::GetFileNames(const QString& path) const
+{
+	return std::views::iota(size_t { 0 }, m_count) | std::views::transform([&](const size_t index) {
+			   return Shard(index, m_count).GetFileName(path);
+		   })
+	     | std::ranges::to<QStringList>();
+}
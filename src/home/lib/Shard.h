@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <QString>
+
+#include "export/lib.h"
+
+class QCommandLineParser;
+
+namespace HomeCompa::FliLib
+{
+
+struct ShardItem
+{
+	QString archive;
+	size_t  total { 0 };
+	size_t  begin { 0 };
+	size_t  end { 0 };
+
+	LIB_EXPORT bool    IsPart() const noexcept;
+	LIB_EXPORT QString GetName() const;
+};
+
+using ShardPlan = std::vector<ShardItem>;
+
+class LIB_EXPORT Shard
+{
+public:
+	static void      AddShardOptions(QCommandLineParser& parser);
+	static Shard     FromCommandLine(const QCommandLineParser& parser);
+	static ShardPlan FindParts(const QString& folder, const QString& archive, size_t total, const QString& suffix);
+
+public:
+	Shard() = default;
+	Shard(size_t index, size_t count, size_t split = 0, bool merge = false);
+
+	bool   IsEnabled() const noexcept;
+	bool   IsMerge() const noexcept;
+	size_t GetCount() const noexcept;
+
+	ShardPlan   Split(const QStringList& archives, const std::function<size_t(const QString&)>& getEntryCount = {}) const;
+	ShardPlan   Select(const ShardPlan& plan) const;
+	QString     GetFileName(const QString& path) const;
+	QStringList GetFileNames(const QString& path) const;
+
+private:
+	size_t m_index { 0 };
+	size_t m_count { 1 };
+	size_t m_split { 0 };
+	bool   m_merge { false };
+};
+
+} // namespace HomeCompa::FliLib
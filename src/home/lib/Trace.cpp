@@ -0,0 +1,250 @@
+#include "Trace.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ranges>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+
+#include "Resources.h"
+#include "log.h"
+
+using namespace HomeCompa::FliLib;
+
+namespace
+{
+
+constexpr auto TRACE             = "trace";
+constexpr auto EVENTS_CHUNK_SIZE = 256;
+constexpr auto MAX_EVENTS        = size_t { 500'000 };
+
+struct Event
+{
+	const char* name;
+	QString     detail;
+	int64_t     start;
+	int64_t     duration;
+};
+
+struct EventChunk
+{
+	std::array<Event, EVENTS_CHUNK_SIZE> events;
+	std::atomic_size_t                   count { 0 };
+	std::atomic<EventChunk*>             next { nullptr };
+};
+
+// only the owning thread appends; an event is published by the release store of its chunk count, so the writer reads without locking
+struct ThreadBuffer
+{
+	size_t                      tid;
+	bool                        isMain;
+	std::unique_ptr<EventChunk> head { std::make_unique<EventChunk>() };
+	EventChunk*                 tail { head.get() };
+
+	~ThreadBuffer()
+	{
+		for (auto* chunk = head->next.load(std::memory_order_acquire); chunk;)
+			delete std::exchange(chunk, chunk->next.load(std::memory_order_acquire));
+	}
+
+	void Add(Event event)
+	{
+		auto count = tail->count.load(std::memory_order_relaxed);
+		if (count == tail->events.size())
+		{
+			auto* chunk = new EventChunk;
+			tail->next.store(chunk, std::memory_order_release);
+			tail  = chunk;
+			count = 0;
+		}
+
+		tail->events[count] = std::move(event);
+		tail->count.store(count + 1, std::memory_order_release);
+	}
+};
+
+// a long run keeps only the first MAX_EVENTS spans, the rest are counted as dropped, so memory and the output file stay bounded
+struct Registry
+{
+	std::atomic_bool                           enabled { false };
+	std::atomic_size_t                         events { 0 };
+	std::atomic_size_t                         dropped { 0 };
+	std::chrono::steady_clock::time_point      start;
+	std::thread::id                            mainThreadId;
+	std::mutex                                 guard;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+Registry& GetRegistry()
+{
+	static Registry registry;
+	return registry;
+}
+
+ThreadBuffer& GetThreadBuffer()
+{
+	thread_local ThreadBuffer* buffer = [] {
+		auto&           registry = GetRegistry();
+		std::lock_guard lock(registry.guard);
+		return registry.buffers.emplace_back(std::make_unique<ThreadBuffer>(registry.buffers.size(), std::this_thread::get_id() == registry.mainThreadId)).get();
+	}();
+	return *buffer;
+}
+
+int64_t Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - GetRegistry().start).count();
+}
+
+QByteArray Escape(const QString& str)
+{
+	QByteArray result;
+	for (const auto ch : str.toUtf8())
+	{
+		switch (ch)
+		{
+			case '"':
+				result.append(R"(\")");
+				break;
+			case '\\':
+				result.append(R"(\\)");
+				break;
+			default:
+				if (static_cast<unsigned char>(ch) < 0x20)
+					result.append(QString(R"(\u%1)").arg(static_cast<int>(ch), 4, 16, QChar('0')).toUtf8());
+				else
+					result.append(ch);
+		}
+	}
+	return result;
+}
+
+QByteArray Microseconds(const int64_t ns)
+{
+	return QByteArray::number(static_cast<double>(ns) / 1000.0, 'f', 3);
+}
+
+} // namespace
+
+struct TraceInitializer::Impl
+{
+	QString fileName;
+
+	void Write() const
+	{
+		auto& registry = GetRegistry();
+		registry.enabled.store(false, std::memory_order_release);
+
+		QFile file(fileName);
+		if (!file.open(QIODevice::WriteOnly))
+		{
+			PLOGE << "Cannot write trace to " << fileName;
+			return;
+		}
+
+		const auto pid = QByteArray::number(QCoreApplication::applicationPid());
+
+		std::lock_guard lock(registry.guard);
+		size_t          count     = 0;
+		const char*     separator = "";
+
+		file.write(R"({"displayTimeUnit":"ms","traceEvents":[)");
+		for (const auto& buffer : registry.buffers)
+		{
+			const auto tid = QByteArray::number(static_cast<qulonglong>(buffer->tid));
+			file.write(separator);
+			separator = ",";
+			file.write("\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{\"name\":\""
+			           + (buffer->isMain ? QByteArray("main") : "worker " + tid) + "\"}}");
+
+			for (const auto* chunk = buffer->head.get(); chunk; chunk = chunk->next.load(std::memory_order_acquire))
+			{
+				const auto size = chunk->count.load(std::memory_order_acquire);
+				for (const auto& event : chunk->events | std::views::take(static_cast<ptrdiff_t>(size)))
+				{
+					file.write(",\n{\"name\":\"" + Escape(event.name) + "\",\"ph\":\"X\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"ts\":" + Microseconds(event.start) + ",\"dur\":"
+					           + Microseconds(event.duration));
+					if (!event.detail.isEmpty())
+						file.write(",\"args\":{\"detail\":\"" + Escape(event.detail) + "\"}");
+					file.write("}");
+				}
+				count += size;
+			}
+		}
+		file.write("\n]}\n");
+
+		PLOGI << count << " trace events written to " << fileName;
+		if (const auto dropped = registry.dropped.load(std::memory_order_relaxed))
+			PLOGW << dropped << " trace events dropped over the limit of " << MAX_EVENTS;
+	}
+};
+
+QCommandLineOption TraceInitializer::AddTraceFileOption(QCommandLineParser& parser)
+{
+	QCommandLineOption option(TRACE, QString("Write trace event timeline, the first %1 events are kept").arg(MAX_EVENTS), "path");
+	parser.addOption(option);
+	return option;
+}
+
+TraceInitializer::TraceInitializer(QString fileName)
+	: m_impl(std::make_unique<Impl>(std::move(fileName)))
+{
+	if (m_impl->fileName.isEmpty())
+		return;
+
+	auto& registry        = GetRegistry();
+	registry.start        = std::chrono::steady_clock::now();
+	registry.mainThreadId = std::this_thread::get_id();
+	registry.enabled.store(true, std::memory_order_release);
+}
+
+TraceInitializer::~TraceInitializer()
+{
+	if (!m_impl->fileName.isEmpty())
+		m_impl->Write();
+}
+
+TraceSpan::TraceSpan(const char* name, const QString& detail)
+	: m_name { name }
+	, m_phase { ResourceReporter::BeginPhase(name) }
+{
+	auto& registry = GetRegistry();
+	if (!registry.enabled.load(std::memory_order_acquire))
+		return;
+
+	if (registry.events.load(std::memory_order_relaxed) >= MAX_EVENTS)
+	{
+		registry.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	m_detail = detail;
+	m_start  = Now();
+}
+
+TraceSpan::~TraceSpan()
+{
+	ResourceReporter::EndPhase(m_phase);
+
+	if (m_start < 0)
+		return;
+
+	auto& registry = GetRegistry();
+	if (!registry.enabled.load(std::memory_order_acquire))
+		return;
+
+	if (registry.events.fetch_add(1, std::memory_order_relaxed) >= MAX_EVENTS)
+	{
+		registry.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	GetThreadBuffer().Add({ m_name, std::move(m_detail), m_start, Now() - m_start });
+}
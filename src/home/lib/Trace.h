@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+
+#include <QString>
+
+#include "fnd/NonCopyMovable.h"
+
+#include "export/lib.h"
+
+class QCommandLineOption;
+class QCommandLineParser;
+
+namespace HomeCompa::FliLib
+{
+
+class LIB_EXPORT TraceInitializer
+{
+	NON_COPY_MOVABLE(TraceInitializer)
+
+public:
+	static QCommandLineOption AddTraceFileOption(QCommandLineParser& parser);
+
+public:
+	explicit TraceInitializer(QString fileName);
+	~TraceInitializer();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+class LIB_EXPORT TraceSpan
+{
+	NON_COPY_MOVABLE(TraceSpan)
+
+public:
+	explicit TraceSpan(const char* name, const QString& detail = {});
+	~TraceSpan();
+
+private:
+	const char* m_name;
+	QString     m_detail;
+	int64_t     m_start { -1 };
+	int         m_phase { -1 };
+};
+
+} // namespace HomeCompa::FliLib
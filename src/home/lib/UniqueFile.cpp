@@ -12,9 +12,9 @@
 #include "util/StrUtil.h"
 #include "util/executor/ThreadPool.h"
 #include "util/files.h"
-#include "util/progress.h"
 #include "util/xml/XmlWriter.h"
 
+#include "Progress.h"
 #include "book.h"
 #include "log.h"
 #include "util.h"
@@ -22,6 +22,14 @@
 using namespace HomeCompa::FliLib;
 using namespace HomeCompa;
 
+struct HomeCompa::FliLib::InpDataTables
+{
+	InpData                            data;
+	std::vector<Book*>                 books;
+	std::unordered_map<QString, Book*> libIdToBook;
+	std::unordered_map<QString, Book*> hashToBook;
+};
+
 namespace
 {
 
@@ -219,6 +227,25 @@ QString createSi()
 	return result;
 }
 
+Book* FindBook(const InpData& inpData, const QString& fileName)
+{
+	if (const auto it = inpData.find(fileName); it != inpData.end())
+		return it->second.get();
+
+	auto file = fileName;
+	for (auto baseFile = QFileInfo(file).completeBaseName(); baseFile != file; file = baseFile)
+		if (const auto it = inpData.find(baseFile); it != inpData.end())
+			return it->second.get();
+
+	return nullptr;
+}
+
+Book* FindBook(const std::unordered_map<QString, Book*>& books, const QString& key)
+{
+	const auto it = books.find(key);
+	return it != books.end() ? it->second : nullptr;
+}
+
 } // namespace
 
 QString UniqueFile::GetTitle() const
@@ -238,6 +265,7 @@ void UniqueFile::ClearImages()
 }
 
 InpDataProvider::InpDataProvider(const QString& dumpWildCards)
+	: m_tables { std::make_shared<InpDataTables>() }
 {
 	for (const auto& wildCard : dumpWildCards.split(';', Qt::SkipEmptyParts))
 		for (const auto& dumpPath : Util::ResolveWildcard(wildCard))
@@ -252,35 +280,25 @@ InpDataProvider::~InpDataProvider() = default;
 
 Book* InpDataProvider::GetBook(const UniqueFile::Uid& uid) const
 {
-	if (const auto it = m_data.find(QString("%1#%2").arg(uid.folder, uid.file)); it != m_data.end())
+	if (const auto it = m_tables->data.find(QString("%1#%2").arg(uid.folder, uid.file)); it != m_tables->data.end())
 		return it->second.get();
 
 	if (!std::ranges::empty(m_cache | std::views::filter([this](const auto& item) {
-								return &item.inpData != m_currentInpData && !item.inpData.empty();
+								return item.inpData.get() != m_currentInpData && (!item.inpData->empty() || item.released);
 							})))
 		return nullptr;
 
-	if (const auto it = m_currentInpData->find(uid.file); it != m_currentInpData->end())
-		return it->second.get();
-
-	auto file = uid.file;
-	for (auto baseFile = QFileInfo(file).completeBaseName(); baseFile != file; file = baseFile)
-		if (const auto it = m_currentInpData->find(baseFile); it != m_currentInpData->end())
-			return it->second.get();
-
-	return nullptr;
+	return FindBook(*m_currentInpData, uid.file);
 }
 
 Book* InpDataProvider::GetBook(const QString& sourceLib, const QString& libId) const
 {
-	const auto it = m_libIdToBook.find(QString("%1_%2").arg(sourceLib.toLower(), libId));
-	return it != m_libIdToBook.end() ? it->second : nullptr;
+	return FindBook(m_tables->libIdToBook, QString("%1_%2").arg(sourceLib.toLower(), libId));
 }
 
 Book* InpDataProvider::GetBook(const QString& hash) const
 {
-	const auto it = m_hashToBook.find(hash);
-	return it != m_hashToBook.end() ? it->second : nullptr;
+	return FindBook(m_tables->hashToBook, hash);
 }
 
 void InpDataProvider::SetSourceLib(const QString& sourceLib)
@@ -293,23 +311,107 @@ void InpDataProvider::SetSourceLib(const QString& sourceLib)
 		);
 	    it != m_cache.end())
 	{
-		if (it->inpData.empty())
-			it->inpData = CreateInpData(*it->dump);
-
-		m_currentInpData = &it->inpData;
+		if (it->inpData->empty())
+			Load(*it);
 
-		std::ranges::transform(*m_currentInpData | std::views::values, std::inserter(m_libIdToBook, m_libIdToBook.end()), [sourceLib = sourceLib.toLower()](const auto& item) {
-			return std::make_pair(QString("%1_%2").arg(sourceLib, item->libId), item.get());
-		});
+		m_currentInpData = it->inpData.get();
+		return;
+	}
 
-		std::ranges::transform(*m_currentInpData | std::views::values, std::inserter(m_hashToBook, m_hashToBook.end()), [](const auto& item) {
-			return std::make_pair(item->hash, item.get());
-		});
+	m_currentInpData = &m_stub;
+}
 
+void InpDataProvider::Release(const QString& sourceLib)
+{
+	const auto it = std::ranges::find_if(m_cache, [&](const auto& item) {
+		return item.sourceLib.compare(sourceLib, Qt::CaseInsensitive) == 0;
+	});
+	if (it == m_cache.end() || it->inpData->empty())
 		return;
+
+	auto&      tables     = GetTables();
+	const auto cacheIndex = static_cast<size_t>(std::distance(m_cache.begin(), it));
+	const auto lib        = it->sourceLib.toLower();
+	const auto books      = tables.books | std::ranges::to<std::unordered_set<const Book*>>();
+
+	size_t retained = 0;
+	for (const auto& book : *it->inpData | std::views::values)
+	{
+		if (book.use_count() > 1 || books.contains(book.get()))
+		{
+			if (book.use_count() == 1)
+				m_retained.emplace_back(book);
+			++retained;
+			continue;
+		}
+
+		if (const auto libIdIt = tables.libIdToBook.find(QString("%1_%2").arg(lib, book->libId)); libIdIt != tables.libIdToBook.end() && libIdIt->second == book.get())
+			tables.libIdToBook.erase(libIdIt);
+
+		if (const auto hashIt = tables.hashToBook.find(book->hash); hashIt != tables.hashToBook.end() && hashIt->second == book.get())
+		{
+			tables.hashToBook.erase(hashIt);
+			m_releasedHashes.try_emplace(book->hash, cacheIndex, book->libId);
+		}
 	}
 
-	m_currentInpData = &m_stub;
+	PLOGI << it->sourceLib << " inp data released: " << it->inpData->size() - retained << " books, " << retained << " retained";
+
+	if (m_currentInpData == it->inpData.get())
+		m_currentInpData = &m_stub;
+
+	it->inpData  = std::make_shared<InpData>();
+	it->released = true;
+}
+
+Book* InpDataProvider::RestoreBook(const QString& hash)
+{
+	const auto it = m_releasedHashes.find(hash);
+	if (it == m_releasedHashes.end())
+		return nullptr;
+
+	// only the released book's rows are selected, the rest of the library stays out of memory
+	const auto& item    = m_cache[it->second.cacheIndex];
+	const auto  inpData = CreateInpData(*item.dump, it->second.libId);
+	m_releasedHashes.erase(it);
+
+	const auto bookIt = std::ranges::find_if(inpData, [&](const auto& entry) {
+		return entry.second->hash == hash;
+	});
+	if (bookIt == inpData.end())
+		return nullptr;
+
+	const auto& book   = m_retained.emplace_back(bookIt->second);
+	auto&       tables = GetTables();
+	tables.libIdToBook.try_emplace(QString("%1_%2").arg(item.sourceLib.toLower(), book->libId), book.get());
+	tables.hashToBook.try_emplace(book->hash, book.get());
+
+	PLOGI << item.sourceLib << ": book " << book->libId << " restored";
+	return book.get();
+}
+
+void InpDataProvider::Load(CacheItem& item)
+{
+	item.inpData  = std::make_shared<InpData>(CreateInpData(*item.dump));
+	item.released = false;
+
+	auto& tables = GetTables();
+	std::ranges::transform(*item.inpData | std::views::values, std::inserter(tables.libIdToBook, tables.libIdToBook.end()), [sourceLib = item.sourceLib.toLower()](const auto& book) {
+		return std::make_pair(QString("%1_%2").arg(sourceLib, book->libId), book.get());
+	});
+
+	std::ranges::transform(*item.inpData | std::views::values, std::inserter(tables.hashToBook, tables.hashToBook.end()), [](const auto& book) {
+		return std::make_pair(book->hash, book.get());
+	});
+}
+
+InpDataTables& InpDataProvider::GetTables()
+{
+	// snapshots keep the tables they were taken from, a change after Freeze() goes to a copy
+	if (m_tables.use_count() > 1)
+		m_tables = std::make_shared<InpDataTables>(*m_tables);
+
+	return *m_tables;
 }
 
 bool InpDataProvider::Enumerate(std::function<bool(const QString&, const IDump&)> functor) const
@@ -321,25 +423,78 @@ bool InpDataProvider::Enumerate(std::function<bool(const QString&, const IDump&)
 
 Book* InpDataProvider::AddBook(Book* book)
 {
-	return m_books.emplace_back(book);
+	return GetTables().books.emplace_back(book);
 }
 
 Book* InpDataProvider::AddBook(std::unique_ptr<Book> book)
 {
+	auto& tables = GetTables();
 	auto  key    = book->GetUid();
-	auto& result = m_data.try_emplace(std::move(key), std::move(book)).first->second;
-	return m_books.emplace_back(result.get());
+	auto& result = tables.data.try_emplace(std::move(key), std::move(book)).first->second;
+	return tables.books.emplace_back(result.get());
 }
 
 const std::vector<Book*>& InpDataProvider::Books() const noexcept
 {
-	return m_books;
+	return m_tables->books;
+}
+
+std::shared_ptr<const InpDataSnapshot> InpDataProvider::Freeze() const
+{
+	std::unordered_map<QString, std::shared_ptr<const InpData>> libraries;
+	for (const auto& item : m_cache)
+		if (!item.inpData->empty() || item.released)
+			libraries.try_emplace(item.sourceLib.toLower(), item.inpData);
+
+	PLOGD << "inp data frozen: " << libraries.size() << " libraries, " << m_tables->data.size() << " files, " << m_tables->books.size() << " books";
+	return std::shared_ptr<const InpDataSnapshot>(new InpDataSnapshot(m_tables, std::move(libraries)));
+}
+
+InpDataSnapshot::InpDataSnapshot(std::shared_ptr<const InpDataTables> tables, std::unordered_map<QString, std::shared_ptr<const InpData>> libraries)
+	: m_tables { std::move(tables) }
+	, m_libraries { std::move(libraries) }
+{
+}
+
+InpDataSnapshot::~InpDataSnapshot() = default;
+
+const Book* InpDataSnapshot::GetBook(const UniqueFile::Uid& uid) const
+{
+	if (const auto it = m_tables->data.find(QString("%1#%2").arg(uid.folder, uid.file)); it != m_tables->data.end())
+		return it->second.get();
+
+	return m_libraries.size() == 1 ? FindBook(*m_libraries.begin()->second, uid.file) : nullptr;
+}
+
+const Book* InpDataSnapshot::GetBook(const QString& sourceLib, const UniqueFile::Uid& uid) const
+{
+	if (const auto it = m_tables->data.find(QString("%1#%2").arg(uid.folder, uid.file)); it != m_tables->data.end())
+		return it->second.get();
+
+	const auto it = m_libraries.find(sourceLib.toLower());
+	return it != m_libraries.end() ? FindBook(*it->second, uid.file) : nullptr;
+}
+
+const Book* InpDataSnapshot::GetBook(const QString& sourceLib, const QString& libId) const
+{
+	return FindBook(m_tables->libIdToBook, QString("%1_%2").arg(sourceLib.toLower(), libId));
+}
+
+const Book* InpDataSnapshot::GetBook(const QString& hash) const
+{
+	return FindBook(m_tables->hashToBook, hash);
+}
+
+std::span<const Book* const> InpDataSnapshot::Books() const noexcept
+{
+	const Book* const* books = m_tables->books.data();
+	return { books, m_tables->books.size() };
 }
 
 Book* InpDataProvider::SetFile(const UniqueFile::Uid& uid, QString id, const size_t size)
 {
 	const auto add = [&](std::shared_ptr<Book> bookSrc) {
-		auto& book   = m_data.try_emplace(QString("%1#%2").arg(uid.folder, uid.file), std::move(bookSrc)).first->second;
+		auto& book   = GetTables().data.try_emplace(QString("%1#%2").arg(uid.folder, uid.file), std::move(bookSrc)).first->second;
 		book->id     = std::move(id);
 		book->folder = uid.folder;
 		if (size != 0)
@@ -381,8 +536,8 @@ UniqueFileStorage::UniqueFileStorage(QString dstDir, const int hammingThreshold,
 	Util::ThreadPool<HashParserObserver> threadPool({ .maxQueueSize = static_cast<size_t>(std::thread::hardware_concurrency()) * 2, .contextGetter = [](auto) {
 														 return HashParserObserver {};
 													 } });
-	{
-		Util::Progress progress(static_cast<size_t>(xmlList.size()), "parsing");
+	auto observers = [&] {
+		Progress progress(static_cast<size_t>(xmlList.size()), "parsing");
 		for (const auto& xml : xmlList)
 		{
 			QFile file(srcDir.filePath(xml));
@@ -393,18 +548,21 @@ UniqueFileStorage::UniqueFileStorage(QString dstDir, const int hammingThreshold,
 				QBuffer buffer(&bytes);
 				buffer.open(QIODevice::ReadOnly);
 				Util::HashParser::Parse(buffer, observer);
-				progress.Increment(1, QFileInfo(xml).fileName().toStdString());
+				progress.Increment(1, [&] {
+					return QFileInfo(xml).fileName();
+				});
 			});
 		}
-	}
 
-	auto observers = threadPool.wait();
+		return threadPool.wait();
+	}();
+
 	erase_if(observers, [](const auto& item) {
 		return item.data.empty();
 	});
 
 	{
-		Util::Progress progress(observers.size(), "collect ready books");
+		Progress progress(observers.size(), "collect ready books");
 
 		for (auto&& observer : observers)
 		{
@@ -439,7 +597,9 @@ UniqueFileStorage::UniqueFileStorage(QString dstDir, const int hammingThreshold,
 				observerDataItem.second.clear();
 			}
 			observer.data.clear();
-			progress.Increment(1, std::to_string(m_old.size()));
+			progress.Increment(1, [this] {
+				return QString::number(m_old.size());
+			});
 		}
 	}
 
@@ -2,6 +2,7 @@
 
 #include <mutex>
 #include <set>
+#include <span>
 
 #include "fnd/NonCopyMovable.h"
 #include "fnd/algorithm.h"
@@ -39,6 +40,32 @@ struct LIB_EXPORT UniqueFile
 	void    ClearImages();
 };
 
+struct InpDataTables;
+
+class LIB_EXPORT InpDataSnapshot
+{
+	NON_COPY_MOVABLE(InpDataSnapshot)
+	friend class InpDataProvider;
+
+public:
+	~InpDataSnapshot();
+
+public:
+	const Book* GetBook(const UniqueFile::Uid& uid) const;
+	const Book* GetBook(const QString& sourceLib, const UniqueFile::Uid& uid) const;
+	const Book* GetBook(const QString& sourceLib, const QString& libId) const;
+	const Book* GetBook(const QString& hash) const;
+
+	std::span<const Book* const> Books() const noexcept;
+
+private:
+	InpDataSnapshot(std::shared_ptr<const InpDataTables> tables, std::unordered_map<QString, std::shared_ptr<const InpData>> libraries);
+
+private:
+	const std::shared_ptr<const InpDataTables>                        m_tables;
+	const std::unordered_map<QString, std::shared_ptr<const InpData>> m_libraries;
+};
+
 class LIB_EXPORT InpDataProvider
 {
 	NON_COPY_MOVABLE(InpDataProvider)
@@ -46,9 +73,16 @@ class LIB_EXPORT InpDataProvider
 private:
 	struct CacheItem
 	{
-		QString                sourceLib;
-		std::unique_ptr<IDump> dump;
-		InpData                inpData;
+		QString                  sourceLib;
+		std::unique_ptr<IDump>   dump;
+		std::shared_ptr<InpData> inpData { std::make_shared<InpData>() };
+		bool                     released { false };
+	};
+
+	struct ReleasedBook
+	{
+		size_t  cacheIndex;
+		QString libId;
 	};
 
 public:
@@ -60,6 +94,8 @@ public:
 	Book* GetBook(const QString& sourceLib, const QString& libId) const;
 	Book* GetBook(const QString& hash) const;
 	void  SetSourceLib(const QString& sourceLib);
+	void  Release(const QString& sourceLib);
+	Book* RestoreBook(const QString& hash);
 	Book* SetFile(const UniqueFile::Uid& uid, QString id, size_t size);
 	bool  Enumerate(std::function<bool(const QString&, const IDump&)> functor) const;
 	Book* AddBook(Book* book);
@@ -67,16 +103,21 @@ public:
 
 	const std::vector<Book*>& Books() const noexcept;
 
+	std::shared_ptr<const InpDataSnapshot> Freeze() const;
+
+private:
+	void           Load(CacheItem& item);
+	InpDataTables& GetTables();
+
 private:
 	InpData  m_stub;
 	InpData* m_currentInpData { &m_stub };
 
-	std::vector<CacheItem> m_cache;
-	InpData                m_data;
-	std::vector<Book*>     m_books;
+	std::vector<CacheItem>         m_cache;
+	std::shared_ptr<InpDataTables> m_tables;
 
-	std::unordered_map<QString, Book*> m_libIdToBook;
-	std::unordered_map<QString, Book*> m_hashToBook;
+	std::vector<std::shared_ptr<Book>>        m_retained;
+	std::unordered_map<QString, ReleasedBook> m_releasedHashes;
 };
 
 class LIB_EXPORT UniqueFileStorage
@@ -0,0 +1,350 @@
+#include "ZipStreamWriter.h"
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include <QFile>
+#include <QtEndian>
+
+#include <boost/crc.hpp>
+
+#include "log.h"
+
+using namespace HomeCompa::FliLib;
+
+namespace
+{
+
+constexpr uint32_t LOCAL_FILE_HEADER_SIGNATURE        = 0x04034b50;
+constexpr uint32_t CENTRAL_DIRECTORY_HEADER_SIGNATURE = 0x02014b50;
+constexpr uint32_t END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+constexpr uint32_t ZIP64_END_OF_CENTRAL_DIRECTORY     = 0x06064b50;
+constexpr uint32_t ZIP64_END_OF_CENTRAL_DIRECTORY_LOC = 0x07064b50;
+constexpr uint16_t ZIP64_EXTRA_FIELD_ID               = 0x0001;
+constexpr uint16_t VERSION_DEFAULT                    = 20;
+constexpr uint16_t VERSION_ZIP64                      = 45;
+constexpr uint16_t FLAG_UTF8                          = 1 << 11;
+constexpr uint16_t METHOD_STORED                      = 0;
+constexpr uint32_t UINT32_LIMIT                       = std::numeric_limits<uint32_t>::max();
+constexpr uint16_t UINT16_LIMIT                       = std::numeric_limits<uint16_t>::max();
+
+struct Entry
+{
+	QString    fileName;
+	QByteArray body;
+	QDateTime  time;
+};
+
+struct CentralDirectoryItem
+{
+	QByteArray fileName;
+	uint32_t   crc;
+	uint32_t   size;
+	uint16_t   time;
+	uint16_t   date;
+	uint64_t   offset;
+};
+
+template <typename T>
+void Append(QByteArray& bytes, const T value)
+{
+	const auto littleEndian = qToLittleEndian(value);
+	bytes.append(reinterpret_cast<const char*>(&littleEndian), sizeof littleEndian);
+}
+
+std::pair<uint16_t, uint16_t> ToDosTime(const QDateTime& dateTime)
+{
+	const auto value = dateTime.isValid() ? dateTime.toLocalTime() : QDateTime::currentDateTime();
+	const auto date  = value.date();
+	const auto time  = value.time();
+	if (date.year() < 1980)
+		return { 0, static_cast<uint16_t>(1 << 5 | 1) };
+
+	return {
+		static_cast<uint16_t>(time.hour() << 11 | time.minute() << 5 | time.second() / 2),
+		static_cast<uint16_t>((date.year() - 1980) << 9 | date.month() << 5 | date.day()),
+	};
+}
+
+} // namespace
+
+struct ZipStreamWriter::Impl
+{
+	QString      fileName;
+	QFile        file;
+	const size_t maxPendingSize;
+
+	std::mutex              guard;
+	std::condition_variable condition;
+	std::queue<Entry>       queue;
+	size_t                  pendingSize { 0 };
+	bool                    closing { false };
+	bool                    closed { false };
+	std::exception_ptr      error;
+
+	std::vector<CentralDirectoryItem> centralDirectory;
+	uint64_t                          offset { 0 };
+	QByteArray                        comment;
+
+	std::thread thread;
+
+	Impl(QString fileName_, const size_t maxPendingSize_)
+		: fileName { std::move(fileName_) }
+		, file { fileName + ".tmp" }
+		, maxPendingSize { maxPendingSize_ }
+	{
+		if (!file.open(QIODevice::WriteOnly))
+			throw std::ios_base::failure(QString("Cannot write to %1").arg(file.fileName()).toStdString());
+
+		thread = std::thread(&Impl::Process, this);
+	}
+
+	~Impl()
+	{
+		{
+			std::unique_lock lock(guard);
+			closing = true;
+			queue   = {};
+		}
+		condition.notify_all();
+
+		if (thread.joinable())
+			thread.join();
+
+		if (closed)
+			return;
+
+		file.close();
+		if (!file.remove())
+			PLOGW << "Cannot remove " << file.fileName();
+	}
+
+	void Add(Entry entry)
+	{
+		const auto size = static_cast<size_t>(entry.body.size());
+		{
+			std::unique_lock lock(guard);
+			condition.wait(lock, [&] {
+				return error || pendingSize == 0 || pendingSize + size <= maxPendingSize;
+			});
+
+			if (error)
+				std::rethrow_exception(error);
+
+			queue.push(std::move(entry));
+			pendingSize += size;
+		}
+		condition.notify_all();
+	}
+
+	size_t Close()
+	{
+		if (closed)
+			return centralDirectory.size();
+
+		{
+			std::unique_lock lock(guard);
+			closing = true;
+		}
+		condition.notify_all();
+		if (thread.joinable())
+			thread.join();
+
+		if (error)
+			std::rethrow_exception(error);
+
+		WriteCentralDirectory();
+		file.close();
+
+		std::error_code ec;
+		std::filesystem::rename(std::filesystem::path(file.fileName().toStdWString()), std::filesystem::path(fileName.toStdWString()), ec);
+		if (ec)
+			throw std::ios_base::failure(QString("Cannot rename %1 to %2: %3").arg(file.fileName(), fileName, QString::fromStdString(ec.message())).toStdString());
+
+		closed = true;
+		return centralDirectory.size();
+	}
+
+private:
+	void Process()
+	{
+		while (true)
+		{
+			Entry entry;
+			{
+				std::unique_lock lock(guard);
+				condition.wait(lock, [&] {
+					return closing || !queue.empty();
+				});
+
+				if (queue.empty())
+					return;
+
+				entry = std::move(queue.front());
+				queue.pop();
+			}
+
+			const auto size = static_cast<size_t>(entry.body.size());
+
+			try
+			{
+				WriteEntry(entry);
+			}
+			catch (...)
+			{
+				std::unique_lock lock(guard);
+				error       = std::current_exception();
+				queue       = {};
+				pendingSize = 0;
+				condition.notify_all();
+				return;
+			}
+
+			{
+				std::unique_lock lock(guard);
+				pendingSize -= size;
+			}
+			condition.notify_all();
+		}
+	}
+
+	void WriteEntry(const Entry& entry)
+	{
+		if (static_cast<uint64_t>(entry.body.size()) >= UINT32_LIMIT)
+			throw std::ios_base::failure(QString("%1 is too large").arg(entry.fileName).toStdString());
+
+		boost::crc_32_type crc;
+		crc.process_bytes(entry.body.constData(), static_cast<size_t>(entry.body.size()));
+
+		const auto [time, date] = ToDosTime(entry.time);
+		auto& item              = centralDirectory.emplace_back(entry.fileName.toUtf8(), crc.checksum(), static_cast<uint32_t>(entry.body.size()), time, date, offset);
+
+		QByteArray header;
+		Append(header, LOCAL_FILE_HEADER_SIGNATURE);
+		Append(header, VERSION_DEFAULT);
+		Append(header, FLAG_UTF8);
+		Append(header, METHOD_STORED);
+		Append(header, item.time);
+		Append(header, item.date);
+		Append(header, item.crc);
+		Append(header, item.size);
+		Append(header, item.size);
+		Append(header, static_cast<uint16_t>(item.fileName.size()));
+		Append(header, uint16_t { 0 });
+		header.append(item.fileName);
+
+		Write(header);
+		Write(entry.body);
+	}
+
+	void WriteCentralDirectory()
+	{
+		const auto centralDirectoryOffset = offset;
+
+		QByteArray bytes;
+		for (const auto& item : centralDirectory)
+		{
+			const auto zip64 = item.offset >= UINT32_LIMIT;
+
+			Append(bytes, CENTRAL_DIRECTORY_HEADER_SIGNATURE);
+			Append(bytes, VERSION_ZIP64);
+			Append(bytes, zip64 ? VERSION_ZIP64 : VERSION_DEFAULT);
+			Append(bytes, FLAG_UTF8);
+			Append(bytes, METHOD_STORED);
+			Append(bytes, item.time);
+			Append(bytes, item.date);
+			Append(bytes, item.crc);
+			Append(bytes, item.size);
+			Append(bytes, item.size);
+			Append(bytes, static_cast<uint16_t>(item.fileName.size()));
+			Append(bytes, static_cast<uint16_t>(zip64 ? 2 * sizeof(uint16_t) + sizeof(uint64_t) : 0));
+			Append(bytes, uint16_t { 0 });
+			Append(bytes, uint16_t { 0 });
+			Append(bytes, uint16_t { 0 });
+			Append(bytes, uint32_t { 0 });
+			Append(bytes, zip64 ? UINT32_LIMIT : static_cast<uint32_t>(item.offset));
+			bytes.append(item.fileName);
+			if (zip64)
+			{
+				Append(bytes, ZIP64_EXTRA_FIELD_ID);
+				Append(bytes, static_cast<uint16_t>(sizeof(uint64_t)));
+				Append(bytes, item.offset);
+			}
+
+			if (bytes.size() > 1024 * 1024)
+				Write(std::exchange(bytes, {}));
+		}
+		Write(bytes);
+
+		const auto centralDirectorySize = offset - centralDirectoryOffset;
+		const auto count                = static_cast<uint64_t>(centralDirectory.size());
+		const auto zip64                = count >= UINT16_LIMIT || centralDirectoryOffset >= UINT32_LIMIT || centralDirectorySize >= UINT32_LIMIT;
+
+		bytes.clear();
+		if (zip64)
+		{
+			const auto zip64EndOffset = offset;
+			Append(bytes, ZIP64_END_OF_CENTRAL_DIRECTORY);
+			Append(bytes, uint64_t { 44 });
+			Append(bytes, VERSION_ZIP64);
+			Append(bytes, VERSION_ZIP64);
+			Append(bytes, uint32_t { 0 });
+			Append(bytes, uint32_t { 0 });
+			Append(bytes, count);
+			Append(bytes, count);
+			Append(bytes, centralDirectorySize);
+			Append(bytes, centralDirectoryOffset);
+
+			Append(bytes, ZIP64_END_OF_CENTRAL_DIRECTORY_LOC);
+			Append(bytes, uint32_t { 0 });
+			Append(bytes, zip64EndOffset);
+			Append(bytes, uint32_t { 1 });
+		}
+
+		Append(bytes, END_OF_CENTRAL_DIRECTORY_SIGNATURE);
+		Append(bytes, uint16_t { 0 });
+		Append(bytes, uint16_t { 0 });
+		Append(bytes, static_cast<uint16_t>(std::min<uint64_t>(count, UINT16_LIMIT)));
+		Append(bytes, static_cast<uint16_t>(std::min<uint64_t>(count, UINT16_LIMIT)));
+		Append(bytes, static_cast<uint32_t>(std::min<uint64_t>(centralDirectorySize, UINT32_LIMIT)));
+		Append(bytes, static_cast<uint32_t>(std::min<uint64_t>(centralDirectoryOffset, UINT32_LIMIT)));
+		Append(bytes, static_cast<uint16_t>(comment.size()));
+		bytes.append(comment);
+		Write(bytes);
+	}
+
+	void Write(const QByteArray& bytes)
+	{
+		if (file.write(bytes) != bytes.size())
+			throw std::ios_base::failure(QString("Cannot write to %1: %2").arg(file.fileName(), file.errorString()).toStdString());
+		offset += static_cast<uint64_t>(bytes.size());
+	}
+};
+
+ZipStreamWriter::ZipStreamWriter(QString fileName, const size_t maxPendingSize)
+	: m_impl { std::make_unique<Impl>(std::move(fileName), maxPendingSize) }
+{
+}
+
+ZipStreamWriter::~ZipStreamWriter() = default;
+
+void ZipStreamWriter::Add(QString fileName, QByteArray body, const QDateTime& time)
+{
+	m_impl->Add({ std::move(fileName), std::move(body), time });
+}
+
+void ZipStreamWriter::SetComment(QByteArray comment)
+{
+	if (comment.size() >= UINT16_LIMIT)
+		throw std::invalid_argument("zip comment is too long");
+
+	m_impl->comment = std::move(comment);
+}
+
+size_t ZipStreamWriter::Close()
+{
+	return m_impl->Close();
+}
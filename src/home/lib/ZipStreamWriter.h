@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+
+#include "fnd/NonCopyMovable.h"
+
+#include "export/lib.h"
+
+namespace HomeCompa::FliLib
+{
+
+class LIB_EXPORT ZipStreamWriter
+{
+	NON_COPY_MOVABLE(ZipStreamWriter)
+
+public:
+	static constexpr size_t DEFAULT_MAX_PENDING_SIZE = 64ULL * 1024 * 1024;
+
+public:
+	explicit ZipStreamWriter(QString fileName, size_t maxPendingSize = DEFAULT_MAX_PENDING_SIZE);
+	~ZipStreamWriter();
+
+public:
+	void   Add(QString fileName, QByteArray body, const QDateTime& time = {});
+	void   SetComment(QByteArray comment);
+	size_t Close();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace HomeCompa::FliLib
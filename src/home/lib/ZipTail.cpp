@@ -0,0 +1,154 @@
+#include "ZipTail.h"
+
+#include <QFile>
+#include <QtEndian>
+
+namespace HomeCompa::FliLib
+{
+
+namespace
+{
+
+constexpr uint32_t CENTRAL_DIRECTORY_HEADER_SIGNATURE  = 0x02014b50;
+constexpr uint32_t END_OF_CENTRAL_DIRECTORY_SIGNATURE  = 0x06054b50;
+constexpr uint32_t ZIP64_END_OF_CENTRAL_DIRECTORY      = 0x06064b50;
+constexpr uint32_t ZIP64_END_OF_CENTRAL_DIRECTORY_LOC  = 0x07064b50;
+constexpr qint64   CENTRAL_DIRECTORY_HEADER_SIZE       = 46;
+constexpr qint64   END_OF_CENTRAL_DIRECTORY_SIZE       = 22;
+constexpr qint64   ZIP64_LOCATOR_SIZE                  = 20;
+constexpr qint64   ZIP64_END_OF_CENTRAL_DIRECTORY_SIZE = 56;
+constexpr qint64   MAX_COMMENT_SIZE                    = 0xFFFF;
+constexpr uint16_t ZIP64_EXTRA_FIELD_ID                = 0x0001;
+constexpr uint32_t UINT32_LIMIT                        = std::numeric_limits<uint32_t>::max();
+
+template <typename T>
+T Get(const QByteArray& bytes, const qsizetype pos)
+{
+	if (pos < 0 || pos + static_cast<qsizetype>(sizeof(T)) > bytes.size())
+		throw std::ios_base::failure("unexpected end of zip record");
+	return qFromLittleEndian<T>(bytes.constData() + pos);
+}
+
+QByteArray Read(QFile& file, const qint64 pos, const qint64 size)
+{
+	if (!file.seek(pos))
+		throw std::ios_base::failure(QString("Cannot seek %1").arg(file.fileName()).toStdString());
+	auto bytes = file.read(size);
+	if (bytes.size() != size)
+		throw std::ios_base::failure(QString("Cannot read %1").arg(file.fileName()).toStdString());
+	return bytes;
+}
+
+} // namespace
+
+ZipTail ReadZipTail(const QString& fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		throw std::ios_base::failure(QString("Cannot open %1").arg(fileName).toStdString());
+
+	const auto fileSize = file.size();
+	const auto tailSize = std::min(fileSize, END_OF_CENTRAL_DIRECTORY_SIZE + MAX_COMMENT_SIZE);
+	const auto tailPos  = fileSize - tailSize;
+	const auto tail     = Read(file, tailPos, tailSize);
+
+	for (auto pos = tail.size() - END_OF_CENTRAL_DIRECTORY_SIZE; pos >= 0; --pos)
+	{
+		if (Get<uint32_t>(tail, pos) != END_OF_CENTRAL_DIRECTORY_SIGNATURE)
+			continue;
+
+		const auto commentSize = Get<uint16_t>(tail, pos + 20);
+		if (pos + END_OF_CENTRAL_DIRECTORY_SIZE + commentSize != tail.size())
+			continue;
+
+		ZipTail result {
+			.centralDirectoryOffset = Get<uint32_t>(tail, pos + 16),
+			.centralDirectorySize   = Get<uint32_t>(tail, pos + 12),
+			.entryCount             = Get<uint16_t>(tail, pos + 10),
+			.comment                = tail.mid(pos + END_OF_CENTRAL_DIRECTORY_SIZE, commentSize),
+		};
+
+		const auto endPos = tailPos + pos;
+		if (endPos < ZIP64_LOCATOR_SIZE)
+			return result;
+
+		const auto locator = Read(file, endPos - ZIP64_LOCATOR_SIZE, ZIP64_LOCATOR_SIZE);
+		if (Get<uint32_t>(locator, 0) != ZIP64_END_OF_CENTRAL_DIRECTORY_LOC)
+			return result;
+
+		const auto zip64EndPos = Get<uint64_t>(locator, 8);
+		if (zip64EndPos > static_cast<uint64_t>(endPos))
+			throw std::ios_base::failure(QString("%1: invalid zip64 locator").arg(fileName).toStdString());
+
+		const auto zip64End = Read(file, static_cast<qint64>(zip64EndPos), ZIP64_END_OF_CENTRAL_DIRECTORY_SIZE);
+		if (Get<uint32_t>(zip64End, 0) != ZIP64_END_OF_CENTRAL_DIRECTORY)
+			throw std::ios_base::failure(QString("%1: invalid zip64 end of central directory").arg(fileName).toStdString());
+
+		result.entryCount             = Get<uint64_t>(zip64End, 32);
+		result.centralDirectorySize   = Get<uint64_t>(zip64End, 40);
+		result.centralDirectoryOffset = Get<uint64_t>(zip64End, 48);
+		return result;
+	}
+
+	throw std::ios_base::failure(QString("%1: end of central directory not found").arg(fileName).toStdString());
+}
+
+QByteArray ReadCentralDirectory(const QString& fileName, const ZipTail& tail)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		throw std::ios_base::failure(QString("Cannot open %1").arg(fileName).toStdString());
+
+	if (tail.centralDirectoryOffset + tail.centralDirectorySize > static_cast<uint64_t>(file.size()))
+		throw std::ios_base::failure(QString("%1: central directory is out of file bounds").arg(fileName).toStdString());
+
+	return Read(file, static_cast<qint64>(tail.centralDirectoryOffset), static_cast<qint64>(tail.centralDirectorySize));
+}
+
+std::vector<ZipEntry> ParseCentralDirectory(const QByteArray& centralDirectory)
+{
+	std::vector<ZipEntry> result;
+	for (qsizetype pos = 0; pos < centralDirectory.size();)
+	{
+		if (Get<uint32_t>(centralDirectory, pos) != CENTRAL_DIRECTORY_HEADER_SIGNATURE)
+			throw std::ios_base::failure("invalid central directory header signature");
+
+		const auto nameSize    = Get<uint16_t>(centralDirectory, pos + 28);
+		const auto extraSize   = Get<uint16_t>(centralDirectory, pos + 30);
+		const auto commentSize = Get<uint16_t>(centralDirectory, pos + 32);
+		const auto namePos     = pos + CENTRAL_DIRECTORY_HEADER_SIZE;
+		if (namePos + nameSize + extraSize + commentSize > centralDirectory.size())
+			throw std::ios_base::failure("central directory record is out of bounds");
+
+		auto& entry          = result.emplace_back();
+		entry.fileName       = QString::fromUtf8(centralDirectory.mid(namePos, nameSize));
+		entry.crc            = Get<uint32_t>(centralDirectory, pos + 16);
+		entry.compressedSize = Get<uint32_t>(centralDirectory, pos + 20);
+		entry.size           = Get<uint32_t>(centralDirectory, pos + 24);
+		entry.offset         = Get<uint32_t>(centralDirectory, pos + 42);
+
+		for (auto extraPos = namePos + nameSize, extraEnd = extraPos + extraSize; extraPos + 4 <= extraEnd;)
+		{
+			const auto id       = Get<uint16_t>(centralDirectory, extraPos);
+			const auto size     = Get<uint16_t>(centralDirectory, extraPos + 2);
+			auto       fieldPos = extraPos + 4;
+			extraPos            = fieldPos + size;
+			if (id != ZIP64_EXTRA_FIELD_ID)
+				continue;
+
+			for (auto* value : { &entry.size, &entry.compressedSize, &entry.offset })
+			{
+				if (*value != UINT32_LIMIT || fieldPos + 8 > extraPos)
+					continue;
+				*value = Get<uint64_t>(centralDirectory, fieldPos);
+				fieldPos += 8;
+			}
+		}
+
+		pos = namePos + nameSize + extraSize + commentSize;
+	}
+
+	return result;
+}
+
+} // namespace HomeCompa::FliLib
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+#include "export/lib.h"
+
+namespace HomeCompa::FliLib
+{
+
+struct ZipTail
+{
+	uint64_t   centralDirectoryOffset { 0 };
+	uint64_t   centralDirectorySize { 0 };
+	uint64_t   entryCount { 0 };
+	QByteArray comment;
+};
+
+struct ZipEntry
+{
+	QString  fileName;
+	uint32_t crc { 0 };
+	uint64_t compressedSize { 0 };
+	uint64_t size { 0 };
+	uint64_t offset { 0 };
+};
+
+LIB_EXPORT ZipTail               ReadZipTail(const QString& fileName);
+LIB_EXPORT QByteArray            ReadCentralDirectory(const QString& fileName, const ZipTail& tail);
+LIB_EXPORT std::vector<ZipEntry> ParseCentralDirectory(const QByteArray& centralDirectory);
+
+} // namespace HomeCompa::FliLib
@@ -377,13 +377,16 @@ private: // IDatabase
 		return table;
 	}
 
-	void CreateInpData(const std::function<void(const DB::IQuery&)>& functor) const override
+	void CreateInpData(const std::function<void(const DB::IQuery&)>& functor, const QString& libId) const override
 	{
-		const auto query = m_db->CreateQuery(R"(
+		const auto filter = libId.isEmpty() ? std::string {} : std::format("where b.BookId = {}", libId.toLongLong());
+		const auto query  = m_db->CreateQuery(std::format(
+			R"(
 with Books(  BookId,         Title,   FileSize,   LibID,    Deleted,                                FileType,   Time,   Lang,   Keywords, Year,              Hash, LibRateSum , LibRateCount) as (
     select b.BookId, trim(b.Title), b.FileSize, b.BookId, b.Deleted, coalesce(nullif(b.FileType, ''), 'fb2'), b.Time, b.Lang, b.keywords, nullif(b.Year, 0), md5 , sum(r.Rate), count(r.Rate)
         from libbook b
         left join librate r on r.BookID = b.BookId
+        {}
         group by b.BookId
 )
 select
@@ -414,7 +417,9 @@ from Books b
 left join libseq ls on ls.BookID = b.BookID
 left join libseqname s on s.SeqID = ls.SeqID
 left join libfilename f on f.BookId=b.BookID
-)");
+)",
+			filter
+		));
 
 		PLOGV << GetName() << " records selection started";
 
@@ -45,9 +45,9 @@ public:
 
 	virtual const QString& GetName() const noexcept = 0;
 
-	virtual void CreateInpData(const std::function<void(const DB::IQuery&)>& functor) const = 0;
-	virtual void CreateTables(const std::function<void(std::string_view)>& functor) const   = 0;
-	virtual void CreateIndices(const std::function<void(std::string_view)>& functor) const  = 0;
+	virtual void CreateInpData(const std::function<void(const DB::IQuery&)>& functor, const QString& libId) const = 0;
+	virtual void CreateTables(const std::function<void(std::string_view)>& functor) const                         = 0;
+	virtual void CreateIndices(const std::function<void(std::string_view)>& functor) const                        = 0;
 
 	virtual void CreateAdditional(const std::filesystem::path& sqlDir, const std::filesystem::path& dstDir, AdditionalType additionalType) const = 0;
 
@@ -193,13 +193,16 @@ private: // IDatabase
 		return table;
 	}
 
-	void CreateInpData(const std::function<void(const DB::IQuery&)>& functor) const override
+	void CreateInpData(const std::function<void(const DB::IQuery&)>& functor, const QString& libId) const override
 	{
-		const auto query = m_db->CreateQuery(R"(
+		const auto filter = libId.isEmpty() ? std::string {} : std::format("where b.bid = {}", libId.toLongLong());
+		const auto query  = m_db->CreateQuery(std::format(
+			R"(
 with Books(BookId,         Title,   FileSize, LibID,   Deleted,                                FileType,   Time,   Lang,   Keywords,              Year, Hash , LibRateSum , LibRateCount) as (
     select  b.bid, trim(b.Title), b.FileSize, b.bid, b.Deleted, coalesce(nullif(b.FileType, ''), 'fb2'), b.Time, b.Lang, b.keywords, nullif(b.Year, 0), b.md5, sum(r.Rate), count(r.Rate)
         from libbook b
         left join librate r on r.bid = b.bid
+        {}
         group by b.bid
 )
 select
@@ -223,7 +226,9 @@ select
 from Books b
 left join libseq ls on ls.bid = b.BookID
 left join libseqs s on s.sid = ls.sid
-)");
+)",
+			filter
+		));
 
 		PLOGV << GetName() << " records selection started";
 
@@ -70,12 +70,13 @@ QString& ReplaceTags(QString& str)
 	return str;
 }
 
-InpData CreateInpData(const IDump& dump)
+InpData CreateInpData(const IDump& dump, const QString& libIdFilter)
 {
 	InpData inpData;
 
 	size_t n = 0;
-	dump.CreateInpData([&](const DB::IQuery& query) {
+
+	const auto add = [&](const DB::IQuery& query) {
 		QString libId = query.Get<const char*>(7);
 
 		QString fileName = query.Get<const char*>(5);
@@ -129,7 +130,8 @@ InpData CreateInpData(const IDump& dump)
 
 		++n;
 		PLOGV_IF(n % 50000 == 0) << n << " records selected";
-	});
+	};
+	dump.CreateInpData(add, libIdFilter);
 
 	PLOGV << n << " total records selected";
 
@@ -34,6 +34,7 @@ class FLibrary(ConanFile):
         self.requires("libjxl/0.11.2")
         self.requires("cimg/3.3.2")
         self.requires("sqlite3/3.51.0")
+        self.requires("zlib/1.3.1")
 
     def configure(self):
         configure_boost(self)
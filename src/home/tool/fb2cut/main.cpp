@@ -1,5 +1,6 @@
 #include <condition_variable>
 #include <expected>
+#include <functional>
 #include <queue>
 #include <ranges>
 
@@ -15,7 +16,6 @@
 #include <QTextCodec>
 #include <QTranslator>
 
-#include <plog/Appenders/ConsoleAppender.h>
 #include <plog/Formatters/TxtFormatter.h>
 #include <plog/Record.h>
 #include <plog/Util.h>
@@ -26,14 +26,20 @@
 #include "fnd/algorithm.h"
 
 #include "jxl/jxl.h"
+#include "lib/AsyncAppender.h"
 #include "lib/ImageItem.h"
+#include "lib/ImageScaler.h"
+#include "lib/Metrics.h"
+#include "lib/Prefetcher.h"
+#include "lib/Progress.h"
+#include "lib/Resources.h"
+#include "lib/Shard.h"
+#include "lib/Trace.h"
 #include "lib/book.h"
-#include "logging/LogAppender.h"
 #include "logging/init.h"
 #include "util/ImageUtil.h"
 #include "util/LogConsoleFormatter.h"
 #include "util/files.h"
-#include "util/progress.h"
 #include "util/xml/Initializer.h"
 #include "util/xml/Validator.h"
 
@@ -52,6 +58,8 @@ namespace
 {
 
 constexpr auto APP_ID                     = "fb2cut";
+constexpr auto PART_MARKER_EXTENSION      = ".done";
+constexpr auto PART_STATISTICS_EXTENSION  = ".statistics";
 constexpr auto MAX_SIZE_OPTION_NAME       = "max-size";
 constexpr auto MAX_COVER_SIZE_OPTION_NAME = "max-cover-size";
 constexpr auto MAX_IMAGE_SIZE_OPTION_NAME = "max-image-size";
@@ -83,6 +91,8 @@ constexpr auto PATH        = "path";
 constexpr auto COMMANDLINE = "list of options";
 constexpr auto SIZE        = "size [INT_MAX,INT_MAX]";
 
+constexpr auto IMAGE_STATISTICS_HEADER = "#ARCHIVE|FB2_FILE|IMAGE_ID|FAIL_INFO|IS_COVER|PIXEL_TYPE|IMAGE_FILE_SIZE|WIDTH|HEIGHT|HASH\n";
+
 struct DataItem
 {
 	QString    fileName;
@@ -151,7 +161,7 @@ public:
 		std::mutex&              fileSystemGuard,
 		std::atomic_bool&        hasError,
 		std::atomic_int&         queueSize,
-		Util::Progress&          progress,
+		FliLib::Progress&        progress,
 		IClient&                 client,
 		const Decoder&           decoder
 	)
@@ -206,6 +216,7 @@ private:
 			if (ProcessFile(name, body, dateTime))
 			{
 				m_hasError = true;
+				m_progress.AddError();
 				PLOGE << "processed with error: " << name;
 			}
 		}
@@ -215,8 +226,10 @@ private:
 
 	bool ProcessFile(const QString& inputFilePath, const QByteArray& inputFileBody, const QDateTime& dateTime)
 	{
+		const FliLib::TraceSpan span("ProcessFile", inputFilePath);
 		const ScopedCall logGuard([&] {
-			m_progress.Increment(1, inputFilePath.toStdString());
+			m_progress.AddBytes(static_cast<size_t>(inputFileBody.size()));
+			m_progress.Increment(1, inputFilePath);
 		});
 
 		const QFileInfo fileInfo(inputFilePath);
@@ -295,6 +308,7 @@ private:
 		IParser::ImageMapper             idToNum;
 
 		auto binaryCallback = [&](QString&& name, const bool isCover, QByteArray body) {
+			const FliLib::TraceSpan span(isCover ? "ProcessCover" : "ProcessImage", name);
 			ImageStatisticsItem::PixelSchema pixelSchema = ImageStatisticsItem::PixelSchema::Unknown;
 
 			int         width  = 0;
@@ -357,11 +371,11 @@ private:
 				pixelSchema = hasAlpha ? ImageStatisticsItem::PixelSchema::Alpha : ImageStatisticsItem::PixelSchema::Normal;
 
 			if (image.width() > settings.maxSize.width() || image.height() > settings.maxSize.height())
-				image = image.scaled(settings.maxSize.width(), settings.maxSize.height(), Qt::KeepAspectRatio, hasAlpha ? Qt::FastTransformation : Qt::SmoothTransformation);
+				image = FliLib::Scale(image, image.size().scaled(settings.maxSize, Qt::KeepAspectRatio));
 
 			m_hash.reset();
-			for (auto h = 0, szH = image.height(), szW = image.width(); h < szH; ++h)
-				m_hash.addData(QByteArrayView { std::bit_cast<const char*>(image.constScanLine(h)), static_cast<qsizetype>(szW) * pixelFormat.channelCount() });
+			for (auto h = 0, szH = image.height(), szW = image.width(), channelCount = image.pixelFormat().channelCount(); h < szH; ++h)
+				m_hash.addData(QByteArrayView { std::bit_cast<const char*>(image.constScanLine(h)), static_cast<qsizetype>(szW) * channelCount });
 			auto hash = QString::fromUtf8(m_hash.result().toHex());
 
 			if (const auto it = uniqueData.find(hash); it != uniqueData.end())
@@ -575,7 +589,7 @@ private:
 
 	std::atomic_bool& m_hasError;
 	std::atomic_int&  m_queueSize;
-	Util::Progress&   m_progress;
+	FliLib::Progress& m_progress;
 
 	QCryptographicHash m_hash { QCryptographicHash::Md5 };
 	ImageStatistics    m_imageStatistics;
@@ -597,6 +611,21 @@ QString GetImagesFolder(const QDir& dir, const QString& type)
 	return QString("%1/%2/%3.zip").arg(fileInfo.dir().path(), type, fileInfo.fileName());
 }
 
+void SetupImageArchive(Zip& zip, const int maxThreadCount)
+{
+	zip.SetProperty(Zip::PropertyId::CompressionLevel, QVariant::fromValue(Zip::CompressionLevel::Ultra));
+	zip.SetProperty(Zip::PropertyId::ThreadsCount, maxThreadCount);
+}
+
+void SetupFb2Archive(Zip& zip, const Settings& settings, const bool isEpub)
+{
+	zip.SetProperty(Zip::PropertyId::CompressionLevel, QVariant::fromValue(isEpub ? Zip::CompressionLevel::None : Zip::CompressionLevel::Ultra));
+	zip.SetProperty(Zip::PropertyId::SolidArchive, false);
+	zip.SetProperty(Zip::PropertyId::ThreadsCount, settings.maxThreadCount);
+	if (settings.format == Zip::Format::SevenZip)
+		zip.SetProperty(Zip::PropertyId::CompressionMethod, QVariant::fromValue(isEpub ? Zip::CompressionMethod::Copy : Zip::CompressionMethod::Ppmd));
+}
+
 class FileProcessor final : public Worker::IClient
 {
 public:
@@ -607,7 +636,7 @@ public:
 		std::condition_variable& queueCondition,
 		std::mutex&              queueGuard,
 		const int                poolSize,
-		Util::Progress&          progress,
+		FliLib::Progress&        progress,
 		QTextStream*             imageStatisticsStream,
 		const Decoder&           decoder
 	)
@@ -661,7 +690,8 @@ private:
 		if (!saveFlag || images.empty())
 			return;
 
-		const auto archiveFileName = GetImagesFolder(m_dstDir, type);
+		const FliLib::TraceSpan span("ArchiveImages", type);
+		const auto              archiveFileName = GetImagesFolder(m_dstDir, type);
 		PLOGI << "archive " << archiveFileName << ", total:" << images.size();
 
 		QFile::remove(archiveFileName);
@@ -691,8 +721,7 @@ private:
 			zipFiles->AddFile(std::move(image.fileName), image.body, std::move(image.dateTime));
 
 		Zip zip(archiveFileName, Zip::Format::Zip);
-		zip.SetProperty(Zip::PropertyId::CompressionLevel, QVariant::fromValue(Zip::CompressionLevel::Ultra));
-		zip.SetProperty(Zip::PropertyId::ThreadsCount, m_maxThreadCount);
+		SetupImageArchive(zip, m_maxThreadCount);
 		zip.Write(*zipFiles);
 
 		images.clear();
@@ -797,6 +826,7 @@ bool ArchiveFb2(const Settings& settings)
 	if (!settings.archiveFb2)
 		return false;
 
+	const FliLib::TraceSpan span("ArchiveFb2", settings.dstDir.dirName());
 	if (!settings.archiver.isEmpty())
 		return ArchiveFb2External(settings);
 
@@ -833,11 +863,7 @@ bool ArchiveFb2(const Settings& settings)
 	const auto isEpub = epubCount * 10 > 9 * zipFiles->GetCount();
 
 	Zip zip(dstArchiveFileName, settings.format);
-	zip.SetProperty(Zip::PropertyId::CompressionLevel, QVariant::fromValue(isEpub ? Zip::CompressionLevel::None : Zip::CompressionLevel::Ultra));
-	zip.SetProperty(Zip::PropertyId::SolidArchive, false);
-	zip.SetProperty(Zip::PropertyId::ThreadsCount, settings.maxThreadCount);
-	if (settings.format == Zip::Format::SevenZip)
-		zip.SetProperty(Zip::PropertyId::CompressionMethod, QVariant::fromValue(isEpub ? Zip::CompressionMethod::Copy : Zip::CompressionMethod::Ppmd));
+	SetupFb2Archive(zip, settings, isEpub);
 
 	const auto result = zip.Write(*zipFiles);
 	if (result)
@@ -846,21 +872,22 @@ bool ArchiveFb2(const Settings& settings)
 	return !result;
 }
 
-bool ProcessArchiveImpl(const QString& archive, Settings settings, const IEncodingDetector& encodingDetector, Util::Progress& progress, QTextStream* imageStatisticsStream, const Decoder& decoder)
+bool ProcessArchiveImpl(const FliLib::ShardItem& item, Settings settings, const IEncodingDetector& encodingDetector, FliLib::Progress& progress, QTextStream* imageStatisticsStream, const Decoder& decoder)
 {
-	const QFileInfo fileInfo(archive);
-	settings.dstDir = QDir(settings.dstDir.filePath(fileInfo.completeBaseName()));
+	const QFileInfo         fileInfo(item.archive);
+	const FliLib::TraceSpan span("ProcessArchive", item.GetName());
+	settings.dstDir = QDir(settings.dstDir.filePath(item.GetName()));
 	if (!settings.dstDir.exists() && !settings.dstDir.mkpath("."))
 	{
 		PLOGE << QString("Cannot create folder %1").arg(settings.dstDir.path());
 		return true;
 	}
 
-	const Zip  zip(archive);
-	auto       fileList         = zip.GetFileNameList() | std::views::reverse | std::ranges::to<QStringList>();
+	const Zip  zip(item.archive);
+	auto       fileList         = zip.GetFileNameList().mid(static_cast<qsizetype>(item.begin), static_cast<qsizetype>(item.end - item.begin)) | std::views::reverse | std::ranges::to<QStringList>();
 	const auto fileListCount    = static_cast<size_t>(fileList.size());
 	const auto currentFileCount = progress.GetCount();
-	PLOGI << QString("%1 processing, total files: %2").arg(fileInfo.fileName()).arg(fileListCount);
+	PLOGI << QString("%1 processing, total files: %2").arg(item.GetName()).arg(fileListCount);
 
 	auto hasError = [&] {
 		const auto maxThreadCount = std::min(std::max(settings.maxThreadCount, 1), static_cast<int>(fileListCount));
@@ -882,7 +909,7 @@ bool ProcessArchiveImpl(const QString& archive, Settings settings, const IEncodi
 				else
 				{
 					PLOGW << fileList.front() << " is empty";
-					progress.Increment(1, fileList.front().toStdString());
+					progress.Increment(1, fileList.front());
 				}
 				fileList.pop_front();
 			}
@@ -910,10 +937,10 @@ bool ProcessArchiveImpl(const QString& archive, Settings settings, const IEncodi
 	const auto fileCount = progress.GetCount();
 	if (fileCount - currentFileCount != fileListCount)
 	{
-		PLOGE << QString("something strange: %1 files in archive %2 but processed %3").arg(fileListCount).arg(fileInfo.fileName()).arg(fileCount - currentFileCount);
+		PLOGE << QString("something strange: %1 files in archive %2 but processed %3").arg(fileListCount).arg(item.GetName()).arg(fileCount - currentFileCount);
 	}
 
-	const auto resultReport = QString("%1 (%2 of %3 files) processed %4").arg(fileInfo.fileName()).arg(fileCount - currentFileCount).arg(fileListCount).arg(hasError ? "with errors" : "successfully");
+	const auto resultReport = QString("%1 (%2 of %3 files) processed %4").arg(item.GetName()).arg(fileCount - currentFileCount).arg(fileListCount).arg(hasError ? "with errors" : "successfully");
 	if (hasError)
 		PLOGW << resultReport;
 	else
@@ -922,24 +949,220 @@ bool ProcessArchiveImpl(const QString& archive, Settings settings, const IEncodi
 	return hasError;
 }
 
-bool ProcessArchive(const QString& file, const Settings& settings, const IEncodingDetector& encodingDetector, Util::Progress& progress, QTextStream* imageStatisticsStream, const Decoder& decoder)
+QString GetPartMarker(const Settings& settings, const QString& name)
+{
+	return settings.dstDir.filePath(name + PART_MARKER_EXTENSION);
+}
+
+QString GetPartStatistics(const Settings& settings, const QString& name)
+{
+	return settings.dstDir.filePath(name + PART_STATISTICS_EXTENSION);
+}
+
+bool ProcessArchive(const FliLib::ShardItem& item, const Settings& settings, const IEncodingDetector& encodingDetector, FliLib::Progress& progress, QTextStream* imageStatisticsStream, const Decoder& decoder)
 {
 	try
 	{
-		return ProcessArchiveImpl(file, settings, encodingDetector, progress, imageStatisticsStream, decoder);
+		// a part keeps its own statistics, the merge step takes them together with the part marker, so a failed part adds no rows
+		QFile                        partStatisticsFile;
+		std::unique_ptr<QTextStream> partStatisticsStream;
+		if (item.IsPart())
+		{
+			QFile::remove(GetPartMarker(settings, item.GetName()));
+			if (imageStatisticsStream)
+			{
+				partStatisticsFile.setFileName(GetPartStatistics(settings, item.GetName()));
+				if (!partStatisticsFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+					throw std::ios_base::failure(QString("Cannot write to %1").arg(partStatisticsFile.fileName()).toStdString());
+				partStatisticsStream  = std::make_unique<QTextStream>(&partStatisticsFile);
+				imageStatisticsStream = partStatisticsStream.get();
+			}
+		}
+
+		const auto hasError = ProcessArchiveImpl(item, settings, encodingDetector, progress, imageStatisticsStream, decoder);
+		if (item.IsPart() && !hasError)
+		{
+			// the merge step takes only parts having a marker, so a crashed or failed part is never merged
+			if (QFile marker(GetPartMarker(settings, item.GetName())); !marker.open(QIODevice::WriteOnly))
+				throw std::ios_base::failure(QString("Cannot create %1").arg(marker.fileName()).toStdString());
+		}
+		return hasError;
 	}
 	catch (const std::exception& ex)
 	{
-		PLOGE << QString("%1 processing failed: %2").arg(file).arg(ex.what());
+		PLOGE << QString("%1 processing failed: %2").arg(item.GetName()).arg(ex.what());
 	}
 	catch (...)
 	{
-		PLOGE << QString("%1 processing failed").arg(file);
+		PLOGE << QString("%1 processing failed").arg(item.GetName());
 	}
 
 	return true;
 }
 
+QStringList MergeArchiveParts(const QStringList& parts, const QString& dstArchiveFileName, const std::function<void(Zip&, bool)>& setup, const Zip::Format format, const bool required)
+{
+	auto        zipFiles  = Zip::CreateZipFileController();
+	size_t      epubCount = 0;
+	QStringList merged;
+	for (const auto& part : parts)
+	{
+		if (!QFile::exists(part))
+		{
+			if (required)
+				throw std::ios_base::failure(QString("%1 not found").arg(part).toStdString());
+			continue;
+		}
+
+		const Zip zip(part);
+		for (const auto& fileName : zip.GetFileNameList())
+		{
+			if (fileName.endsWith(".epub", Qt::CaseInsensitive))
+				++epubCount;
+			zipFiles->AddFile(fileName, zip.Read(fileName)->GetStream().readAll(), zip.GetFileTime(fileName));
+		}
+		merged << part;
+	}
+
+	if (merged.isEmpty())
+		return merged;
+
+	const FliLib::TraceSpan span("MergeArchive", dstArchiveFileName);
+	PLOGI << "archive " << dstArchiveFileName << ", parts: " << merged.size() << ", total: " << zipFiles->GetCount();
+
+	QFile::remove(dstArchiveFileName);
+	{
+		Zip zip(dstArchiveFileName, format);
+		setup(zip, epubCount * 10 > 9 * zipFiles->GetCount());
+		if (!zip.Write(*zipFiles))
+			throw std::ios_base::failure(QString("Cannot write %1").arg(dstArchiveFileName).toStdString());
+	}
+
+	return merged;
+}
+
+void AppendImageStatistics(QFile& output, const QString& part)
+{
+	QFile input(part);
+	if (!input.open(QIODevice::ReadOnly))
+	{
+		PLOGW << part << " not found";
+		return;
+	}
+
+	while (!input.atEnd())
+		if (const auto line = input.readLine(); !line.startsWith('#'))
+			output.write(line);
+}
+
+void MergeImageStatistics(const Settings& settings)
+{
+	if (settings.imageStatistics.isEmpty())
+		return;
+
+	QFile output(settings.imageStatistics);
+	if (!output.open(QIODevice::Append))
+		throw std::ios_base::failure(QString("Cannot write to %1").arg(settings.imageStatistics).toStdString());
+
+	output.write(IMAGE_STATISTICS_HEADER);
+	for (const auto& part : settings.shard.GetFileNames(settings.imageStatistics))
+	{
+		AppendImageStatistics(output, part);
+		QFile::remove(part);
+	}
+}
+
+void MergePartImageStatistics(const Settings& settings, const QStringList& parts)
+{
+	if (settings.imageStatistics.isEmpty())
+		return;
+
+	QFile output(settings.imageStatistics);
+	if (!output.open(QIODevice::Append))
+		throw std::ios_base::failure(QString("Cannot write to %1").arg(settings.imageStatistics).toStdString());
+
+	for (const auto& part : parts)
+		AppendImageStatistics(output, part);
+}
+
+QStringList MergeShards(const Settings& settings, const FliLib::ShardPlan& plan)
+{
+	MergeImageStatistics(settings);
+
+	QStringList failed;
+	for (const auto& items : plan | std::views::chunk_by([](const auto& lhs, const auto& rhs) {
+								 return lhs.archive == rhs.archive;
+							 }))
+	{
+		const auto& archive = items.front().archive;
+		const auto  name    = QFileInfo(archive).completeBaseName();
+		const auto  ext     = Zip::FormatToString(settings.format);
+
+		try
+		{
+			const auto parts = FliLib::Shard::FindParts(settings.dstDir.path(), archive, items.front().total, PART_MARKER_EXTENSION);
+			if (parts.empty())
+			{
+				if (settings.archiveFb2 && !settings.dstDir.exists(QString("%1.%2").arg(name, ext)))
+					throw std::invalid_argument("no output found");
+				continue;
+			}
+
+			const auto getParts = [&](const QString& folder, const QString& partExt) {
+				return parts | std::views::transform([&](const FliLib::ShardItem& item) {
+						   return QString("%1/%2.%3").arg(folder, item.GetName(), partExt);
+					   })
+				     | std::ranges::to<QStringList>();
+			};
+
+			auto merged = parts | std::views::transform([&](const FliLib::ShardItem& item) {
+							  return GetPartMarker(settings, item.GetName());
+						  })
+			            | std::ranges::to<QStringList>();
+			if (settings.archiveFb2)
+				merged << MergeArchiveParts(
+					getParts(settings.dstDir.path(), ext),
+					QString("%1.%2").arg(settings.dstDir.filePath(name), ext),
+					[&](Zip& zip, const bool isEpub) {
+						SetupFb2Archive(zip, settings, isEpub);
+					},
+					settings.format,
+					true
+				);
+
+			for (const auto& [save, type] : { std::pair { settings.cover.save, Global::COVERS }, std::pair { settings.image.save, Global::IMAGES } })
+				if (save)
+					merged << MergeArchiveParts(
+						getParts(settings.dstDir.filePath(type), "zip"),
+						QString("%1/%2.zip").arg(settings.dstDir.filePath(type), name),
+						[&](Zip& zip, bool) {
+							SetupImageArchive(zip, settings.maxThreadCount);
+						},
+						Zip::Format::Zip,
+						false
+					);
+
+			// statistics go last, after every archive of the group is written, so a failed merge does not add them twice on retry
+			const auto statistics = parts | std::views::transform([&](const FliLib::ShardItem& item) {
+										return GetPartStatistics(settings, item.GetName());
+									})
+			                      | std::ranges::to<QStringList>();
+			MergePartImageStatistics(settings, statistics);
+			merged << statistics;
+
+			for (const auto& part : merged)
+				QFile::remove(part);
+		}
+		catch (const std::exception& ex)
+		{
+			PLOGE << QString("%1 merging failed: %2").arg(archive).arg(ex.what());
+			failed << archive;
+		}
+	}
+
+	return failed;
+}
+
 QStringList ProcessArchives(Settings& settings)
 {
 	if (!settings.dstDir.exists() && !settings.dstDir.mkpath("."))
@@ -965,32 +1188,42 @@ QStringList ProcessArchives(Settings& settings)
 	});
 
 	PLOGD << "Total file count calculation";
-	settings.totalFileCount = std::accumulate(sorted.cbegin(), sorted.cend(), settings.totalFileCount, [](const auto init, const auto& item) {
-		const Zip zip(item.second);
-		return init + zip.GetFileNameList().size();
+	const auto plan = settings.shard.Split(sorted | std::views::values | std::views::reverse | std::ranges::to<QStringList>());
+	if (settings.shard.IsMerge())
+		return MergeShards(settings, plan);
+
+	const auto items        = settings.shard.Select(plan);
+	settings.totalFileCount = std::accumulate(items.cbegin(), items.cend(), settings.totalFileCount, [](const auto init, const auto& item) {
+		return init + static_cast<int>(item.end - item.begin);
 	});
 	PLOGI << "Total file count: " << settings.totalFileCount;
 
 	std::unique_ptr<QTextStream> imageStatisticsStream;
-	QFile                        imageStatisticsFile(settings.imageStatistics);
-	if (!settings.imageStatistics.isEmpty())
+	const auto                   imageStatistics = settings.shard.GetFileName(settings.imageStatistics);
+	QFile                        imageStatisticsFile(imageStatistics);
+	if (!imageStatistics.isEmpty())
 	{
 		if (!imageStatisticsFile.open(QIODevice::Append))
-			throw std::ios_base::failure(QString("Cannot write to %1").arg(settings.imageStatistics).toStdString());
+			throw std::ios_base::failure(QString("Cannot write to %1").arg(imageStatistics).toStdString());
 		imageStatisticsStream = std::make_unique<QTextStream>(&imageStatisticsFile);
-		*imageStatisticsStream << "#ARCHIVE|FB2_FILE|IMAGE_ID|FAIL_INFO|IS_COVER|PIXEL_TYPE|IMAGE_FILE_SIZE|WIDTH|HEIGHT|HASH\n";
+		*imageStatisticsStream << IMAGE_STATISTICS_HEADER;
 		imageStatisticsStream->flush();
 	}
 
 	const Decoder decoder;
 	const auto    encodingDetector = IEncodingDetector::Create();
 
-	Util::Progress progress(settings.totalFileCount, "repacking e-library");
+	FliLib::Progress progress(settings.totalFileCount, "repacking e-library");
+
+	FliLib::Prefetcher prefetcher(items | std::views::transform(&FliLib::ShardItem::archive) | std::ranges::to<QStringList>(), settings.prefetch);
 
 	QStringList failed;
-	for (auto&& file : sorted | std::views::values | std::views::reverse)
-		if (ProcessArchive(file, settings, *encodingDetector, progress, imageStatisticsStream.get(), decoder))
-			failed << std::move(file);
+	for (const auto& item : items)
+	{
+		prefetcher.Advance(item.archive);
+		if (ProcessArchive(item, settings, *encodingDetector, progress, imageStatisticsStream.get(), decoder))
+			failed << (item.IsPart() ? QString("%1, entries %2-%3").arg(item.archive).arg(item.begin).arg(item.end) : item.archive);
+	}
 
 	return failed;
 }
@@ -1084,11 +1317,19 @@ Settings ProcessCommandLine(const QCoreApplication& app)
     }
 	);
 
-	const auto defaultLogPath = QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID);
-	const auto logOption      = Log::LoggingInitializer::AddLogFileOption(parser, defaultLogPath);
+	const auto defaultLogPath  = QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID);
+	const auto logOption       = Log::LoggingInitializer::AddLogFileOption(parser, defaultLogPath);
+	const auto traceOption     = FliLib::TraceInitializer::AddTraceFileOption(parser);
+	const auto metricsOption   = FliLib::MetricsPublisher::AddMetricsFileOption(parser);
+	const auto resourcesOption = FliLib::ResourceReporter::AddResourceReportOption(parser);
+	FliLib::Shard::AddShardOptions(parser);
+	FliLib::Prefetcher::AddPrefetchOptions(parser);
 	parser.process(app);
 
-	settings.logFileName = parser.isSet(logOption) ? parser.value(logOption) : defaultLogPath;
+	settings.logFileName       = parser.isSet(logOption) ? parser.value(logOption) : defaultLogPath;
+	settings.traceFileName     = parser.value(traceOption);
+	settings.metricsFileName   = parser.value(metricsOption);
+	settings.resourcesFileName = parser.value(resourcesOption);
 
 	if (parser.positionalArguments().isEmpty())
 		parser.showHelp(0);
@@ -1118,6 +1359,8 @@ Settings ProcessCommandLine(const QCoreApplication& app)
 	SetValue(parser, MIN_IMAGE_FILE_SIZE_OPTION_NAME, settings.minImageFileSize);
 
 	settings.imageStatistics = parser.value(IMAGE_STATISTICS);
+	settings.shard           = FliLib::Shard::FromCommandLine(parser);
+	settings.prefetch        = FliLib::Prefetcher::GetPrefetchSettings(parser);
 
 	settings.cover.grayscale = settings.image.grayscale = parser.isSet(GRAYSCALE_OPTION_NAME);
 	if (parser.isSet(COVER_GRAYSCALE_OPTION_NAME))
@@ -1145,10 +1388,11 @@ bool run(int argc, char* argv[])
 	QCoreApplication::setApplicationVersion(PRODUCT_VERSION);
 	Util::XMLPlatformInitializer xmlPlatformInitializer;
 
-	auto                                             settings = ProcessCommandLine(app);
-	Log::LoggingInitializer                          logging(settings.logFileName);
-	plog::ConsoleAppender<Util::LogConsoleFormatter> consoleAppender;
-	Log::LogAppender                                 logConsoleAppender(&consoleAppender);
+	auto                                                    settings = ProcessCommandLine(app);
+	FliLib::AsyncLoggingInitializer<Util::LogConsoleFormatter> logging(settings.logFileName);
+	FliLib::TraceInitializer                                   trace(settings.traceFileName);
+	FliLib::MetricsPublisher                                   metrics(settings.metricsFileName);
+	FliLib::ResourceReporter                                   resources(settings.resourcesFileName);
 	PLOGI << QString("%1 started").arg(APP_ID);
 
 	{
@@ -34,6 +34,9 @@ std::ostream& operator<<(std::ostream& stream, const HomeCompa::fb2cut::Settings
 
 	stream << std::endl << "output format: " << settings.format;
 
+	if (settings.shard.IsEnabled())
+		stream << std::endl << (settings.shard.IsMerge() ? "shard merge: " : "shards: ") << settings.shard.GetCount();
+
 	if (!settings.ffmpeg.isEmpty())
 		stream << std::endl << "ffmpeg: " << settings.ffmpeg.toStdString();
 
@@ -6,6 +6,9 @@
 #include <QSize>
 #include <QString>
 
+#include "lib/Prefetcher.h"
+#include "lib/Shard.h"
+
 #include "Constant.h"
 #include "zip.h"
 
@@ -58,6 +61,12 @@ struct Settings
 	int           totalFileCount { 0 };
 	Zip::Format   format { Zip::Format::SevenZip };
 	QString       logFileName;
+	QString       traceFileName;
+	QString       metricsFileName;
+	QString       resourcesFileName;
+	FliLib::Shard shard;
+
+	FliLib::PrefetchSettings prefetch;
 };
 
 } // namespace HomeCompa::fb2cut
@@ -0,0 +1,409 @@
+#include "corpus.h"
+
+#include <algorithm>
+#include <span>
+#include <utility>
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include "lib/ZipStreamWriter.h"
+#include "lib/util.h"
+#include "util/xml/XmlWriter.h"
+
+#include "Constant.h"
+#include "log.h"
+
+using namespace HomeCompa;
+using namespace flibench;
+
+namespace
+{
+
+constexpr const char16_t* CYRILLIC_SYLLABLES[] {
+	u"ка", u"ро", u"ми", u"ла", u"то", u"не", u"да", u"пе",
+	u"ри", u"со", u"ву", u"жи", u"бо", u"ле", u"ны", u"стё",
+};
+
+constexpr const char* LATIN_SYLLABLES[] { "ka", "ro", "mi", "la", "to", "ne", "da", "pe", "ri", "so", "vu", "zhi", "bo", "le", "ny", "sto" };
+
+constexpr std::pair<const char*, const char*> GENRES[] {
+	{ "sf", "Science fiction" },
+	{ "det_classic", "Classic detective" },
+	{ "prose_classic", "Classic prose" },
+	{ "love_contemporary", "Contemporary romance" },
+	{ "child_tale", "Fairy tales" },
+	{ "sci_history", "History" },
+	{ "adv_geo", "Travel and geography" },
+	{ "poetry", "Poetry" },
+};
+
+constexpr int AUTHOR_COUNT = 50;
+constexpr int SERIES_COUNT = 20;
+
+struct Person
+{
+	QString firstName;
+	QString lastName;
+};
+
+struct BookRecord
+{
+	int     id { 0 };
+	QString title;
+	QString lang;
+	int     author { 0 };
+	size_t  genre { 0 };
+	int     series { -1 };
+	int     seriesNumber { 0 };
+	int     year { 0 };
+	QDate   date;
+	size_t  size { 0 };
+	QString md5;
+	QString textHash;
+	size_t  textSize { 0 };
+
+	std::vector<QByteArray> imageHashes;
+};
+
+QByteArray Encode(const QString& text, const bool cp1251)
+{
+	if (!cp1251)
+		return text.toUtf8();
+
+	QByteArray result;
+	result.reserve(text.size());
+	for (const auto ch : text)
+	{
+		const auto code = ch.unicode();
+		if (code < 0x80)
+			result.append(static_cast<char>(code));
+		else if (code >= 0x0410 && code <= 0x044F)
+			result.append(static_cast<char>(code - 0x0410 + 0xC0));
+		else if (code == 0x0401)
+			result.append('\xA8');
+		else if (code == 0x0451)
+			result.append('\xB8');
+		else
+			result.append('?');
+	}
+	return result;
+}
+
+QString Escape(QString text)
+{
+	return text.replace('&', "&amp;").replace('<', "&lt;").replace('>', "&gt;");
+}
+
+QString EscapeSql(QString text)
+{
+	return text.replace('\\', R"(\\)").replace('\'', R"(\')");
+}
+
+class Generator
+{
+public:
+	explicit Generator(const CorpusSettings& settings)
+		: m_settings { settings }
+		, m_rng { settings.seed }
+	{
+		for (int i = 0; i < AUTHOR_COUNT; ++i)
+		{
+			const auto cyrillic = Next(2) == 0;
+			m_authors.emplace_back(Name(cyrillic), Name(cyrillic));
+		}
+
+		for (int i = 0; i < SERIES_COUNT; ++i)
+			m_series << Sentence(Next(2) == 0, 1 + Next(3)).chopped(1);
+	}
+
+	Corpus Generate(const QDir& dir)
+	{
+		Corpus corpus;
+		corpus.sqlDir  = dir.filePath("sql");
+		corpus.hashDir = dir.filePath("hash");
+		for (const auto& path : { corpus.sqlDir, corpus.hashDir })
+			if (!QDir(path).mkpath("."))
+				throw std::ios_base::failure(QString("Cannot create %1").arg(path).toStdString());
+
+		int id = 1;
+		for (int archiveIndex = 0; archiveIndex < m_settings.archiveCount; ++archiveIndex)
+		{
+			const auto first       = id;
+			const auto last        = id + m_settings.booksPerArchive - 1;
+			const auto archivePath = dir.filePath(QString("f.fb2.%1-%2.zip").arg(first).arg(last));
+
+			FliLib::ZipStreamWriter zip(archivePath);
+			for (; id <= last; ++id)
+			{
+				auto& book = m_books.emplace_back(CreateBook(id));
+				auto  body = CreateFb2(book);
+
+				book.size = static_cast<size_t>(body.size());
+				book.md5  = QCryptographicHash::hash(body, QCryptographicHash::Md5).toHex();
+
+				corpus.bookBytes += book.size;
+				corpus.imageCount += static_cast<size_t>(m_settings.imagesPerBook) + 1;
+				zip.Add(QString("%1.fb2").arg(id), std::move(body), QDateTime(book.date, QTime(12, 0)));
+			}
+			zip.Close();
+
+			WriteHash(QDir(corpus.hashDir), archivePath, std::span(m_books).last(static_cast<size_t>(m_settings.booksPerArchive)));
+			corpus.archives << archivePath;
+		}
+
+		corpus.bookCount = m_books.size();
+		WriteDump(QDir(corpus.sqlDir));
+
+		return corpus;
+	}
+
+private:
+	size_t Next(const size_t n)
+	{
+		return static_cast<size_t>(m_rng() % n);
+	}
+
+	QString Word(const bool cyrillic)
+	{
+		QString word;
+		for (size_t i = 0, n = 1 + Next(4); i < n; ++i)
+			word += cyrillic ? QString::fromUtf16(CYRILLIC_SYLLABLES[Next(std::size(CYRILLIC_SYLLABLES))]) : QString(LATIN_SYLLABLES[Next(std::size(LATIN_SYLLABLES))]);
+		return word;
+	}
+
+	QString Name(const bool cyrillic)
+	{
+		auto name = Word(cyrillic);
+		name[0]   = name[0].toUpper();
+		return name;
+	}
+
+	QString Sentence(const bool cyrillic, const size_t wordCount)
+	{
+		QStringList words;
+		for (size_t i = 0; i < wordCount; ++i)
+			words << Word(cyrillic);
+		words.front()[0] = words.front()[0].toUpper();
+		return words.join(' ') + '.';
+	}
+
+	BookRecord CreateBook(const int id)
+	{
+		BookRecord book;
+		book.id     = id;
+		book.lang   = Next(2) == 0 ? "ru" : "en";
+		book.title  = Sentence(book.lang == "ru", 1 + Next(5)).chopped(1);
+		book.author = static_cast<int>(Next(AUTHOR_COUNT));
+		book.genre  = Next(std::size(GENRES));
+		book.year   = 1900 + static_cast<int>(Next(125));
+		book.date   = QDate(2024, 1, 1).addDays(id % 365);
+		if (Next(3) == 0)
+		{
+			book.series       = static_cast<int>(Next(SERIES_COUNT));
+			book.seriesNumber = 1 + static_cast<int>(Next(10));
+		}
+		return book;
+	}
+
+	QByteArray CreateFb2(BookRecord& book)
+	{
+		const auto  cyrillic = book.lang == "ru";
+		const auto  cp1251   = cyrillic && Next(100) < static_cast<size_t>(m_settings.cp1251Percents);
+		const auto& author   = m_authors[static_cast<size_t>(book.author)];
+
+		QString text;
+		text += QString(R"(<?xml version="1.0" encoding="%1"?>)").arg(cp1251 ? "windows-1251" : "utf-8") + '\n';
+		text += R"(<FictionBook xmlns="http://www.gribuser.ru/xml/fictionbook/2.0" xmlns:l="http://www.w3.org/1999/xlink">)";
+		text += "<description><title-info>";
+		text += QString("<genre>%1</genre>").arg(GENRES[book.genre].first);
+		text += QString("<author><first-name>%1</first-name><last-name>%2</last-name></author>").arg(Escape(author.firstName), Escape(author.lastName));
+		text += QString("<book-title>%1</book-title>").arg(Escape(book.title));
+		text += R"(<coverpage><image l:href="#cover.jpg"/></coverpage>)";
+		text += QString("<lang>%1</lang>").arg(book.lang);
+		if (book.series >= 0)
+			text += QString(R"(<sequence name="%1" number="%2"/>)").arg(Escape(m_series[book.series])).arg(book.seriesNumber);
+		text += "</title-info>";
+		text += QString("<document-info><id>flibench-%1</id><version>1.0</version></document-info>").arg(book.id);
+		text += "</description><body>";
+
+		const auto sectionSize = std::max(m_settings.bookSize / (m_settings.imagesPerBook + 1), 1);
+		for (int section = 0; section <= m_settings.imagesPerBook; ++section)
+		{
+			text += QString("<section><title><p>%1</p></title>").arg(Escape(Sentence(cyrillic, 1 + Next(4))));
+			for (const auto end = text.size() + sectionSize; text.size() < end;)
+				text += QString("<p>%1</p>").arg(Escape(Sentence(cyrillic, 5 + Next(20))));
+			if (section < m_settings.imagesPerBook)
+				text += QString(R"(<image l:href="#image%1.jpg"/>)").arg(section);
+			text += "</section>";
+		}
+		text += "</body>";
+
+		auto bytes    = Encode(text, cp1251);
+		book.textHash = QCryptographicHash::hash(bytes, QCryptographicHash::Md5).toHex();
+		book.textSize = static_cast<size_t>(bytes.size());
+		bytes.append(CreateBinary("cover.jpg", m_settings.coverSize, book));
+		for (int image = 0; image < m_settings.imagesPerBook; ++image)
+			bytes.append(CreateBinary(QString("image%1.jpg").arg(image), m_settings.imageSize, book));
+		bytes.append("</FictionBook>\n");
+
+		return bytes;
+	}
+
+	QByteArray CreateBinary(const QString& id, const QSize& size, BookRecord& book)
+	{
+		QByteArray jpeg;
+		QBuffer    buffer(&jpeg);
+		buffer.open(QIODevice::WriteOnly);
+		if (!GenerateImage(m_rng, size).save(&buffer, "jpeg", 80))
+			throw std::runtime_error("Cannot encode jpeg");
+
+		book.imageHashes.emplace_back(QCryptographicHash::hash(jpeg, QCryptographicHash::Md5));
+
+		return QString(R"(<binary id="%1" content-type="image/jpeg">)").arg(id).toUtf8() + jpeg.toBase64() + "</binary>";
+	}
+
+	// the same layout as flihasher writes, so hash consumers are measured without running flihasher first
+	void WriteHash(const QDir& dir, const QString& archivePath, const std::span<const BookRecord> books) const
+	{
+		const QFileInfo fileInfo(archivePath);
+		QSaveFile       output(dir.filePath(fileInfo.completeBaseName() + ".xml"));
+		if (!output.open(QIODevice::WriteOnly))
+			throw std::ios_base::failure(QString("Cannot write %1").arg(output.fileName()).toStdString());
+
+		{
+			Util::XmlWriter writer(output);
+			const auto      booksGuard = writer.Guard("books");
+			booksGuard->WriteAttribute("source", "Flibusta");
+
+			for (const auto& book : books)
+			{
+				const auto bookGuard = writer.Guard("book");
+				bookGuard->WriteAttribute("hash", book.md5)
+					.WriteAttribute("id", book.textHash)
+					.WriteAttribute(Inpx::FOLDER, fileInfo.fileName())
+					.WriteAttribute(Inpx::FILE, QString("%1.fb2").arg(book.id))
+					.WriteAttribute("title", book.title.toLower());
+
+				for (size_t i = 0; i < book.imageHashes.size(); ++i)
+				{
+					const auto& md5   = book.imageHashes[i];
+					const auto  guard = bookGuard->Guard(i == 0 ? Global::COVER : Global::IMAGE);
+					guard->WriteAttribute("id", i == 0 ? QString("cover.jpg") : QString("image%1.jpg").arg(i - 1));
+					guard->WriteAttribute("pHash", QString::number(qFromLittleEndian<quint64>(md5.constData()), 16));
+					guard->WriteCharacters(QString::fromLatin1(md5.toHex()));
+				}
+
+				FliLib::SerializeHashSections({ QString("0\t%1\t%2\t%3").arg(book.textHash).arg(m_settings.imagesPerBook + 1).arg(book.textSize) }, writer);
+			}
+		}
+
+		if (!output.commit())
+			throw std::ios_base::failure(QString("Cannot write %1").arg(output.fileName()).toStdString());
+	}
+
+	void WriteDump(const QDir& dir) const
+	{
+		const auto write = [&](const QString& table, const QStringList& rows) {
+			QFile file(dir.filePath(QString("lib.%1.sql").arg(table)));
+			if (!file.open(QIODevice::WriteOnly))
+				throw std::ios_base::failure(QString("Cannot write %1").arg(file.fileName()).toStdString());
+
+			for (qsizetype i = 0; i < rows.size(); i += 100)
+				file.write(QString("INSERT INTO `%1` VALUES %2;\n").arg(table, rows.mid(i, 100).join(',')).toUtf8());
+		};
+
+		QStringList rows;
+		for (const auto& book : m_books)
+		{
+			const auto time = QDateTime(book.date, QTime(12, 0)).toString("yyyy-MM-dd hh:mm:ss");
+			rows << QString("(%1,%2,'%3','%4','','%5',0,'','fb2','',%6,'0','','',0,'','%7','%3','',0,0,0)")
+						.arg(book.id)
+						.arg(book.size)
+						.arg(time, EscapeSql(book.title), book.lang)
+						.arg(book.year)
+						.arg(book.md5);
+		}
+		write("libbook", std::exchange(rows, {}));
+
+		for (int i = 0; i < AUTHOR_COUNT; ++i)
+			rows << QString("(%1,'%2','','%3','',0,'','','',0)").arg(i + 1).arg(EscapeSql(m_authors[static_cast<size_t>(i)].firstName), EscapeSql(m_authors[static_cast<size_t>(i)].lastName));
+		write("libavtorname", std::exchange(rows, {}));
+
+		for (const auto& book : m_books)
+			rows << QString("(%1,%2,0)").arg(book.id).arg(book.author + 1);
+		write("libavtor", std::exchange(rows, {}));
+
+		for (size_t i = 0; i < std::size(GENRES); ++i)
+			rows << QString("(%1,'%2','%3','')").arg(i + 1).arg(GENRES[i].first, GENRES[i].second);
+		write("libgenrelist", std::exchange(rows, {}));
+
+		for (const auto& book : m_books)
+			rows << QString("(%1,%2,%3)").arg(book.id).arg(book.id).arg(book.genre + 1);
+		write("libgenre", std::exchange(rows, {}));
+
+		for (int i = 0; i < SERIES_COUNT; ++i)
+			rows << QString("(%1,'%2')").arg(i + 1).arg(EscapeSql(m_series[i]));
+		write("libseqname", std::exchange(rows, {}));
+
+		for (const auto& book : m_books)
+			if (book.series >= 0)
+				rows << QString("(%1,%2,%3,0,0)").arg(book.id).arg(book.series + 1).arg(book.seriesNumber);
+		write("libseq", std::exchange(rows, {}));
+
+		for (const auto& book : m_books)
+			rows << QString("(%1,%2,%3,'%4')").arg(book.id).arg(book.id).arg(book.id % 17).arg(1 + book.id % 5);
+		write("librate", std::exchange(rows, {}));
+	}
+
+private:
+	const CorpusSettings&   m_settings;
+	std::mt19937_64         m_rng;
+	std::vector<Person>     m_authors;
+	QStringList             m_series;
+	std::vector<BookRecord> m_books;
+};
+
+} // namespace
+
+Corpus flibench::GenerateCorpus(const QString& folder, const CorpusSettings& settings)
+{
+	QDir dir(folder);
+	if (dir.exists() && !dir.removeRecursively())
+		throw std::ios_base::failure(QString("Cannot clean %1").arg(folder).toStdString());
+	if (!dir.mkpath("."))
+		throw std::ios_base::failure(QString("Cannot create %1").arg(folder).toStdString());
+
+	PLOGI << "generating corpus in " << folder;
+	return Generator(settings).Generate(dir);
+}
+
+QImage flibench::GenerateImage(std::mt19937_64& rng, const QSize& size)
+{
+	QImage image(size, QImage::Format_RGB32);
+
+	const auto r = static_cast<int>(rng() % 256), g = static_cast<int>(rng() % 256), b = static_cast<int>(rng() % 256);
+	for (int y = 0; y < image.height(); ++y)
+	{
+		auto* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+		for (int x = 0; x < image.width(); ++x)
+			line[x] = qRgb((r + x) & 0xFF, (g + y) & 0xFF, (b + x + y) & 0xFF);
+	}
+
+	for (int i = 0, n = 8 + static_cast<int>(rng() % 8); i < n; ++i)
+	{
+		const auto x = static_cast<int>(rng() % static_cast<uint64_t>(size.width())), y = static_cast<int>(rng() % static_cast<uint64_t>(size.height()));
+		const auto w = 1 + static_cast<int>(rng() % static_cast<uint64_t>(size.width() / 2 + 1)), h = 1 + static_cast<int>(rng() % static_cast<uint64_t>(size.height() / 2 + 1));
+		const auto color = qRgb(static_cast<int>(rng() % 256), static_cast<int>(rng() % 256), static_cast<int>(rng() % 256));
+		for (int row = y, bottom = std::min(y + h, size.height()); row < bottom; ++row)
+			std::fill_n(reinterpret_cast<QRgb*>(image.scanLine(row)) + x, std::min(w, size.width() - x), color);
+	}
+
+	return image;
+}
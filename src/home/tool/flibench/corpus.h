@@ -0,0 +1,37 @@
+#pragma once
+
+#include <random>
+
+#include <QImage>
+#include <QSize>
+#include <QStringList>
+
+namespace HomeCompa::flibench
+{
+
+struct CorpusSettings
+{
+	int      archiveCount { 2 };
+	int      booksPerArchive { 100 };
+	int      bookSize { 64 * 1024 };
+	int      imagesPerBook { 2 };
+	int      cp1251Percents { 30 };
+	QSize    coverSize { 400, 600 };
+	QSize    imageSize { 320, 240 };
+	uint64_t seed { 42 };
+};
+
+struct Corpus
+{
+	QStringList archives;
+	QString     sqlDir;
+	QString     hashDir;
+	size_t      bookCount { 0 };
+	size_t      bookBytes { 0 };
+	size_t      imageCount { 0 };
+};
+
+Corpus GenerateCorpus(const QString& folder, const CorpusSettings& settings);
+QImage GenerateImage(std::mt19937_64& rng, const QSize& size);
+
+} // namespace HomeCompa::flibench
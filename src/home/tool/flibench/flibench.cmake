@@ -0,0 +1,20 @@
+AddTarget(flibench	app_console
+	PROJECT_GROUP Tool
+	SOURCE_DIRECTORY
+		"${CMAKE_CURRENT_LIST_DIR}"
+	LINK_LIBRARIES
+		Qt${QT_MAJOR_VERSION}::Gui
+	LINK_TARGETS
+		lib
+		logging
+		util
+		zip
+)
+
+add_custom_target(bench
+	COMMAND flibench --work "${CMAKE_BINARY_DIR}/bench" --output "${CMAKE_BINARY_DIR}/bench/results.json" --tools "$<TARGET_FILE_DIR:fb2cut>"
+	DEPENDS flibench flidumper fb2cut flihasher flimager flimerger fliparser flistat
+	WORKING_DIRECTORY "${CMAKE_BINARY_DIR}"
+	USES_TERMINAL
+)
+set_target_properties(bench PROPERTIES FOLDER Tool)
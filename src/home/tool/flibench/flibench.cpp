@@ -0,0 +1,461 @@
+﻿#include <chrono>
+#include <numeric>
+#include <random>
+#include <ranges>
+#include <unordered_map>
+
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <QThread>
+
+#include "lib/AsyncAppender.h"
+#include "lib/ImageScaler.h"
+#include "lib/Resources.h"
+#include "lib/Trace.h"
+#include "lib/UniqueFile.h"
+#include "lib/ZipStreamWriter.h"
+#include "lib/book.h"
+#include "lib/dump/Factory.h"
+#include "lib/dump/IDump.h"
+#include "lib/util.h"
+#include "logging/init.h"
+#include "util/LogConsoleFormatter.h"
+#include "util/xml/Initializer.h"
+
+#include "corpus.h"
+#include "log.h"
+#include "zip.h"
+
+#include "config/git_hash.h"
+#include "config/version.h"
+
+using namespace HomeCompa;
+using namespace flibench;
+
+namespace
+{
+
+constexpr auto APP_ID = "flibench";
+
+constexpr auto OUTPUT         = "output";
+constexpr auto WORK           = "work";
+constexpr auto TOOLS          = "tools";
+constexpr auto BASELINE       = "baseline";
+constexpr auto FILTER         = "filter";
+constexpr auto ITERATIONS     = "iterations";
+constexpr auto ARCHIVES       = "archives";
+constexpr auto BOOKS          = "books";
+constexpr auto BOOK_SIZE      = "book-size";
+constexpr auto IMAGES         = "images";
+constexpr auto SEED           = "seed";
+constexpr auto SCENARIO       = "scenario";
+constexpr auto NO_END_TO_END  = "no-e2e";
+constexpr auto E2E_ITERATIONS = "e2e-iterations";
+constexpr auto FOLDER         = "folder";
+constexpr auto PATH           = "path";
+constexpr auto NUMBER         = "number";
+constexpr auto REGEXP         = "regexp";
+constexpr auto SCENARIO_JSON  = ":/scenario/scenario.json";
+constexpr auto SCALE_SOURCE   = QSize(1600, 2400);
+constexpr auto SCALE_TARGET   = QSize(400, 600);
+constexpr auto SCALE_SAMPLES  = 8;
+constexpr auto BASELINE_DELTA = 5.0;
+
+struct Settings
+{
+	QString        output;
+	QString        work;
+	QString        tools;
+	QString        baseline;
+	QString        scenario { SCENARIO_JSON };
+	QString        filter;
+	int            iterations { 5 };
+	int            endToEndIterations { 3 };
+	bool           endToEnd { true };
+	CorpusSettings corpus;
+	QString        tracePath;
+	QString        resourcesPath;
+	QString        logPath { QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID) };
+};
+
+class Runner
+{
+public:
+	explicit Runner(const Settings& settings)
+		: m_iterations { std::max(settings.iterations, 1) }
+		, m_filter { settings.filter }
+	{
+	}
+
+public:
+	bool IsEnabled(const QString& name) const
+	{
+		return m_filter.pattern().isEmpty() || m_filter.match(name).hasMatch();
+	}
+
+	void Measure(const QString& name, const size_t items, const std::function<void()>& functor)
+	{
+		Measure(name, items, functor, {}, m_iterations, true);
+	}
+
+	void Measure(const QString& name, const size_t items, const std::function<void()>& functor, const std::function<void()>& prepare, const int iterations, const bool warmUp)
+	{
+		if (!IsEnabled(name))
+			return;
+
+		PLOGI << "running " << name;
+
+		const FliLib::TraceSpan span("Measure", name);
+		if (warmUp)
+		{
+			if (prepare)
+				prepare();
+			functor();
+		}
+
+		std::vector<double> samples;
+		for (int i = 0, n = std::max(iterations, 1); i < n; ++i)
+		{
+			if (prepare)
+				prepare();
+
+			const auto start = std::chrono::steady_clock::now();
+			functor();
+			samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		std::ranges::sort(samples);
+		const auto median = samples.size() % 2 ? samples[samples.size() / 2] : (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2;
+		const auto mean   = std::accumulate(samples.cbegin(), samples.cend(), 0.0) / static_cast<double>(samples.size());
+
+		PLOGI << QString("%1: median %2 ms, min %3 ms, max %4 ms").arg(name).arg(median, 0, 'f', 2).arg(samples.front(), 0, 'f', 2).arg(samples.back(), 0, 'f', 2);
+
+		m_results.append(QJsonObject {
+			{ "name", name },
+			{ "iterations", static_cast<int>(samples.size()) },
+			{ "items", static_cast<qint64>(items) },
+			{ "min_ms", samples.front() },
+			{ "median_ms", median },
+			{ "mean_ms", mean },
+			{ "max_ms", samples.back() },
+			{ "items_per_second", median > 0 ? static_cast<double>(items) * 1000.0 / median : 0.0 },
+		});
+	}
+
+	const QJsonArray& GetResults() const noexcept
+	{
+		return m_results;
+	}
+
+private:
+	const int                m_iterations;
+	const QRegularExpression m_filter;
+	QJsonArray               m_results;
+};
+
+void RunMicro(Runner& runner, const Settings& settings, const Corpus& corpus)
+{
+	const QDir work(settings.work);
+	const auto dbPath = work.filePath("micro/dump.db");
+	if (!QDir(work.filePath("micro")).mkpath("."))
+		throw std::ios_base::failure(QString("Cannot create %1").arg(work.filePath("micro")).toStdString());
+
+	const auto createDump = [&] {
+		QFile::remove(dbPath);
+		return FliLib::Dump::Create(corpus.sqlDir.toStdWString(), dbPath.toStdWString(), "Flibusta");
+	};
+
+	runner.Measure("dump.create", corpus.bookCount, [&] {
+		createDump();
+	});
+
+	const auto dump = createDump();
+	runner.Measure("inpdata.create", corpus.bookCount, [&] {
+		FliLib::CreateInpData(*dump);
+	});
+
+	runner.Measure("unique_file_storage.load", corpus.bookCount, [&] {
+		const FliLib::UniqueFileStorage storage(corpus.hashDir);
+	});
+
+	const auto inpData = FliLib::CreateInpData(*dump);
+	runner.Measure("book.serialize", inpData.size(), [&] {
+		QByteArray bytes;
+		for (const auto& book : inpData | std::views::values)
+			bytes << *book;
+	});
+
+	std::mt19937_64     rng(settings.corpus.seed);
+	std::vector<QImage> images;
+	std::generate_n(std::back_inserter(images), SCALE_SAMPLES, [&] {
+		return GenerateImage(rng, SCALE_SOURCE);
+	});
+	for (const auto& [name, filter] : {
+			 std::pair { "image.scale.lanczos3", FliLib::ScaleFilter::Lanczos3 },
+			 std::pair {     "image.scale.area",     FliLib::ScaleFilter::Area }
+    })
+		runner.Measure(name, images.size(), [&, filter = filter] {
+			for (const auto& image : images)
+				FliLib::Scale(image, SCALE_TARGET, filter);
+		});
+
+	std::vector<std::pair<QString, QByteArray>> files;
+	{
+		const Zip zip(corpus.archives.front());
+		for (const auto& fileName : zip.GetFileNameList())
+			files.emplace_back(fileName, zip.Read(fileName)->GetStream().readAll());
+	}
+	runner.Measure("zip.stream_writer", files.size(), [&] {
+		FliLib::ZipStreamWriter zip(work.filePath("micro/stream.zip"));
+		for (const auto& [fileName, body] : files)
+			zip.Add(fileName, body);
+		zip.Close();
+	});
+}
+
+QString Expand(QString value, const Settings& settings)
+{
+	return value.replace("%work%", QDir(settings.work).filePath("e2e")).replace("%corpus%", QDir(settings.work).filePath("corpus"));
+}
+
+void RunEndToEnd(Runner& runner, const Settings& settings, const Corpus& corpus)
+{
+	QFile file(settings.scenario);
+	if (!file.open(QIODevice::ReadOnly))
+		throw std::ios_base::failure(QString("Cannot open %1").arg(settings.scenario).toStdString());
+
+	QJsonParseError jsonParseError;
+	const auto      doc = QJsonDocument::fromJson(file.readAll(), &jsonParseError);
+	if (jsonParseError.error != QJsonParseError::NoError)
+		throw std::invalid_argument(QString("%1: %2").arg(settings.scenario, jsonParseError.errorString()).toStdString());
+
+	QDir e2e(QDir(settings.work).filePath("e2e"));
+	if (e2e.exists() && !e2e.removeRecursively())
+		throw std::ios_base::failure(QString("Cannot clean %1").arg(e2e.path()).toStdString());
+	if (!e2e.mkpath("logs"))
+		throw std::ios_base::failure(QString("Cannot create %1").arg(e2e.path()).toStdString());
+
+	const QDir tools(settings.tools.isEmpty() ? QCoreApplication::applicationDirPath() : settings.tools);
+	const auto expand = [&](const QJsonValue& value) {
+		return value.toArray() | std::views::transform([&](const auto& item) {
+				   return Expand(item.toString(), settings);
+			   })
+		     | std::ranges::to<QStringList>();
+	};
+
+	for (const auto stageValue : doc.object()["stages"].toArray())
+	{
+		const auto stage = stageValue.toObject();
+		const auto name  = stage["name"].toString();
+		if (!runner.IsEnabled("e2e." + name))
+			continue;
+
+		const auto prepare = [directories = expand(stage["directories"]), files = expand(stage["files"])] {
+			for (const auto& path : files)
+				if (QFile::exists(path) && !QFile::remove(path))
+					throw std::ios_base::failure(QString("Cannot remove %1").arg(path).toStdString());
+
+			for (const auto& path : directories)
+				if (QDir dir(path); (dir.exists() && !dir.removeRecursively()) || !dir.mkpath("."))
+					throw std::ios_base::failure(QString("Cannot recreate %1").arg(path).toStdString());
+		};
+
+		const auto program   = tools.filePath(stage["program"].toString());
+		const auto arguments = expand(stage["arguments"]);
+
+		runner.Measure(
+			"e2e." + name,
+			corpus.bookCount,
+			[&] {
+				QProcess process;
+				process.setProcessChannelMode(QProcess::MergedChannels);
+				process.setStandardOutputFile(e2e.filePath(QString("logs/%1.log").arg(name)));
+				process.start(program, arguments);
+				if (!process.waitForStarted())
+					throw std::runtime_error(QString("Cannot start %1").arg(program).toStdString());
+				process.waitForFinished(-1);
+				if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+					throw std::runtime_error(QString("%1 failed with %2, see %3").arg(name).arg(process.exitCode()).arg(e2e.filePath(QString("logs/%1.log").arg(name))).toStdString());
+			},
+			prepare,
+			settings.endToEndIterations,
+			false
+		);
+	}
+}
+
+void CompareBaseline(const QString& path, const QJsonArray& results)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+		throw std::ios_base::failure(QString("Cannot open %1").arg(path).toStdString());
+
+	std::unordered_map<QString, double> baseline;
+	for (const auto item : QJsonDocument::fromJson(file.readAll()).object()["results"].toArray())
+		baseline.try_emplace(item["name"].toString(), item["median_ms"].toDouble());
+
+	for (const auto item : results)
+	{
+		const auto name = item["name"].toString();
+		const auto it   = baseline.find(name);
+		if (it == baseline.end() || it->second <= 0)
+			continue;
+
+		const auto median = item["median_ms"].toDouble();
+		const auto delta  = (median - it->second) * 100.0 / it->second;
+		const auto message = QString("%1: %2 ms -> %3 ms (%4%5%)").arg(name).arg(it->second, 0, 'f', 2).arg(median, 0, 'f', 2).arg(delta > 0 ? "+" : "").arg(delta, 0, 'f', 1);
+		if (std::abs(delta) < BASELINE_DELTA)
+			PLOGI << message;
+		else
+			PLOGW << message;
+	}
+}
+
+void run(const Settings& settings)
+{
+	const auto corpus = GenerateCorpus(QDir(settings.work).filePath("corpus"), settings.corpus);
+	PLOGI << QString("corpus: %1 archives, %2 books, %3 bytes, %4 images").arg(corpus.archives.size()).arg(corpus.bookCount).arg(corpus.bookBytes).arg(corpus.imageCount);
+
+	Runner runner(settings);
+	RunMicro(runner, settings, corpus);
+	if (settings.endToEnd)
+		RunEndToEnd(runner, settings, corpus);
+
+	const QJsonObject result {
+		{ "tool", APP_ID },
+		{ "version", PRODUCT_VERSION },
+		{ "commit", GIT_HASH },
+		{ "timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate) },
+		{ "threads", QThread::idealThreadCount() },
+		{ "os", QSysInfo::prettyProductName() },
+		{ "corpus",
+         QJsonObject {
+         { "archives", corpus.archives.size() },
+         { "books", static_cast<qint64>(corpus.bookCount) },
+         { "bytes", static_cast<qint64>(corpus.bookBytes) },
+         { "images", static_cast<qint64>(corpus.imageCount) },
+         { "seed", QString::number(settings.corpus.seed) },
+         } },
+		{ "results", runner.GetResults() },
+	};
+
+	const auto output = settings.output.isEmpty() ? QDir(settings.work).filePath("results.json") : settings.output;
+	FliLib::Write(output, QJsonDocument(result).toJson());
+	PLOGI << "results written to " << output;
+
+	if (!settings.baseline.isEmpty())
+		CompareBaseline(settings.baseline, runner.GetResults());
+}
+
+Settings parseCommandLine(const QCoreApplication& app)
+{
+	Settings settings {};
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QString("%1 runs micro and end-to-end benchmarks on a synthetic corpus").arg(APP_ID));
+	parser.addHelpOption();
+	parser.addVersionOption();
+	parser.addOptions(
+		{
+			{ { "w", WORK }, "Working folder (required)", FOLDER },
+			{ { "o", OUTPUT }, "Results file [work/results.json]", PATH },
+			{ TOOLS, "Folder with tool executables [flibench folder]", FOLDER },
+			{ BASELINE, "Previous results file to compare with", PATH },
+			{ FILTER, "Run only benchmarks matching regexp", REGEXP },
+			{ ITERATIONS, "Benchmark iterations [5]", NUMBER },
+			{ ARCHIVES, "Corpus archive count [2]", NUMBER },
+			{ BOOKS, "Books per archive [100]", NUMBER },
+			{ BOOK_SIZE, "Book text size in bytes [65536]", NUMBER },
+			{ IMAGES, "Images per book besides cover [2]", NUMBER },
+			{ SEED, "Corpus random seed [42]", NUMBER },
+			{ SCENARIO, "End-to-end scenario json [embedded]", PATH },
+			{ E2E_ITERATIONS, "End-to-end benchmark iterations [3]", NUMBER },
+			{ NO_END_TO_END, "Skip end-to-end benchmarks" },
+    }
+	);
+	const auto logOption       = Log::LoggingInitializer::AddLogFileOption(parser, settings.logPath);
+	const auto traceOption     = FliLib::TraceInitializer::AddTraceFileOption(parser);
+	const auto resourcesOption = FliLib::ResourceReporter::AddResourceReportOption(parser);
+	parser.process(app);
+
+	settings.work     = parser.value(WORK);
+	settings.output   = parser.value(OUTPUT);
+	settings.tools    = parser.value(TOOLS);
+	settings.baseline = parser.value(BASELINE);
+	settings.filter   = parser.value(FILTER);
+	settings.endToEnd = !parser.isSet(NO_END_TO_END);
+
+	if (parser.isSet(SCENARIO))
+		settings.scenario = parser.value(SCENARIO);
+
+	const auto setNumber = [&](const char* option, auto& value) {
+		if (!parser.isSet(option))
+			return;
+
+		bool ok     = false;
+		using Value = std::remove_reference_t<decltype(value)>;
+		value       = static_cast<Value>(parser.value(option).toULongLong(&ok));
+		if (!ok)
+			parser.showHelp(1);
+	};
+	setNumber(ITERATIONS, settings.iterations);
+	setNumber(E2E_ITERATIONS, settings.endToEndIterations);
+	setNumber(ARCHIVES, settings.corpus.archiveCount);
+	setNumber(BOOKS, settings.corpus.booksPerArchive);
+	setNumber(BOOK_SIZE, settings.corpus.bookSize);
+	setNumber(IMAGES, settings.corpus.imagesPerBook);
+	setNumber(SEED, settings.corpus.seed);
+
+	if (settings.work.isEmpty() || settings.corpus.archiveCount <= 0 || settings.corpus.booksPerArchive <= 0)
+		parser.showHelp(1);
+
+	if (parser.isSet(logOption))
+		settings.logPath = parser.value(logOption);
+
+	settings.tracePath     = parser.value(traceOption);
+	settings.resourcesPath = parser.value(resourcesOption);
+
+	return settings;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	const QGuiApplication app(argc, argv);
+	QCoreApplication::setApplicationName(APP_ID);
+	QCoreApplication::setApplicationVersion(PRODUCT_VERSION);
+	Util::XMLPlatformInitializer xmlPlatformInitializer;
+
+	const auto                                              settings = parseCommandLine(app);
+	FliLib::AsyncLoggingInitializer<Util::LogConsoleFormatter> logging(settings.logPath);
+	FliLib::TraceInitializer                                   trace(settings.tracePath);
+	FliLib::ResourceReporter                                   resources(settings.resourcesPath);
+	PLOGI << QString("%1 started").arg(APP_ID);
+
+	try
+	{
+		run(settings);
+		return 0;
+	}
+	catch (const std::exception& ex)
+	{
+		PLOGE << QString("%1 failed: %2").arg(APP_ID).arg(ex.what());
+	}
+	catch (...)
+	{
+		PLOGE << QString("%1 failed").arg(APP_ID);
+	}
+
+	return 1;
+}
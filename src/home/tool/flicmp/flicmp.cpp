@@ -3,10 +3,8 @@
 #include <QGuiApplication>
 #include <QStandardPaths>
 
-#include <plog/Appenders/ConsoleAppender.h>
-
-#include "logging/LogAppender.h"
-#include "logging/init.h"
+#include "lib/AsyncAppender.h"
+#include "lib/Resources.h"
 #include "util/LogConsoleFormatter.h"
 #include "util/bookhash/flihash.h"
 
@@ -43,9 +41,8 @@ int main(int argc, char* argv[])
 {
 	const QGuiApplication app(argc, argv);
 
-	Log::LoggingInitializer                    logging(QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID));
-	plog::ConsoleAppender<LogConsoleFormatter> consoleAppender;
-	Log::LogAppender                           logConsoleAppender(&consoleAppender);
+	FliLib::AsyncLoggingInitializer<LogConsoleFormatter> logging(QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID));
+	FliLib::ResourceReporter                             resources(QString {});
 
 	try
 	{
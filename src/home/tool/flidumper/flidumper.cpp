@@ -2,11 +2,11 @@
 #include <QCoreApplication>
 #include <QStandardPaths>
 
-#include <plog/Appenders/ConsoleAppender.h>
-
+#include "lib/AsyncAppender.h"
+#include "lib/Resources.h"
+#include "lib/Trace.h"
 #include "lib/dump/Factory.h"
 #include "lib/dump/IDump.h"
-#include "logging/LogAppender.h"
 #include "logging/init.h"
 #include "util/LogConsoleFormatter.h"
 
@@ -36,12 +36,19 @@ struct Settings
 	std::filesystem::path         replacementPath;
 	QString                       library;
 	QString                       logPath { QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID) };
+	QString                       tracePath;
+	QString                       resourcesPath;
 	FliLib::IDump::AdditionalType additionalType { ~FliLib::IDump::AdditionalType::None };
 };
 
 void run(const Settings& settings)
 {
-	const auto dump = FliLib::Dump::Create(settings.sqlDir, settings.dbPath, settings.library, settings.replacementPath);
+	const auto dump = [&] {
+		const FliLib::TraceSpan span("CreateDump");
+		return FliLib::Dump::Create(settings.sqlDir, settings.dbPath, settings.library, settings.replacementPath);
+	}();
+
+	const FliLib::TraceSpan span("CreateAdditional");
 	dump->CreateAdditional(settings.sqlDir, settings.dbPath.parent_path(), settings.additionalType);
 }
 
@@ -62,7 +69,9 @@ Settings parseCommandLine(const QCoreApplication& app)
 			{ SKIP_AUTHORS_INFO, "Skip authors info" },
     }
 	);
-	const auto logOption = Log::LoggingInitializer::AddLogFileOption(parser, settings.logPath);
+	const auto logOption       = Log::LoggingInitializer::AddLogFileOption(parser, settings.logPath);
+	const auto traceOption     = FliLib::TraceInitializer::AddTraceFileOption(parser);
+	const auto resourcesOption = FliLib::ResourceReporter::AddResourceReportOption(parser);
 	parser.process(app);
 
 	settings.sqlDir          = parser.value(SQL).toStdWString();
@@ -79,6 +88,9 @@ Settings parseCommandLine(const QCoreApplication& app)
 	if (parser.isSet(logOption))
 		settings.logPath = parser.value(logOption);
 
+	settings.tracePath     = parser.value(traceOption);
+	settings.resourcesPath = parser.value(resourcesOption);
+
 	return settings;
 }
 
@@ -90,10 +102,10 @@ int main(int argc, char* argv[])
 	QCoreApplication::setApplicationName(APP_ID);
 	QCoreApplication::setApplicationVersion(PRODUCT_VERSION);
 
-	const auto                                       settings = parseCommandLine(app);
-	Log::LoggingInitializer                          logging(settings.logPath);
-	plog::ConsoleAppender<Util::LogConsoleFormatter> consoleAppender;
-	Log::LogAppender                                 logConsoleAppender(&consoleAppender);
+	const auto                                              settings = parseCommandLine(app);
+	FliLib::AsyncLoggingInitializer<Util::LogConsoleFormatter> logging(settings.logPath);
+	FliLib::TraceInitializer                                   trace(settings.tracePath);
+	FliLib::ResourceReporter                                   resources(settings.resourcesPath);
 	PLOGI << QString("%1 started").arg(APP_ID);
 
 	try
@@ -1,26 +1,33 @@
 ﻿#include <condition_variable>
 #include <queue>
+#include <ranges>
 #include <thread>
 
 #include <QCommandLineParser>
 #include <QCryptographicHash>
 #include <QDir>
 #include <QGuiApplication>
+#include <QSaveFile>
 #include <QStandardPaths>
-
-#include <plog/Appenders/ConsoleAppender.h>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
 #include "fnd/StrUtil.h"
 
+#include "lib/AsyncAppender.h"
+#include "lib/Metrics.h"
+#include "lib/Prefetcher.h"
+#include "lib/Progress.h"
+#include "lib/Resources.h"
+#include "lib/Shard.h"
+#include "lib/Trace.h"
 #include "lib/dump/Factory.h"
 #include "lib/util.h"
-#include "logging/LogAppender.h"
 #include "logging/init.h"
 #include "util/LogConsoleFormatter.h"
 #include "util/bookhash/hashbook.h"
 #include "util/executor/ThreadPool.h"
 #include "util/files.h"
-#include "util/progress.h"
 #include "util/xml/Initializer.h"
 #include "util/xml/XmlWriter.h"
 
@@ -47,24 +54,28 @@ constexpr auto ARCHIVE_WILDCARD_OPTION_NAME = "archives";
 
 struct Options
 {
-	QDir         dstDir;
-	QString      sourceLib;
-	QStringList  args;
-	unsigned int maxThreadCount { std::thread::hardware_concurrency() };
+	QDir             dstDir;
+	QString          sourceLib;
+	QStringList      args;
+	unsigned int     maxThreadCount { std::thread::hardware_concurrency() };
+	Shard            shard;
+	PrefetchSettings prefetch;
 };
 
-void ProcessArchive(const Options& options, const QString& filePath, Progress& progress)
+void ProcessArchive(const Options& options, const ShardItem& item, FliLib::Progress& progress)
 {
-	PLOGI << "process " << filePath;
+	PLOGI << "process " << item.GetName();
 	assert(options.dstDir.exists());
-	BookHashItemProvider bookHashItemProvider(filePath);
-	QFileInfo            fileInfo(filePath);
+	const TraceSpan      span("ProcessArchive", item.GetName());
+	BookHashItemProvider bookHashItemProvider(item.archive);
 
-	QFile output(options.dstDir.filePath(fileInfo.completeBaseName() + ".xml"));
+	QSaveFile output(options.dstDir.filePath(item.GetName() + ".xml"));
 	if (!output.open(QIODevice::WriteOnly))
-		throw std::ios_base::failure(std::format("Cannot create {}", options.dstDir.filePath(fileInfo.completeBaseName() + ".xml")));
+		throw std::ios_base::failure(std::format("Cannot create {}", options.dstDir.filePath(item.GetName() + ".xml")));
 
-	const auto fileList = bookHashItemProvider.GetFiles();
+	auto fileList = bookHashItemProvider.GetFiles();
+	if (item.IsPart())
+		fileList = fileList.mid(static_cast<qsizetype>(item.begin), static_cast<qsizetype>(item.end - item.begin));
 
 	std::vector<BookHashItem> bookHashItems;
 	bookHashItems.reserve(static_cast<size_t>(fileList.size()));
@@ -77,61 +88,68 @@ void ProcessArchive(const Options& options, const QString& filePath, Progress& p
 		auto& bookTaskItem = bookHashItems.emplace_back(bookHashItemProvider.Get(file));
 		threadPool.enqueue([&](QCryptographicHash& md5) {
 			PLOGV << "start parsing: " << bookTaskItem.file;
+			const TraceSpan bookSpan("ParseBookHash", bookTaskItem.file);
 			ParseBookHash(bookTaskItem, md5);
-			progress.Increment(1, bookTaskItem.file.toStdString());
+			progress.Increment(1, bookTaskItem.file);
 		});
 	}
 
 	PLOGI << "wait for threads finished";
 	threadPool.wait();
 
-	XmlWriter  writer(output);
-	const auto booksGuard = writer.Guard("books");
-	booksGuard->WriteAttribute("source", options.sourceLib);
-
-	PLOGV << "writing results";
-	for (const auto& file : bookHashItems)
 	{
-		const auto bookGuard = writer.Guard("book");
-		bookGuard->WriteAttribute("hash", file.parseResult.id)
-			.WriteAttribute("id", file.parseResult.hashText)
-			.WriteAttribute(Inpx::FOLDER, file.folder)
-			.WriteAttribute(Inpx::FILE, file.file)
-			.WriteAttribute("title", file.parseResult.title);
-
-		const auto writeImage = [&](const QString& nodeName, const ImageHashItem& item) {
-			const auto guard = bookGuard->Guard(nodeName);
-			if (!item.file.isEmpty())
-				guard->WriteAttribute("id", item.file);
-			if (item.pHash)
-				guard->WriteAttribute("pHash", QString::number(item.pHash, 16));
-			guard->WriteCharacters(item.hash);
-		};
-
-		if (!file.cover.hash.isEmpty())
-			writeImage(Global::COVER, file.cover);
-		for (const auto& item : file.images)
-			writeImage(Global::IMAGE, item);
-
-		SerializeHashSections(file.parseResult.hashSections, writer);
-
-		if (!file.parseResult.hashValues.empty())
+		const TraceSpan writeSpan("WriteHash", output.fileName());
+		XmlWriter       writer(output);
+		const auto      booksGuard = writer.Guard("books");
+		booksGuard->WriteAttribute("source", options.sourceLib);
+
+		PLOGV << "writing results";
+		for (const auto& file : bookHashItems)
 		{
-			const auto histogram = bookGuard->Guard("histogram");
-			for (const auto& [count, word] : file.parseResult.hashValues)
+			const auto bookGuard = writer.Guard("book");
+			bookGuard->WriteAttribute("hash", file.parseResult.id)
+				.WriteAttribute("id", file.parseResult.hashText)
+				.WriteAttribute(Inpx::FOLDER, file.folder)
+				.WriteAttribute(Inpx::FILE, file.file)
+				.WriteAttribute("title", file.parseResult.title);
+
+			const auto writeImage = [&](const QString& nodeName, const ImageHashItem& item) {
+				const auto guard = bookGuard->Guard(nodeName);
+				if (!item.file.isEmpty())
+					guard->WriteAttribute("id", item.file);
+				if (item.pHash)
+					guard->WriteAttribute("pHash", QString::number(item.pHash, 16));
+				guard->WriteCharacters(item.hash);
+			};
+
+			if (!file.cover.hash.isEmpty())
+				writeImage(Global::COVER, file.cover);
+			for (const auto& item : file.images)
+				writeImage(Global::IMAGE, item);
+
+			SerializeHashSections(file.parseResult.hashSections, writer);
+
+			if (!file.parseResult.hashValues.empty())
 			{
-				auto histogramItem = histogram->Guard("item");
-				histogramItem->WriteAttribute("count", QString::number(count)).WriteAttribute("word", word);
+				const auto histogram = bookGuard->Guard("histogram");
+				for (const auto& [count, word] : file.parseResult.hashValues)
+				{
+					auto histogramItem = histogram->Guard("item");
+					histogramItem->WriteAttribute("count", QString::number(count)).WriteAttribute("word", word);
+				}
 			}
-		}
 
-		if (!file.parseResult.annotation.isEmpty())
-		{
-			const auto guard = bookGuard->Guard("annotation");
-			for (const auto& str : file.parseResult.annotation)
-				guard->WriteStartElement("p").WriteCharacters(str).WriteEndElement();
+			if (!file.parseResult.annotation.isEmpty())
+			{
+				const auto guard = bookGuard->Guard("annotation");
+				for (const auto& str : file.parseResult.annotation)
+					guard->WriteStartElement("p").WriteCharacters(str).WriteEndElement();
+			}
 		}
 	}
+
+	if (!output.commit())
+		throw std::ios_base::failure(std::format("Cannot write {}", output.fileName()));
 }
 
 QStringList GetArchives(const QStringList& wildCards)
@@ -144,6 +162,100 @@ QStringList GetArchives(const QStringList& wildCards)
 	return result;
 }
 
+void MergeHashParts(const QStringList& parts, const QString& dstFileName)
+{
+	QSaveFile output(dstFileName);
+	if (!output.open(QIODevice::WriteOnly))
+		throw std::ios_base::failure(std::format("Cannot create {}", dstFileName));
+
+	const TraceSpan  span("MergeHash", dstFileName);
+	QXmlStreamWriter writer(&output);
+	for (const auto& part : parts)
+	{
+		QFile input(part);
+		if (!input.open(QIODevice::ReadOnly))
+			throw std::ios_base::failure(std::format("Cannot open {}", part));
+
+		const auto       first = &part == &parts.front();
+		QXmlStreamReader reader(&input);
+		for (int depth = 0; !reader.atEnd();)
+		{
+			switch (reader.readNext())
+			{
+				case QXmlStreamReader::StartDocument:
+					if (first)
+						writer.writeCurrentToken(reader);
+					break;
+
+				case QXmlStreamReader::EndDocument:
+					break;
+
+				case QXmlStreamReader::StartElement:
+					if (depth++ > 0 || first)
+						writer.writeCurrentToken(reader);
+					break;
+
+				case QXmlStreamReader::EndElement:
+					if (--depth > 0)
+						writer.writeCurrentToken(reader);
+					break;
+
+				default:
+					if (depth > 0)
+						writer.writeCurrentToken(reader);
+			}
+		}
+
+		if (reader.hasError())
+			throw std::invalid_argument(std::format("{}: {}", part, reader.errorString()));
+	}
+
+	writer.writeEndElement();
+	writer.writeEndDocument();
+	if (writer.hasError() || !output.commit())
+		throw std::ios_base::failure(std::format("Cannot write {}", dstFileName));
+
+	for (const auto& part : parts)
+		QFile::remove(part);
+}
+
+int MergeShards(const Options& options, const ShardPlan& plan)
+{
+	auto result = 0;
+	for (const auto& items : plan | std::views::chunk_by([](const auto& lhs, const auto& rhs) {
+								 return lhs.archive == rhs.archive;
+							 }))
+	{
+		const auto& archive = items.front();
+		const auto  name    = QFileInfo(archive.archive).completeBaseName();
+		try
+		{
+			const auto parts = Shard::FindParts(options.dstDir.path(), archive.archive, archive.total, ".xml");
+			if (parts.empty())
+			{
+				if (!options.dstDir.exists(name + ".xml"))
+					throw std::invalid_argument("no output found");
+				continue;
+			}
+
+			MergeHashParts(
+				parts | std::views::transform([&](const ShardItem& item) {
+					return options.dstDir.filePath(item.GetName() + ".xml");
+				}) | std::ranges::to<QStringList>(),
+				options.dstDir.filePath(name + ".xml")
+			);
+			PLOGI << name << " merged";
+		}
+		catch (const std::exception& ex)
+		{
+			PLOGE << QString("%1 merging failed: %2").arg(name).arg(ex.what());
+			result = 1;
+		}
+	}
+
+	return result;
+}
+
 int run(const Options& options)
 {
 	try
@@ -155,19 +267,31 @@ int run(const Options& options)
 		if (!availableLibraries.contains(options.sourceLib, Qt::CaseInsensitive))
 			throw std::invalid_argument(std::format("{} must be {}", LIBRARY, availableLibraries.join(" | ")));
 
-		const auto archives = GetArchives(options.args);
+		auto archives = GetArchives(options.args);
+		if (options.shard.IsEnabled())
+			archives.sort();
 
 		PLOGD << "Total file count calculation";
-		const auto totalFileCount = std::accumulate(archives.cbegin(), archives.cend(), size_t { 0 }, [](const auto init, const auto& item) {
-			const Zip zip(item);
-			return init + zip.GetFileNameList().size();
+		const auto plan = options.shard.Split(archives, [](const QString& archive) {
+			return static_cast<size_t>(BookHashItemProvider(archive).GetFiles().size());
+		});
+		if (options.shard.IsMerge())
+			return MergeShards(options, plan);
+
+		const auto items          = options.shard.Select(plan);
+		const auto totalFileCount = std::accumulate(items.cbegin(), items.cend(), size_t { 0 }, [](const auto init, const auto& item) {
+			return init + (item.end - item.begin);
 		});
 		PLOGI << "Total file count: " << totalFileCount;
 
-		Progress progress(totalFileCount, "parsing");
+		FliLib::Progress progress(totalFileCount, "parsing");
+		Prefetcher       prefetcher(items | std::views::transform(&ShardItem::archive) | std::ranges::to<QStringList>(), options.prefetch);
 
-		for (const auto& archive : archives)
-			ProcessArchive(options, archive, progress);
+		for (const auto& item : items)
+		{
+			prefetcher.Advance(item.archive);
+			ProcessArchive(options, item, progress);
+		}
 
 		return 0;
 	}
@@ -207,13 +331,19 @@ int main(int argc, char* argv[])
 			{ { QString(THREADS[0]), THREADS }, "Maximum number of CPU threads", QString("Thread count [%1]").arg(options.maxThreadCount) },
     }
 	);
-	const auto defaultLogPath = QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID);
-	const auto logOption      = Log::LoggingInitializer::AddLogFileOption(parser, defaultLogPath);
+	const auto defaultLogPath  = QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID);
+	const auto logOption       = Log::LoggingInitializer::AddLogFileOption(parser, defaultLogPath);
+	const auto traceOption     = TraceInitializer::AddTraceFileOption(parser);
+	const auto metricsOption   = MetricsPublisher::AddMetricsFileOption(parser);
+	const auto resourcesOption = ResourceReporter::AddResourceReportOption(parser);
+	Shard::AddShardOptions(parser);
+	Prefetcher::AddPrefetchOptions(parser);
 	parser.process(app);
 
-	Log::LoggingInitializer                    logging(parser.isSet(logOption) ? parser.value(logOption) : defaultLogPath);
-	plog::ConsoleAppender<LogConsoleFormatter> consoleAppender;
-	Log::LogAppender                           logConsoleAppender(&consoleAppender);
+	FliLib::AsyncLoggingInitializer<LogConsoleFormatter> logging(parser.isSet(logOption) ? parser.value(logOption) : defaultLogPath);
+	TraceInitializer                                     trace(parser.value(traceOption));
+	MetricsPublisher                                     metrics(parser.value(metricsOption));
+	ResourceReporter                                     resources(parser.value(resourcesOption));
 	PLOGI << QString("%1 started").arg(APP_ID);
 
 	if (!parser.isSet(OUTPUT) || parser.positionalArguments().isEmpty())
@@ -228,7 +358,18 @@ int main(int argc, char* argv[])
 	if (parser.isSet(THREADS))
 		options.maxThreadCount = parser.value(THREADS).toUInt();
 
-	options.args = parser.positionalArguments();
+	options.args     = parser.positionalArguments();
+	options.prefetch = Prefetcher::GetPrefetchSettings(parser);
+
+	try
+	{
+		options.shard = Shard::FromCommandLine(parser);
+	}
+	catch (const std::exception& ex)
+	{
+		PLOGE << ex.what();
+		parser.showHelp(1);
+	}
 
 	return run(options);
 }
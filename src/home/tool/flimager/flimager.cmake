@@ -4,10 +4,12 @@ AddTarget(flimager	app_console
 		"${CMAKE_CURRENT_LIST_DIR}"
 	LINK_LIBRARIES
 		Boost::headers
+		libjxl::libjxl
 		Qt${QT_MAJOR_VERSION}::Core
 		Qt${QT_MAJOR_VERSION}::Gui
 	LINK_TARGETS
 		fljxl
+		lib
 		logging
 		util
 		zip
@@ -1,26 +1,41 @@
 ﻿#include <mutex>
+#include <optional>
 #include <queue>
 #include <ranges>
 #include <thread>
+#include <unordered_set>
 
 #include <QBuffer>
 #include <QCommandLineParser>
 #include <QCoreApplication>
 #include <QDir>
 #include <QGuiApplication>
+#include <QImageReader>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QPixmap>
+#include <QSaveFile>
 #include <QSize>
 #include <QStandardPaths>
 #include <QString>
 
-#include <plog/Appenders/ConsoleAppender.h>
+#include <boost/crc.hpp>
+
+#include <jxl/decode.h>
 #include <plog/Formatters/TxtFormatter.h>
 #include <plog/Util.h>
 
 #include "fnd/ScopedCall.h"
 
 #include "jxl/jxl.h"
-#include "logging/LogAppender.h"
+#include "lib/AsyncAppender.h"
+#include "lib/ImageArchive.h"
+#include "lib/ImageScaler.h"
+#include "lib/Prefetcher.h"
+#include "lib/Resources.h"
+#include "lib/Trace.h"
+#include "lib/ZipStreamWriter.h"
+#include "lib/ZipTail.h"
 #include "logging/init.h"
 #include "util/ImageUtil.h"
 #include "util/LogConsoleFormatter.h"
@@ -45,28 +60,255 @@ constexpr auto MAX_WIDTH_OPTION_NAME              = "max-width";
 constexpr auto MAX_HEIGHT_OPTION_NAME             = "max-height";
 constexpr auto GRAYSCALE_OPTION_NAME              = "grayscale";
 constexpr auto MAX_THREAD_COUNT_OPTION_NAME       = "threads";
+constexpr auto PASSTHROUGH_OPTION_NAME            = "passthrough";
+constexpr auto FORCE_OPTION_NAME                  = "force";
+constexpr auto RENDITION_OPTION_NAME              = "rendition";
 constexpr auto FOLDER                             = "folder";
 constexpr auto QUALITY                            = "quality [-1]";
 constexpr auto SIZE                               = "size [INT_MAX]";
 constexpr auto THREADS                            = "threads [%1]";
 constexpr auto FORMAT                             = "format";
+constexpr auto RENDITION                          = "folder[;format[;quality[;size|WxH]]]";
+constexpr auto MANIFEST_FILE_NAME                 = "flimager.manifest.json";
 
 using Queue = std::queue<QString>;
 
+class Manifest
+{
+	NON_COPY_MOVABLE(Manifest)
+
+public:
+	explicit Manifest(const QDir& outputDir)
+		: m_fileName { outputDir.filePath(MANIFEST_FILE_NAME) }
+	{
+		QFile file(m_fileName);
+		if (!file.exists())
+			return;
+
+		if (!file.open(QIODevice::ReadOnly))
+			throw std::ios_base::failure(QString("Cannot read %1").arg(m_fileName).toStdString());
+
+		QJsonParseError jsonParseError;
+		const auto      doc = QJsonDocument::fromJson(file.readAll(), &jsonParseError);
+		if (jsonParseError.error != QJsonParseError::NoError)
+		{
+			PLOGW << m_fileName << ": " << jsonParseError.errorString() << ", all archives will be rebuilt";
+			return;
+		}
+
+		m_items = doc.object();
+	}
+
+public:
+	bool IsUpToDate(const QString& archive, const QJsonObject& state) const
+	{
+		std::lock_guard lock(m_guard);
+		return m_items.value(archive).toObject() == state;
+	}
+
+	void Update(const QString& archive, QJsonObject state)
+	{
+		std::lock_guard lock(m_guard);
+		m_items.insert(archive, std::move(state));
+		Save();
+	}
+
+	void Remove(const QString& archive)
+	{
+		std::lock_guard lock(m_guard);
+		if (!m_items.contains(archive))
+			return;
+
+		m_items.remove(archive);
+		Save();
+	}
+
+private:
+	void Save() const
+	{
+		QSaveFile file(m_fileName);
+		if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(m_items).toJson()) < 0 || !file.commit())
+			throw std::ios_base::failure(QString("Cannot write %1").arg(m_fileName).toStdString());
+	}
+
+private:
+	const QString      m_fileName;
+	mutable std::mutex m_guard;
+	QJsonObject        m_items;
+};
+
+struct Rendition
+{
+	QDir    outputDir;
+	QString format { JXL::FORMAT };
+	int     quality { -1 };
+	QSize   size { std::numeric_limits<int>::max(), std::numeric_limits<int>::max() };
+
+	std::shared_ptr<Manifest> manifest;
+};
+
 struct Settings
 {
-	QDir        outputDir;
-	QString     inputDir;
-	QStringList inputFiles;
-	QString     format { JXL::FORMAT };
-	int         quality { -1 };
-	bool        grayScale { false };
-	QSize       size { std::numeric_limits<int>::max(), std::numeric_limits<int>::max() };
-	size_t      maxThreadCount { static_cast<size_t>(std::thread::hardware_concurrency()) };
-	int         totalImageCount { 0 };
-	QString     logFileName;
+	std::vector<Rendition>   renditions;
+	QString                  inputDir;
+	QStringList              inputFiles;
+	bool                     grayScale { false };
+	bool                     passthrough { false };
+	bool                     force { false };
+	size_t                   maxThreadCount { static_cast<size_t>(std::thread::hardware_concurrency()) };
+	int                      totalImageCount { 0 };
+	QString                  logFileName;
+	QString                  traceFileName;
+	QString                  resourcesFileName;
+	FliLib::PrefetchSettings prefetch;
 };
 
+struct Counters
+{
+	std::atomic_int image { 0 };
+	std::atomic_int recoded { 0 };
+	std::atomic_int copied { 0 };
+};
+
+struct SourceSettings
+{
+	bool known { false };
+	int  quality { -1 };
+};
+
+struct ImageHeader
+{
+	QString format;
+	QSize   size;
+	bool    grayScale { false };
+	bool    hasAlpha { false };
+};
+
+QByteArray CreateComment(const Settings& settings, const Rendition& rendition)
+{
+	return QString("%1;format=%2;quality=%3;grayscale=%4;width=%5;height=%6")
+	    .arg(APP_ID)
+	    .arg(rendition.format)
+	    .arg(rendition.quality)
+	    .arg(settings.grayScale ? 1 : 0)
+	    .arg(rendition.size.width())
+	    .arg(rendition.size.height())
+	    .toUtf8();
+}
+
+SourceSettings GetSourceSettings(const QString& fileName)
+{
+	QString comment;
+	try
+	{
+		comment = QString::fromUtf8(FliLib::ReadZipTail(fileName).comment);
+	}
+	catch (const std::exception& ex)
+	{
+		PLOGW << ex.what();
+		return {};
+	}
+
+	const auto items = comment.split(';');
+	if (items.front() != APP_ID)
+		return {};
+
+	SourceSettings result { .known = true };
+	for (const auto& item : items | std::views::drop(1))
+	{
+		const auto pos = item.indexOf('=');
+		if (pos < 0)
+			continue;
+
+		const auto key   = item.first(pos);
+		const auto value = item.sliced(pos + 1);
+		if (key == "quality")
+			result.quality = value.toInt();
+	}
+
+	return result;
+}
+
+QString GetCentralDirectoryCrc(const QString& fileName)
+{
+	try
+	{
+		const auto         centralDirectory = FliLib::ReadCentralDirectory(fileName, FliLib::ReadZipTail(fileName));
+		boost::crc_32_type crc;
+		crc.process_bytes(centralDirectory.constData(), static_cast<size_t>(centralDirectory.size()));
+		return QString::number(crc.checksum(), 16).rightJustified(8, '0');
+	}
+	catch (const std::exception& ex)
+	{
+		PLOGW << ex.what();
+	}
+	return {};
+}
+
+QJsonObject GetArchiveState(const QString& fileName, const QString& crc, const Settings& settings, const Rendition& rendition)
+{
+	const QFileInfo fileInfo(fileName);
+	return {
+		{     "size",                                        fileInfo.size() },
+		{ "modified",            fileInfo.lastModified().toMSecsSinceEpoch() },
+		{      "crc",                                                    crc },
+		{ "settings", QString::fromUtf8(CreateComment(settings, rendition)) },
+	};
+}
+
+QString GetOutputFileName(const Rendition& rendition, const QString& fileName)
+{
+	return rendition.outputDir.filePath(QString(fileName).remove(':'));
+}
+
+bool IsQualityAcceptable(const int source, const int target)
+{
+	return target < 0 ? source < 0 : source >= 0 && source <= target;
+}
+
+ImageHeader ProbeJxl(const QByteArray& src)
+{
+	const std::unique_ptr<JxlDecoder, decltype(&JxlDecoderDestroy)> decoder(JxlDecoderCreate(nullptr), &JxlDecoderDestroy);
+	if (!decoder || JxlDecoderSubscribeEvents(decoder.get(), JXL_DEC_BASIC_INFO) != JXL_DEC_SUCCESS)
+		return {};
+
+	if (JxlDecoderSetInput(decoder.get(), reinterpret_cast<const uint8_t*>(src.constData()), static_cast<size_t>(src.size())) != JXL_DEC_SUCCESS)
+		return {};
+	JxlDecoderCloseInput(decoder.get());
+
+	JxlBasicInfo info {};
+	if (JxlDecoderProcessInput(decoder.get()) != JXL_DEC_BASIC_INFO || JxlDecoderGetBasicInfo(decoder.get(), &info) != JXL_DEC_SUCCESS)
+		return {};
+
+	return {
+		.format    = JXL::FORMAT,
+		.size      = QSize(static_cast<int>(info.xsize), static_cast<int>(info.ysize)),
+		.grayScale = info.num_color_channels == 1,
+		.hasAlpha  = info.alpha_bits > 0,
+	};
+}
+
+ImageHeader Probe(const QByteArray& src)
+{
+	if (const auto signature = JxlSignatureCheck(reinterpret_cast<const uint8_t*>(src.constData()), static_cast<size_t>(src.size())); signature == JXL_SIG_CODESTREAM || signature == JXL_SIG_CONTAINER)
+		return ProbeJxl(src);
+
+	QBuffer buffer;
+	buffer.setData(src);
+	buffer.open(QIODevice::ReadOnly);
+
+	QImageReader reader(&buffer);
+	const auto   imageFormat = reader.imageFormat();
+	const auto   pixelFormat = QImage::toPixelFormat(imageFormat);
+
+	return {
+		.format    = QString::fromLatin1(reader.format()).toUpper(),
+		.size      = reader.size(),
+		.grayScale = pixelFormat.colorModel() == QPixelFormat::Grayscale || imageFormat == QImage::Format_Mono || imageFormat == QImage::Format_MonoLSB,
+		.hasAlpha  = pixelFormat.alphaUsage() == QPixelFormat::UsesAlpha,
+	};
+}
+
 QByteArray Encode(const QImage& image, const char* format, const int quality)
 {
 	QByteArray result;
@@ -88,22 +330,39 @@ QByteArray EncodePng(const QImage& image, const int quality)
 	return Encode(image, "png", quality);
 }
 
+using Encoder = QByteArray (*)(const QImage& image, int quality);
+
+Encoder GetEncoder(const QString& format)
+{
+	return format == "PNG" ? &EncodePng : format == "JPEG" ? &EncodeJpeg : &JXL::Encode;
+}
+
+struct Output
+{
+	const Rendition*                         rendition;
+	QString                                  fileName;
+	QJsonObject                              state;
+	Encoder                                  encoder;
+	bool                                     canCopy;
+	std::unique_ptr<FliLib::ZipStreamWriter> writer;
+	int                                      recoded { 0 };
+	int                                      copied { 0 };
+	int                                      failed { 0 };
+};
+
 class Worker
 {
 	NON_COPY_MOVABLE(Worker)
 
 public:
-	Worker(const Settings& settings, std::mutex& queueGuard, Queue& queue, std::atomic_bool& hasError, std::atomic_int& imageCount)
+	Worker(const Settings& settings, std::mutex& queueGuard, Queue& queue, FliLib::Prefetcher& prefetcher, std::atomic_bool& hasError, Counters& counters)
 		: m_settings { settings }
 		, m_queueGuard { queueGuard }
 		, m_queue { queue }
+		, m_prefetcher { prefetcher }
 		, m_hasError { hasError }
-		, m_imageCount { imageCount }
+		, m_counters { counters }
 		, m_thread { &Worker::Process, this }
-		, m_encoder { settings.format == JXL::FORMAT ? &JXL::Encode
-		              : settings.format == "PNG"     ? &EncodePng
-		              : settings.format == "JPEG"    ? &EncodeJpeg
-		                                             : &JXL::Encode }
 	{
 	}
 
@@ -128,6 +387,8 @@ private:
 				m_queue.pop();
 			}
 
+			m_prefetcher.Advance(m_settings.inputDir + archive);
+
 			PLOGI << "process " << archive << " started";
 
 			try
@@ -145,43 +406,63 @@ private:
 
 	void ProcessArchive(const QString& fileName) const
 	{
-		const auto outputFileName = m_settings.outputDir.filePath(QString(fileName).remove(':'));
-		if (QFile::exists(outputFileName) && !QFile::remove(outputFileName))
-			throw std::ios_base::failure(QString("Cannot remove %1").arg(outputFileName).toStdString());
+		const FliLib::TraceSpan span("ProcessArchive", fileName);
+		const auto              inputFileName  = m_settings.inputDir + fileName;
+		const auto              crc            = GetCentralDirectoryCrc(inputFileName);
+		const auto              sourceSettings = GetSourceSettings(inputFileName);
 
-		auto recoded = Recode(m_settings.inputDir + fileName);
-		Write(outputFileName, std::move(recoded));
-	}
+		std::vector<Output> outputs;
+		for (const auto& rendition : m_settings.renditions)
+		{
+			auto       state          = GetArchiveState(inputFileName, crc, m_settings, rendition);
+			const auto outputFileName = GetOutputFileName(rendition, fileName);
+			if (!m_settings.force && QFile::exists(outputFileName) && rendition.manifest->IsUpToDate(fileName, state))
+				continue;
 
-	void Write(const QString& outputFileName, std::vector<std::tuple<QString, QByteArray, QDateTime>> data) const
-	{
-		PLOGI << "archive " << data.size() << " images to " << outputFileName;
+			if (const auto dstDir = QFileInfo(outputFileName).dir(); !dstDir.exists() && !dstDir.mkpath("."))
+				throw std::ios_base::failure(QString("Cannot create %1").arg(dstDir.path()).toStdString());
+
+			auto writer = std::make_unique<FliLib::ZipStreamWriter>(outputFileName);
+			writer->SetComment(CreateComment(m_settings, rendition));
 
-		if (const auto dstDir = QFileInfo(outputFileName).dir(); !dstDir.exists() && !dstDir.mkpath("."))
-			throw std::ios_base::failure(QString("Cannot create %1").arg(dstDir.path()).toStdString());
+			const auto canCopy = m_settings.passthrough || (sourceSettings.known && IsQualityAcceptable(sourceSettings.quality, rendition.quality));
+			outputs.emplace_back(&rendition, outputFileName, std::move(state), GetEncoder(rendition.format), canCopy, std::move(writer));
+		}
+
+		if (outputs.empty())
+			return;
 
-		auto zipFiles = Zip::CreateZipFileController();
-		for (auto&& [fileName, body, time] : data)
-			zipFiles->AddFile(std::move(fileName), body, std::move(time));
+		std::ranges::sort(outputs, std::greater {}, [](const Output& item) {
+			return static_cast<int64_t>(item.rendition->size.width()) * item.rendition->size.height();
+		});
 
-		Zip zip(outputFileName, Zip::Format::Zip);
-		zip.SetProperty(Zip::PropertyId::CompressionLevel, QVariant::fromValue(Zip::CompressionLevel::Ultra));
-		zip.SetProperty(Zip::PropertyId::ThreadsCount, static_cast<qulonglong>(m_settings.maxThreadCount));
-		zip.Write(*zipFiles);
+		Recode(inputFileName, outputs);
 
-		PLOGI << "archive " << outputFileName << " done";
+		for (auto& output : outputs)
+		{
+			const auto count = output.writer->Close();
+			if (output.failed != 0)
+			{
+				// an incomplete output must be rebuilt by the next run
+				output.rendition->manifest->Remove(fileName);
+				PLOGE << "archive " << count << " images (recoded: " << output.recoded << ", copied: " << output.copied << ", failed: " << output.failed << ") to " << output.fileName << " incomplete";
+				continue;
+			}
+
+			output.rendition->manifest->Update(fileName, std::move(output.state));
+			PLOGI << "archive " << count << " images (recoded: " << output.recoded << ", copied: " << output.copied << ") to " << output.fileName << " done";
+		}
 	}
 
-	std::vector<std::tuple<QString, QByteArray, QDateTime>> Recode(const QString& fileName) const
+	void Recode(const QString& fileName, std::vector<Output>& outputs) const
 	{
 		const QFileInfo fileInfo(fileName);
 
-		std::vector<std::tuple<QString, QByteArray, QDateTime>> result;
-		const Zip                                               zip(fileInfo.filePath());
-		for (auto imageFile : zip.GetFileNameList())
+		const FliLib::ImageArchive archive(fileInfo.filePath());
+		for (const auto& imageFile : archive.GetFileNameList())
 		{
-			const ScopedCall fileCountGuard([&, percents = m_imageCount * 100 / m_settings.totalImageCount]() {
-				int        imageCount      = ++m_imageCount;
+			const ScopedCall fileCountGuard([&, percents = m_counters.image * 100 / m_settings.totalImageCount]() {
+				int        imageCount      = ++m_counters.image;
 				const auto currentPercents = imageCount * 100 / m_settings.totalImageCount;
 				if (percents != currentPercents || imageCount % 100 == 0)
 				{
@@ -189,23 +470,63 @@ private:
 				}
 			});
 
-			const auto imageBody = zip.Read(imageFile)->GetStream().readAll();
-			if (auto recoded = Recode(imageBody); !recoded.isEmpty())
-			{
-				auto time = zip.GetFileTime(imageFile);
-				result.emplace_back(std::move(imageFile), std::move(recoded), std::move(time));
-			}
-			else
+			const FliLib::TraceSpan imageSpan("ProcessImage", imageFile);
+			const auto              imageBody = archive.Read(imageFile);
+			const auto              time      = archive.GetFileTime(imageFile);
+
+			std::optional<ImageHeader> header;
+			std::vector<QImage>        pyramid;
+
+			for (auto& output : outputs)
 			{
-				m_hasError = true;
-				PLOGE << "Cannot recode " << fileInfo.fileName() << "/" << imageFile;
+				if (output.canCopy)
+				{
+					if (!header)
+						header = Probe(imageBody);
+
+					if (IsSatisfied(*header, *output.rendition))
+					{
+						output.writer->Add(imageFile, imageBody, time);
+						++output.copied;
+						++m_counters.copied;
+						continue;
+					}
+				}
+
+				if (pyramid.empty())
+					pyramid.emplace_back(Decode(imageBody));
+
+				auto recoded = pyramid.front().isNull() ? QByteArray {} : output.encoder(GetLevel(pyramid, output.rendition->size), output.rendition->quality);
+				if (recoded.isEmpty())
+				{
+					m_hasError = true;
+					PLOGE << "Cannot recode " << fileInfo.fileName() << "/" << imageFile << " to " << output.fileName;
+					++output.failed;
+					continue;
+				}
+
+				output.writer->Add(imageFile, std::move(recoded), time);
+				++output.recoded;
+				++m_counters.recoded;
 			}
 		}
+	}
+
+	bool IsSatisfied(const ImageHeader& header, const Rendition& rendition) const
+	{
+		if (header.size.isEmpty() || header.size.width() > rendition.size.width() || header.size.height() > rendition.size.height())
+			return false;
+
+		if (m_settings.grayScale && !header.grayScale)
+			return false;
+
+		if (header.format.compare(rendition.format, Qt::CaseInsensitive) == 0)
+			return true;
 
-		return result;
+		return rendition.format == "JPEG" && header.format == "PNG" && header.hasAlpha;
 	}
 
-	QByteArray Recode(const QByteArray& src) const
+	QImage Decode(const QByteArray& src) const
 	{
 		auto image = Util::Decode(src).toImage();
 		if (image.isNull())
@@ -217,23 +538,38 @@ private:
 		if (image.pixelFormat().colorModel() != QPixelFormat::Grayscale)
 			image = Util::HasAlpha(image, src.constData());
 
-		const bool hasAlpha = image.pixelFormat().alphaUsage() == QPixelFormat::UsesAlpha;
-		if (image.width() > m_settings.size.width() || image.height() > m_settings.size.height())
-			image = image.scaled(m_settings.size.width(), m_settings.size.height(), Qt::KeepAspectRatio, hasAlpha ? Qt::FastTransformation : Qt::SmoothTransformation);
+		return image;
+	}
+
+	static QImage GetLevel(std::vector<QImage>& pyramid, const QSize& maxSize)
+	{
+		const auto& original = pyramid.front();
+		if (original.width() <= maxSize.width() && original.height() <= maxSize.height())
+			return original;
 
-		assert(m_encoder);
-		return m_encoder(image, m_settings.quality);
+		const auto size = original.size().scaled(maxSize, Qt::KeepAspectRatio);
+
+		const QImage* source = &original;
+		for (const auto& level : pyramid)
+			if (level.width() >= size.width() && level.height() >= size.height() && level.width() * level.height() < source->width() * source->height())
+				source = &level;
+
+		if (source->size() == size)
+			return *source;
+
+		auto scaled = FliLib::Scale(*source, size);
+		pyramid.push_back(scaled);
+		return scaled;
 	}
 
 private:
-	const Settings&   m_settings;
-	std::mutex&       m_queueGuard;
-	Queue&            m_queue;
-	std::atomic_bool& m_hasError;
-	std::atomic_int&  m_imageCount;
-	std::thread       m_thread;
-	using Encoder = QByteArray (*)(const QImage& image, int quality);
-	Encoder m_encoder { nullptr };
+	const Settings&     m_settings;
+	std::mutex&         m_queueGuard;
+	Queue&              m_queue;
+	FliLib::Prefetcher& m_prefetcher;
+	std::atomic_bool&   m_hasError;
+	Counters&           m_counters;
+	std::thread         m_thread;
 };
 
 bool ProcessArchives(const Settings& settings)
@@ -241,9 +577,15 @@ bool ProcessArchives(const Settings& settings)
 	std::atomic_bool hasError { false };
 
 	{
-		std::mutex      queueGuard;
-		Queue           queue;
-		std::atomic_int imageCount { 0 };
+		std::mutex         queueGuard;
+		Queue              queue;
+		Counters           counters;
+		FliLib::Prefetcher prefetcher(
+			settings.inputFiles | std::views::transform([&](const QString& archive) {
+				return settings.inputDir + archive;
+			}) | std::ranges::to<QStringList>(),
+			settings.prefetch
+		);
 
 		for (const auto& archive : settings.inputFiles)
 			queue.push(archive);
@@ -251,7 +593,10 @@ bool ProcessArchives(const Settings& settings)
 		std::vector<std::unique_ptr<Worker>> workers;
 		workers.reserve(settings.maxThreadCount);
 		for (size_t i = 0; i < settings.maxThreadCount; ++i)
-			workers.emplace_back(std::make_unique<Worker>(settings, queueGuard, queue, hasError, imageCount));
+			workers.emplace_back(std::make_unique<Worker>(settings, queueGuard, queue, prefetcher, hasError, counters));
+		workers.clear();
+
+		PLOGI << "images recoded: " << counters.recoded << ", copied: " << counters.copied;
 	}
 
 	return hasError;
@@ -282,7 +627,23 @@ void GetArchives(Settings& settings, const QStringList& wildCards)
 		std::ranges::transform(settings.inputFiles, settings.inputFiles.begin(), [n = settings.inputDir.length()](const QString& item) {
 			return item.last(item.length() - n);
 		});
+}
 
+void SkipUnchanged(Settings& settings)
+{
+	const auto total = settings.inputFiles.size();
+	settings.inputFiles.removeIf([&](const QString& file) {
+		const auto inputFileName = settings.inputDir + file;
+		const auto crc           = GetCentralDirectoryCrc(inputFileName);
+		return std::ranges::all_of(settings.renditions, [&](const Rendition& rendition) {
+			return QFile::exists(GetOutputFileName(rendition, file)) && rendition.manifest->IsUpToDate(file, GetArchiveState(inputFileName, crc, settings, rendition));
+		});
+	});
+	PLOGI << total - settings.inputFiles.size() << " of " << total << " archives are unchanged and skipped";
+}
+
+void CountImages(Settings& settings)
+{
 	PLOGD << "Total image count calculation";
 	settings.totalImageCount = std::accumulate(settings.inputFiles.cbegin(), settings.inputFiles.cend(), settings.totalImageCount, [&](const auto init, const QString& file) {
 		const Zip zip(settings.inputDir + file);
@@ -291,6 +652,59 @@ void GetArchives(Settings& settings, const QStringList& wildCards)
 	PLOGI << "Total image count: " << settings.totalImageCount;
 }
 
+QSize ParseSize(const QString& value)
+{
+	bool ok = false;
+
+	const auto splitted = value.split('x', Qt::SkipEmptyParts, Qt::CaseInsensitive);
+	if (splitted.size() == 1)
+		if (const auto size = splitted.front().toInt(&ok); ok)
+			return { size, size };
+
+	if (splitted.size() == 2)
+		if (const auto width = splitted.front().toInt(&ok); ok)
+			if (const auto height = splitted.back().toInt(&ok); ok)
+				return { width, height };
+
+	throw std::invalid_argument(QString("Invalid size: %1").arg(value).toStdString());
+}
+
+QString ParseFormat(const QString& value)
+{
+	if (value.compare(JXL::FORMAT, Qt::CaseInsensitive) == 0)
+		return JXL::FORMAT;
+
+	auto format = value.toUpper();
+	if (format != "JPEG" && format != "PNG")
+		throw std::invalid_argument(QString("Unknown output format: %1").arg(value).toStdString());
+	return format;
+}
+
+Rendition ParseRendition(const QString& value, const Rendition& defaults)
+{
+	const auto splitted = value.split(';');
+	if (splitted.front().isEmpty())
+		throw std::invalid_argument(QString("Output folder is not specified in %1").arg(value).toStdString());
+
+	Rendition rendition { .outputDir = QDir { splitted.front() }, .format = defaults.format };
+
+	if (splitted.size() > 1 && !splitted[1].isEmpty())
+		rendition.format = ParseFormat(splitted[1]);
+
+	if (splitted.size() > 2 && !splitted[2].isEmpty())
+	{
+		bool ok           = false;
+		rendition.quality = splitted[2].toInt(&ok);
+		if (!ok)
+			throw std::invalid_argument(QString("Invalid quality in %1").arg(value).toStdString());
+	}
+
+	if (splitted.size() > 3 && !splitted[3].isEmpty())
+		rendition.size = ParseSize(splitted[3]);
+
+	return rendition;
+}
+
 Settings ProcessCommandLine(const QCoreApplication& app)
 {
 	Settings settings;
@@ -302,22 +716,31 @@ Settings ProcessCommandLine(const QCoreApplication& app)
 	parser.addPositionalArgument(IMAGE_ARCHIVE_WILDCARD_OPTION_NAME, "Input image archive files (required)");
 	parser.addOptions(
 		{
-			{ { "o", FOLDER }, "Output folder (required)", FOLDER },
+			{ { "o", FOLDER }, "Output folder (required if no rendition specified)", FOLDER },
 			{ { "f", FORMAT }, "Output images format [JXL | JPEG | PNG]", QString("%1 [%2]").arg(FORMAT, "JXL") },
 			{ { "q", QUALITY_OPTION_NAME }, "Compression quality [0, 100] or -1 for default compression quality", QUALITY },
 			{ MAX_WIDTH_OPTION_NAME, "Maximum images width", SIZE },
 			{ MAX_HEIGHT_OPTION_NAME, "Maximum images height", SIZE },
 			{ { "s", MAX_SIZE_OPTION_NAME }, "Maximum image size", SIZE },
+			{ { "r", RENDITION_OPTION_NAME }, "Additional output profile, may be repeated. Every image is decoded once for all profiles", RENDITION },
 			{ { "g", GRAYSCALE_OPTION_NAME }, "Convert all images to grayscale" },
+			{ { "p", PASSTHROUGH_OPTION_NAME }, "Copy images already matching format, size and color settings without recoding, even if their quality is unknown" },
+			{ FORCE_OPTION_NAME, "Rebuild all output archives, even unchanged since the previous run" },
 			{ { "t", MAX_THREAD_COUNT_OPTION_NAME }, "Maximum number of CPU threads", QString(THREADS).arg(settings.maxThreadCount) },
     }
 	);
 
-	const auto defaultLogPath = QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID);
-	const auto logOption      = Log::LoggingInitializer::AddLogFileOption(parser, defaultLogPath);
+	const auto defaultLogPath  = QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID);
+	const auto logOption       = Log::LoggingInitializer::AddLogFileOption(parser, defaultLogPath);
+	const auto traceOption     = FliLib::TraceInitializer::AddTraceFileOption(parser);
+	const auto resourcesOption = FliLib::ResourceReporter::AddResourceReportOption(parser);
+	FliLib::Prefetcher::AddPrefetchOptions(parser);
 	parser.process(app);
 
-	settings.logFileName = parser.isSet(logOption) ? parser.value(logOption) : defaultLogPath;
+	settings.logFileName       = parser.isSet(logOption) ? parser.value(logOption) : defaultLogPath;
+	settings.traceFileName     = parser.value(traceOption);
+	settings.resourcesFileName = parser.value(resourcesOption);
+	settings.prefetch          = FliLib::Prefetcher::GetPrefetchSettings(parser);
 
 	bool ok = false;
 
@@ -331,32 +754,41 @@ Settings ProcessCommandLine(const QCoreApplication& app)
 		parser.showHelp();
 	}
 
-	if (parser.isSet(FOLDER))
-	{
-		settings.outputDir = QDir { parser.value(FOLDER) };
-	}
-	else
-	{
-		PLOGE << "Specifying output folder is mandatory";
-		parser.showHelp();
-	}
-
-	settings.grayScale = parser.isSet(GRAYSCALE_OPTION_NAME);
+	Rendition rendition;
 
-	if (auto value = parser.value(FORMAT); !value.isEmpty())
-		settings.format = std::move(value);
+	if (const auto value = parser.value(FORMAT); !value.isEmpty())
+		rendition.format = ParseFormat(value);
 
 	if (const auto value = parser.value(MAX_SIZE_OPTION_NAME).toInt(&ok); ok)
-		settings.size = { value, value };
+		rendition.size = { value, value };
 
 	if (const auto value = parser.value(MAX_WIDTH_OPTION_NAME).toInt(&ok); ok)
-		settings.size.setWidth(value);
+		rendition.size.setWidth(value);
 
 	if (const auto value = parser.value(MAX_HEIGHT_OPTION_NAME).toInt(&ok); ok)
-		settings.size.setHeight(value);
+		rendition.size.setHeight(value);
 
 	if (const auto value = parser.value(QUALITY_OPTION_NAME).toInt(&ok); ok)
-		settings.quality = value;
+		rendition.quality = value;
+
+	if (parser.isSet(FOLDER))
+	{
+		rendition.outputDir = QDir { parser.value(FOLDER) };
+		settings.renditions.emplace_back(rendition);
+	}
+
+	for (const auto& value : parser.values(RENDITION_OPTION_NAME))
+		settings.renditions.emplace_back(ParseRendition(value, rendition));
+
+	if (settings.renditions.empty())
+	{
+		PLOGE << "Specifying output folder or rendition is mandatory";
+		parser.showHelp();
+	}
+
+	settings.grayScale   = parser.isSet(GRAYSCALE_OPTION_NAME);
+	settings.passthrough = parser.isSet(PASSTHROUGH_OPTION_NAME);
+	settings.force       = parser.isSet(FORCE_OPTION_NAME);
 
 	if (const auto value = parser.value(MAX_THREAD_COUNT_OPTION_NAME).toULongLong(&ok); ok)
 		settings.maxThreadCount = value;
@@ -364,8 +796,22 @@ Settings ProcessCommandLine(const QCoreApplication& app)
 	if (QCoreApplication::arguments().size() < 2)
 		parser.showHelp();
 
-	if (!settings.outputDir.exists() && !settings.outputDir.mkpath("."))
-		throw std::ios_base::failure(QString("Cannot create folder %1").arg(settings.outputDir.path()).toStdString());
+	std::unordered_set<QString> outputDirs;
+	for (auto& item : settings.renditions)
+	{
+		if (!item.outputDir.exists() && !item.outputDir.mkpath("."))
+			throw std::ios_base::failure(QString("Cannot create folder %1").arg(item.outputDir.path()).toStdString());
+
+		if (!outputDirs.emplace(item.outputDir.canonicalPath()).second)
+			throw std::invalid_argument(QString("Output folder %1 is used by several renditions").arg(item.outputDir.path()).toStdString());
+
+		item.manifest = std::make_shared<Manifest>(item.outputDir);
+	}
+
+	if (!settings.force)
+		SkipUnchanged(settings);
+
+	CountImages(settings);
 
 	return settings;
 }
@@ -375,10 +821,10 @@ bool run(int argc, char* argv[])
 	const QGuiApplication app(argc, argv); //-V821
 	QCoreApplication::setApplicationName(APP_ID);
 	QCoreApplication::setApplicationVersion(PRODUCT_VERSION);
-	const auto                                       settings = ProcessCommandLine(app);
-	Log::LoggingInitializer                          logging(settings.logFileName);
-	plog::ConsoleAppender<Util::LogConsoleFormatter> consoleAppender;
-	Log::LogAppender                                 logConsoleAppender(&consoleAppender);
+	const auto                                              settings = ProcessCommandLine(app);
+	FliLib::AsyncLoggingInitializer<Util::LogConsoleFormatter> logging(settings.logFileName);
+	FliLib::TraceInitializer                                   trace(settings.traceFileName);
+	FliLib::ResourceReporter                                   resources(settings.resourcesFileName);
 	PLOGI << QString("%1 started").arg(APP_ID);
 	return ProcessArchives(settings);
 }
@@ -5,24 +5,30 @@
 #include <QCommandLineParser>
 #include <QStandardPaths>
 
-#include <plog/Appenders/ConsoleAppender.h>
-
 #include "fnd/ScopedCall.h"
 #include "fnd/StrUtil.h"
 
 #include "impl/FileItem.h"
+#include "lib/AsyncAppender.h"
+#include "lib/BlobStore.h"
+#include "lib/ImageArchive.h"
+#include "lib/Metrics.h"
+#include "lib/Prefetcher.h"
+#include "lib/Progress.h"
+#include "lib/Resources.h"
+#include "lib/Trace.h"
 #include "lib/UniqueFile.h"
+#include "lib/ZipStreamWriter.h"
+#include "lib/ZipTail.h"
 #include "lib/archive.h"
 #include "lib/book.h"
 #include "lib/dump/Factory.h"
 #include "lib/dump/IDump.h"
-#include "logging/LogAppender.h"
 #include "logging/init.h"
 #include "util/BookUtil.h"
 #include "util/LogConsoleFormatter.h"
 #include "util/StrUtil.h"
 #include "util/bookhash/hashparser.h"
-#include "util/progress.h"
 #include "util/xml/Initializer.h"
 #include "util/xml/SaxParser.h"
 #include "util/xml/XmlAttributes.h"
@@ -52,12 +58,16 @@ using Replacement = std::unordered_map<BookItem, BookItem, Util::PairHash<QStrin
 
 struct Settings
 {
-	QDir        outputDir;
-	QDir        hashDir;
-	QStringList arguments;
-	QString     logFileName;
-	QString     dumpWildCards;
-	int         hammingThreshold { 10 };
+	QDir             outputDir;
+	QDir             hashDir;
+	QStringList      arguments;
+	QString          logFileName;
+	QString          traceFileName;
+	QString          metricsFileName;
+	QString          resourcesFileName;
+	QString          dumpWildCards;
+	int              hammingThreshold { 10 };
+	PrefetchSettings prefetch;
 };
 
 class UniqueFileConflictResolver final : public UniqueFileStorage::IUniqueFileConflictResolver
@@ -153,7 +163,7 @@ private:
 class ReplacementGetter final : Util::HashParser::IObserver
 {
 public:
-	ReplacementGetter(const Archive& archive, UniqueFileStorage& uniqueFileStorage, InpDataProvider& inpDataProvider, Util::Progress& progress)
+	ReplacementGetter(const Archive& archive, UniqueFileStorage& uniqueFileStorage, InpDataProvider& inpDataProvider, Progress& progress)
 		: m_fileInfo { archive.filePath }
 		, m_uniqueFileStorage { uniqueFileStorage }
 		, m_inpDataProvider { inpDataProvider }
@@ -187,7 +197,7 @@ private:
 		if (!originFolder.isEmpty())
 			return true;
 
-		m_progress.Increment(1, file.toStdString());
+		m_progress.Increment(1, file);
 
 		decltype(UniqueFile::images) imageItems;
 		std::ranges::transform(std::move(images) | std::views::as_rvalue, std::inserter(imageItems, imageItems.end()), [](auto&& item) {
@@ -227,13 +237,44 @@ private:
 	const QFileInfo             m_fileInfo;
 	UniqueFileStorage&          m_uniqueFileStorage;
 	InpDataProvider&            m_inpDataProvider;
-	Util::Progress&             m_progress;
+	Progress&                   m_progress;
 	std::unordered_set<QString> m_bookFiles;
 };
 
+QString GetImageArchive(const QFileInfo& fileInfo, const char* imageFolder)
+{
+	auto imageDir = fileInfo.dir();
+	if (!imageDir.cd(imageFolder))
+		return {};
+
+	auto imageArchive = imageDir.absoluteFilePath(fileInfo.completeBaseName()) + ".zip";
+	return QFile::exists(imageArchive) ? imageArchive : QString {};
+}
+
+void CopyImageArchive(const QString& src, const QString& dst)
+{
+	if (!BlobStore::HasReferences(src))
+	{
+		QFile::remove(dst);
+		if (!QFile::copy(src, dst))
+			throw std::invalid_argument(std::format("Cannot copy {} to {}", src, dst));
+		return;
+	}
+
+	// blob references resolve against the store next to the archive, which the output folder does not have
+	PLOGI << src << " refers to the blob store, expanding";
+	const ImageArchive archive(src);
+	ZipStreamWriter    writer(dst);
+	writer.SetComment(ReadZipTail(src).comment);
+	for (const auto& imageFile : archive.GetFileNameList())
+		writer.Add(imageFile, archive.Read(imageFile), archive.GetFileTime(imageFile));
+	writer.Close();
+}
+
 void ProcessArchive(const QDir& outputDir, const Archive& archive, const Replacement& replacement)
 {
 	const QFileInfo fileInfo(archive.filePath);
+	const TraceSpan span("MergeArchive", fileInfo.fileName());
 
 	const auto dstFilePath = outputDir.filePath(fileInfo.fileName());
 	QFile::remove(dstFilePath);
@@ -242,22 +283,15 @@ void ProcessArchive(const QDir& outputDir, const Archive& archive, const Replace
 
 	for (const char* imageFolder : { Global::COVERS, Global::IMAGES })
 	{
-		auto imageDir = fileInfo.dir();
-		if (!imageDir.cd(imageFolder))
-			continue;
-
-		const auto imageArchiveFileSrc = imageDir.absoluteFilePath(fileInfo.completeBaseName()) + ".zip";
-		if (!QFile::exists(imageArchiveFileSrc))
+		const auto imageArchiveFileSrc = GetImageArchive(fileInfo, imageFolder);
+		if (imageArchiveFileSrc.isEmpty())
 			continue;
 
 		QDir dstDir(outputDir.filePath(imageFolder));
 		if (!dstDir.exists())
 			dstDir.mkpath(".");
 
-		const auto imageArchiveFileDst = dstDir.filePath(fileInfo.completeBaseName() + ".zip");
-		QFile::remove(imageArchiveFileDst);
-		if (!QFile::copy(imageArchiveFileSrc, imageArchiveFileDst))
-			throw std::invalid_argument(std::format("Cannot copy {} to {}", imageArchiveFileSrc, imageArchiveFileDst));
+		CopyImageArchive(imageArchiveFileSrc, dstDir.filePath(fileInfo.completeBaseName() + ".zip"));
 	}
 
 	auto toRemove = Zip(dstFilePath).GetFileNameList() | std::views::filter([&](const QString& fileName) {
@@ -287,7 +321,8 @@ void ProcessHash(const QDir& hashDir, const Archive& archive, const Replacement&
 {
 	PLOGI << "parsing " << archive.hashPath;
 	hashDir.mkpath(".");
-	QFileInfo fileInfo(archive.hashPath);
+	QFileInfo       fileInfo(archive.hashPath);
+	const TraceSpan span("MergeHash", fileInfo.fileName());
 
 	QFile input(archive.hashPath);
 	if (!input.open(QIODevice::ReadOnly))
@@ -302,21 +337,40 @@ void ProcessHash(const QDir& hashDir, const Archive& archive, const Replacement&
 	[[maybe_unused]] const HashCopier parser(input, output, replacement);
 }
 
-void MergeArchives(const QDir& outputDir, const QDir& hashDir, const Archives& archives, const Replacement& replacement)
+void MergeArchives(const QDir& outputDir, const QDir& hashDir, const Archives& archives, const Replacement& replacement, const PrefetchSettings& prefetchSettings)
 {
+	// the image archives are read together with their book archive, so they share its read ahead slot
+	std::vector<QStringList> groups;
+	for (const auto& archive : archives)
+	{
+		const QFileInfo fileInfo(archive.filePath);
+		auto&           files = groups.emplace_back(QStringList { archive.filePath });
+		for (const char* imageFolder : { Global::COVERS, Global::IMAGES })
+			if (auto imageArchive = GetImageArchive(fileInfo, imageFolder); !imageArchive.isEmpty())
+				files << std::move(imageArchive);
+	}
+
+	Prefetcher prefetcher(groups, prefetchSettings);
+
 	for (const auto& archive : archives)
 	{
+		prefetcher.Advance(archive.filePath);
 		ProcessArchive(outputDir, archive, replacement);
 		ProcessHash(hashDir, archive, replacement);
 	}
 }
 
-void GetReplacement(const size_t totalFileCount, const Archives& archives, UniqueFileStorage& uniqueFileStorage, InpDataProvider& inpDataProvider)
+void GetReplacement(const size_t totalFileCount, const Archives& archives, UniqueFileStorage& uniqueFileStorage, InpDataProvider& inpDataProvider, const PrefetchSettings& prefetchSettings)
 {
-	Util::Progress progress(totalFileCount, "parsing");
+	const TraceSpan span("GetReplacement");
+	Progress        progress(totalFileCount, "parsing");
+	Prefetcher      prefetcher(archives | std::views::transform(&Archive::hashPath) | std::ranges::to<QStringList>(), prefetchSettings);
 
 	for (const auto& archive : archives)
+	{
+		prefetcher.Advance(archive.hashPath);
 		ReplacementGetter(archive, uniqueFileStorage, inpDataProvider, progress);
+	}
 }
 
 Settings ProcessCommandLine(const QCoreApplication& app)
@@ -337,18 +391,26 @@ Settings ProcessCommandLine(const QCoreApplication& app)
     }
 	);
 
-	const auto defaultLogPath = QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID);
-	const auto logOption      = Log::LoggingInitializer::AddLogFileOption(parser, defaultLogPath);
+	const auto defaultLogPath  = QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID);
+	const auto logOption       = Log::LoggingInitializer::AddLogFileOption(parser, defaultLogPath);
+	const auto traceOption     = TraceInitializer::AddTraceFileOption(parser);
+	const auto metricsOption   = MetricsPublisher::AddMetricsFileOption(parser);
+	const auto resourcesOption = ResourceReporter::AddResourceReportOption(parser);
+	Prefetcher::AddPrefetchOptions(parser);
 	parser.process(app);
 
 	if (parser.positionalArguments().isEmpty() || !parser.isSet(FOLDER))
 		parser.showHelp();
 
-	settings.logFileName   = parser.isSet(logOption) ? parser.value(logOption) : defaultLogPath;
-	settings.arguments     = parser.positionalArguments();
-	settings.outputDir     = QDir { parser.value(FOLDER) };
-	settings.hashDir       = QDir { parser.isSet(HASH) ? parser.value(HASH) : settings.outputDir.absoluteFilePath(HASH) };
-	settings.dumpWildCards = parser.value(DUMP);
+	settings.logFileName       = parser.isSet(logOption) ? parser.value(logOption) : defaultLogPath;
+	settings.traceFileName     = parser.value(traceOption);
+	settings.metricsFileName   = parser.value(metricsOption);
+	settings.resourcesFileName = parser.value(resourcesOption);
+	settings.arguments         = parser.positionalArguments();
+	settings.outputDir         = QDir { parser.value(FOLDER) };
+	settings.hashDir           = QDir { parser.isSet(HASH) ? parser.value(HASH) : settings.outputDir.absoluteFilePath(HASH) };
+	settings.dumpWildCards     = parser.value(DUMP);
+	settings.prefetch          = Prefetcher::GetPrefetchSettings(parser);
 	if (parser.isSet(HAMMING_THRESHOLD))
 		settings.hammingThreshold = parser.value(HAMMING_THRESHOLD).toInt();
 
@@ -369,11 +431,11 @@ void run(const Settings& settings)
 
 	Replacement replacement;
 	uniqueFileStorage.SetDuplicateObserver(std::make_unique<DuplicateObserver>(replacement));
-	GetReplacement(totalFileCount, archives, uniqueFileStorage, *inpDataProvider);
+	GetReplacement(totalFileCount, archives, uniqueFileStorage, *inpDataProvider, settings.prefetch);
 
 	PLOGI << "Duplicates found: " << replacement.size();
 
-	MergeArchives(settings.outputDir, settings.hashDir, archives, replacement);
+	MergeArchives(settings.outputDir, settings.hashDir, archives, replacement, settings.prefetch);
 }
 
 } // namespace
@@ -387,9 +449,10 @@ int main(int argc, char* argv[])
 
 	const auto settings = ProcessCommandLine(app);
 
-	Log::LoggingInitializer                          logging(settings.logFileName);
-	plog::ConsoleAppender<Util::LogConsoleFormatter> consoleAppender;
-	Log::LogAppender                                 logConsoleAppender(&consoleAppender);
+	FliLib::AsyncLoggingInitializer<Util::LogConsoleFormatter> logging(settings.logFileName);
+	TraceInitializer                                           trace(settings.traceFileName);
+	MetricsPublisher                                           metrics(settings.metricsFileName);
+	ResourceReporter                                           resources(settings.resourcesFileName);
 	PLOGI << QString("%1 started").arg(APP_ID);
 
 	try
@@ -0,0 +1,12 @@
+AddTarget(flipacker	app_console
+	PROJECT_GROUP Tool
+	SOURCE_DIRECTORY
+		"${CMAKE_CURRENT_LIST_DIR}"
+	LINK_LIBRARIES
+		Qt${QT_MAJOR_VERSION}::Core
+	LINK_TARGETS
+		lib
+		logging
+		util
+		zip
+)
@@ -0,0 +1,278 @@
+﻿#include <map>
+#include <optional>
+#include <ranges>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QStandardPaths>
+
+#include "lib/AsyncAppender.h"
+#include "lib/BlobStore.h"
+#include "lib/Resources.h"
+#include "lib/Trace.h"
+#include "lib/ZipStreamWriter.h"
+#include "lib/ZipTail.h"
+#include "logging/init.h"
+#include "util/LogConsoleFormatter.h"
+#include "util/files.h"
+
+#include "log.h"
+#include "zip.h"
+
+#include "config/version.h"
+
+using namespace HomeCompa;
+using namespace FliLib;
+
+namespace
+{
+
+constexpr auto APP_ID = "flipacker";
+
+constexpr auto IMAGE_ARCHIVE_WILDCARD_OPTION_NAME = "archives";
+constexpr auto PACK_SIZE                          = "pack-size";
+constexpr auto EXPAND                             = "expand";
+
+constexpr size_t MEGABYTE = 1024 * 1024;
+
+struct Settings
+{
+	QStringList archives;
+	size_t      packSize { 1024 };
+	bool        expand { false };
+	QString     logFileName { QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID) };
+	QString     traceFileName;
+	QString     resourcesFileName;
+};
+
+struct Reference
+{
+	QString   fileName;
+	QString   hash;
+	QDateTime time;
+};
+
+struct CompactedArchive
+{
+	QString                fileName;
+	QByteArray             comment;
+	std::vector<Reference> references;
+};
+
+struct Statistics
+{
+	size_t   images { 0 };
+	size_t   stored { 0 };
+	uint64_t imageSize { 0 };
+	uint64_t storedSize { 0 };
+};
+
+std::optional<CompactedArchive> Compact(const QString& fileName, BlobStore& blobStore, Statistics& statistics)
+{
+	const TraceSpan span("Compact", fileName);
+
+	CompactedArchive result { .fileName = fileName, .comment = ReadZipTail(fileName).comment };
+	bool             changed = false;
+
+	const Zip zip(fileName);
+	for (const auto& imageFile : zip.GetFileNameList())
+	{
+		auto       body = zip.Read(imageFile)->GetStream().readAll();
+		auto       hash = BlobStore::ParseReference(body);
+		const auto time = zip.GetFileTime(imageFile);
+		if (hash.isEmpty())
+		{
+			changed         = true;
+			hash            = BlobStore::GetHash(body);
+			const auto size = static_cast<uint64_t>(body.size());
+
+			++statistics.images;
+			statistics.imageSize += size;
+			if (blobStore.Add(hash, std::move(body), time))
+			{
+				++statistics.stored;
+				statistics.storedSize += size;
+			}
+		}
+		else if (!blobStore.Contains(hash))
+		{
+			throw std::invalid_argument(QString("%1/%2 refers to missing blob %3").arg(fileName, imageFile, hash).toStdString());
+		}
+
+		result.references.emplace_back(imageFile, std::move(hash), time);
+	}
+
+	if (!changed)
+		return std::nullopt;
+
+	return result;
+}
+
+void WriteReferences(const CompactedArchive& archive)
+{
+	ZipStreamWriter writer(archive.fileName);
+	writer.SetComment(archive.comment);
+	for (const auto& [fileName, hash, time] : archive.references)
+		writer.Add(fileName, BlobStore::CreateReference(hash), time);
+	writer.Close();
+}
+
+void Commit(BlobStore& blobStore, std::vector<CompactedArchive>& archives)
+{
+	blobStore.Flush();
+	for (const auto& archive : archives)
+	{
+		WriteReferences(archive);
+		PLOGI << archive.fileName << ": " << archive.references.size() << " images compacted";
+	}
+	archives.clear();
+}
+
+// readers open the store next to the folder of the image archive, so archives of different collections go to different stores
+std::map<QString, QStringList> GroupByStore(const QStringList& archives)
+{
+	std::map<QString, QStringList> result;
+	for (const auto& fileName : archives)
+		result[BlobStore::GetFolder(fileName)] << fileName;
+	return result;
+}
+
+void CompactArchives(const Settings& settings)
+{
+	Statistics statistics;
+	for (const auto& [storeFolder, archives] : GroupByStore(settings.archives))
+	{
+		BlobStore                     blobStore(storeFolder);
+		std::vector<CompactedArchive> pending;
+
+		for (const auto& fileName : archives)
+		{
+			if (auto archive = Compact(fileName, blobStore, statistics))
+				pending.emplace_back(std::move(*archive));
+
+			if (blobStore.GetPendingSize() >= settings.packSize * MEGABYTE)
+				Commit(blobStore, pending);
+		}
+
+		Commit(blobStore, pending);
+	}
+
+	PLOGI << "images: " << statistics.images << ", stored: " << statistics.stored << ", size: " << statistics.imageSize / MEGABYTE << " MB, stored: " << statistics.storedSize / MEGABYTE << " MB";
+}
+
+size_t Expand(const QString& fileName, const BlobStore& blobStore)
+{
+	const TraceSpan span("Expand", fileName);
+
+	ZipStreamWriter writer(fileName);
+	writer.SetComment(ReadZipTail(fileName).comment);
+
+	size_t expanded = 0;
+	{
+		const Zip zip(fileName);
+		for (const auto& imageFile : zip.GetFileNameList())
+		{
+			auto body = zip.Read(imageFile)->GetStream().readAll();
+			if (const auto hash = BlobStore::ParseReference(body); !hash.isEmpty())
+			{
+				body = blobStore.Read(hash);
+				++expanded;
+			}
+			writer.Add(imageFile, std::move(body), zip.GetFileTime(imageFile));
+		}
+	}
+
+	if (expanded != 0)
+		writer.Close();
+
+	return expanded;
+}
+
+void ExpandArchives(const Settings& settings)
+{
+	for (const auto& [storeFolder, archives] : GroupByStore(settings.archives))
+	{
+		const BlobStore blobStore(storeFolder);
+		for (const auto& fileName : archives)
+			if (const auto expanded = Expand(fileName, blobStore); expanded != 0)
+				PLOGI << fileName << ": " << expanded << " images expanded";
+	}
+}
+
+Settings ProcessCommandLine(const QCoreApplication& app)
+{
+	Settings settings;
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QString("%1 moves images of the collection to the shared blob store").arg(APP_ID));
+	parser.addHelpOption();
+	parser.addVersionOption();
+	parser.addPositionalArgument(IMAGE_ARCHIVE_WILDCARD_OPTION_NAME, "Input image archive files (required)");
+	parser.addOptions(
+		{
+			{ PACK_SIZE, "Maximum size of a new blob pack", QString("MB [%1]").arg(settings.packSize) },
+			{ EXPAND, "Replace blob references with image bodies" },
+    }
+	);
+	const auto logOption       = Log::LoggingInitializer::AddLogFileOption(parser, settings.logFileName);
+	const auto traceOption     = TraceInitializer::AddTraceFileOption(parser);
+	const auto resourcesOption = ResourceReporter::AddResourceReportOption(parser);
+	parser.process(app);
+
+	for (const auto& wildCard : parser.positionalArguments())
+		std::ranges::move(Util::ResolveWildcard(wildCard), std::back_inserter(settings.archives));
+	settings.archives.removeDuplicates();
+
+	if (settings.archives.isEmpty())
+		parser.showHelp(1);
+
+	settings.expand = parser.isSet(EXPAND);
+
+	bool ok = false;
+	if (const auto value = parser.value(PACK_SIZE).toULongLong(&ok); ok && value > 0)
+		settings.packSize = static_cast<size_t>(value);
+
+	if (parser.isSet(logOption))
+		settings.logFileName = parser.value(logOption);
+
+	settings.traceFileName     = parser.value(traceOption);
+	settings.resourcesFileName = parser.value(resourcesOption);
+
+	return settings;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	const QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName(APP_ID);
+	QCoreApplication::setApplicationVersion(PRODUCT_VERSION);
+
+	const auto                                      settings = ProcessCommandLine(app);
+	AsyncLoggingInitializer<Util::LogConsoleFormatter> logging(settings.logFileName);
+	TraceInitializer                                   trace(settings.traceFileName);
+	ResourceReporter                                   resources(settings.resourcesFileName);
+	PLOGI << QString("%1 started").arg(APP_ID);
+
+	try
+	{
+		if (settings.expand)
+			ExpandArchives(settings);
+		else
+			CompactArchives(settings);
+
+		PLOGI << QString("%1 finished").arg(APP_ID);
+		return 0;
+	}
+	catch (const std::exception& ex)
+	{
+		PLOGE << QString("%1 failed: %2").arg(APP_ID).arg(ex.what());
+	}
+	catch (...)
+	{
+		PLOGE << QString("%1 failed").arg(APP_ID);
+	}
+
+	return 1;
+}
@@ -13,19 +13,21 @@
 #include <QJsonObject>
 #include <QStandardPaths>
 
-#include <plog/Appenders/ConsoleAppender.h>
-
 #include "fnd/ScopedCall.h"
 #include "fnd/StrUtil.h"
 #include "fnd/try.h"
 
+#include "lib/AsyncAppender.h"
+#include "lib/Metrics.h"
+#include "lib/Progress.h"
+#include "lib/Resources.h"
+#include "lib/Trace.h"
 #include "lib/UniqueFile.h"
 #include "lib/archive.h"
 #include "lib/book.h"
 #include "lib/dump/Factory.h"
 #include "lib/dump/IDump.h"
 #include "lib/util.h"
-#include "logging/LogAppender.h"
 #include "logging/init.h"
 #include "util/EpubParser.h"
 #include "util/Fb2InpxParser.h"
@@ -35,7 +37,6 @@
 #include "util/bookhash/hashparser.h"
 #include "util/executor/ThreadPool.h"
 #include "util/language.h"
-#include "util/progress.h"
 #include "util/xml/Initializer.h"
 #include "util/xml/SaxParser.h"
 #include "util/xml/XmlWriter.h"
@@ -687,6 +688,9 @@ Book* ParseBook(const QString& fileName, InpDataProvider& inpDataProvider, const
 	if (auto book = inpDataProvider.GetBook(hash))
 		return book;
 
+	if (auto book = inpDataProvider.RestoreBook(hash))
+		return book;
+
 	PLOGV << "parse " << fileName << ", hash: " << hash;
 
 	const auto parser = [&] {
@@ -710,6 +714,8 @@ Book* ParseBook(const QString& fileName, InpDataProvider& inpDataProvider, const
 
 void CreateInpx(const Settings& settings, const Archives& archives, InpDataProvider& inpDataProvider)
 {
+	const TraceSpan span("CreateInpx");
+
 	const auto unIndexed = []() -> QJsonObject {
 		QFile                       file(":/data/unindexed.json");
 		[[maybe_unused]] const auto ok = file.open(QIODevice::ReadOnly);
@@ -738,10 +744,11 @@ void CreateInpx(const Settings& settings, const Archives& archives, InpDataProvi
 													return std::make_pair(QFileInfo(item.filePath), item.sourceLib);
 												}))
 	{
-		QByteArray file;
-		Zip        zip(zipFileInfo.filePath());
-		const auto bookFiles = zip.GetFileNameList();
-		const auto folder    = zipFileInfo.fileName();
+		const TraceSpan archiveSpan("CreateInpxArchive", zipFileInfo.fileName());
+		QByteArray      file;
+		Zip             zip(zipFileInfo.filePath());
+		const auto      bookFiles = zip.GetFileNameList();
+		const auto      folder    = zipFileInfo.fileName();
 
 		PLOGV << folder << ", files count: " << bookFiles.size();
 		size_t counter = 0;
@@ -871,10 +878,10 @@ void CreateInpx(const Settings& settings, const Archives& archives, InpDataProvi
 	}
 }
 
-QByteArray CreateReviewAdditional(const InpDataProvider& inpDataProvider)
+QByteArray CreateReviewAdditional(const InpDataSnapshot& inpData)
 {
 	QJsonArray jsonArray;
-	for (const auto& book : inpDataProvider.Books() | std::views::filter([&](const Book* item) {
+	for (const auto& book : inpData.Books() | std::views::filter([&](const Book* item) {
 								return item->rate > std::numeric_limits<double>::epsilon();
 							}))
 	{
@@ -896,6 +903,8 @@ QByteArray CreateReviewAdditional(const InpDataProvider& inpDataProvider)
 
 std::vector<std::tuple<QString, QByteArray>> CreateReviewData(const std::filesystem::path& outputFolder, const InpDataProvider& inpDataProvider, const Replacement& replacement)
 {
+	const auto inpData = inpDataProvider.Freeze();
+
 	Util::ThreadPool threadPool;
 
 	const auto reviewsFolder = outputFolder / Inpx::REVIEWS_FOLDER;
@@ -915,7 +924,7 @@ std::vector<std::tuple<QString, QByteArray>> CreateReviewData(const std::filesys
 			}
 		);
 
-		auto additional = CreateReviewAdditional(inpDataProvider);
+		auto additional = CreateReviewAdditional(*inpData);
 		if (additional.isEmpty())
 			return;
 
@@ -1008,26 +1017,26 @@ std::vector<std::tuple<QString, QByteArray>> CreateReviewData(const std::filesys
 		return false;
 	});
 
-	const auto inpxedBooks = inpDataProvider.Books() | std::ranges::to<std::unordered_set<const Book*>>();
+	const auto inpxedBooks = inpData->Books() | std::ranges::to<std::unordered_set<const Book*>>();
 
-	Util::Progress progress(months.size(), "select reviews");
+	FliLib::Progress progress(months.size(), "select reviews");
 	for (const auto& [year, month] : months)
 	{
 		Data data;
 
 		inpDataProvider.Enumerate([&](const QString& sourceLib, const IDump& dump) {
 			dump.Review(year, month, [&](const QString& libId, QString name, QString time, QString text) {
-				auto* book = inpDataProvider.GetBook(sourceLib, libId);
+				auto* book = inpData->GetBook(sourceLib, libId);
 				while (book)
 				{
 					if (const auto rIt = replacement.find({ book->folder, book->GetFileName() }); rIt != replacement.end())
 					{
-						if (const auto& [replacementFolder, replacementFile] = rIt->second; !((book = inpDataProvider.GetBook({ replacementFolder, replacementFile }))))
+						if (const auto& [replacementFolder, replacementFile] = rIt->second; !((book = inpData->GetBook({ replacementFolder, replacementFile }))))
 						{
 							auto replacementLibId = replacementFile;
 							if (const auto pos = replacementLibId.lastIndexOf('.'); pos > 0)
 								replacementLibId = replacementLibId.first(pos);
-							book = inpDataProvider.GetBook(sourceLib, replacementLibId);
+							book = inpData->GetBook(sourceLib, replacementLibId);
 						}
 						continue;
 					}
@@ -1045,7 +1054,9 @@ std::vector<std::tuple<QString, QByteArray>> CreateReviewData(const std::filesys
 		if (!data.empty())
 			write(year, month, std::move(data));
 
-		progress.Increment(1, std::format("{:04}-{:02}", year, month));
+		progress.Increment(1, [&] {
+			return QString::fromStdString(std::format("{:04}-{:02}", year, month));
+		});
 	}
 
 	threadPool.wait();
@@ -1056,6 +1067,7 @@ std::vector<std::tuple<QString, QByteArray>> CreateReviewData(const std::filesys
 void CreateBookList(const std::filesystem::path& outputFolder, const InpDataProvider& inpDataProvider)
 {
 	PLOGI << "write contents";
+	const TraceSpan span("CreateBookList");
 
 	const auto getSortedString = [](const QString& src) {
 		return src.isEmpty() ? QString(QChar { 0xffff }) : src.toLower().simplified();
@@ -1114,6 +1126,7 @@ void CreateBookList(const std::filesystem::path& outputFolder, const InpDataProv
 void ProcessCompilations(const std::filesystem::path& outputFolder, const Archives& archives, const InpDataProvider& inpDataProvider, IAnnotationCollector& annotationCollector)
 {
 	PLOGI << "collect compilation info";
+	const TraceSpan span("ProcessCompilations");
 
 	const auto sectionToBook = inpDataProvider.Books() | std::views::transform([](Book* book) {
 								   return std::make_pair(book->id, book);
@@ -1126,7 +1139,7 @@ void ProcessCompilations(const std::filesystem::path& outputFolder, const Archiv
 	storage.reserve(archives.size());
 
 	{
-		Util::Progress   progress(archives.size(), "parsing");
+		FliLib::Progress progress(archives.size(), "parsing");
 		Util::ThreadPool threadPool({ .maxQueueSize = std::thread::hardware_concurrency() });
 
 		for (const auto& archive : archives | std::views::filter([](const auto& item) {
@@ -1144,7 +1157,9 @@ void ProcessCompilations(const std::filesystem::path& outputFolder, const Archiv
 
 			threadPool.enqueue([&](auto) {
 				[[maybe_unused]] const CompilationHandler compilationHandler(inpDataProvider, sectionToBook, storageItem);
-				progress.Increment(1, QFileInfo(archive.hashPath).fileName().toStdString());
+				progress.Increment(1, [&] {
+					return QFileInfo(archive.hashPath).fileName();
+				});
 			});
 		}
 
@@ -1155,7 +1170,7 @@ void ProcessCompilations(const std::filesystem::path& outputFolder, const Archiv
 
 	size_t totalData = 0, totalCompilations = 0;
 	{
-		Util::Progress progress(storage.size(), "store parsed data");
+		FliLib::Progress progress(storage.size(), "store parsed data");
 		for (auto& storageItem : storage)
 		{
 			annotationCollector.StartFolder();
@@ -1165,7 +1180,9 @@ void ProcessCompilations(const std::filesystem::path& outputFolder, const Archiv
 			for (auto&& obj : storageItem.compilations)
 				jsonArray.append(std::move(obj));
 
-			progress.Increment(1, QString("%1 (%2, %3)").arg(QFileInfo(storageItem.archive.get().hashPath).fileName()).arg(storageItem.data.size()).arg(storageItem.compilations.size()).toStdString());
+			progress.Increment(1, [&] {
+				return QString("%1 (%2, %3)").arg(QFileInfo(storageItem.archive.get().hashPath).fileName()).arg(storageItem.data.size()).arg(storageItem.compilations.size());
+			});
 			totalData         += storageItem.data.size();
 			totalCompilations += storageItem.compilations.size();
 		}
@@ -1196,6 +1213,7 @@ void ProcessCompilations(const std::filesystem::path& outputFolder, const Archiv
 void CreateReview(const std::filesystem::path& outputFolder, const InpDataProvider& inpDataProvider, const Replacement& replacement)
 {
 	PLOGI << "write reviews";
+	const TraceSpan span("CreateReview");
 
 	for (const auto& [fileName, data] : CreateReviewData(outputFolder, inpDataProvider, replacement))
 		Write(fileName, data);
@@ -1203,12 +1221,13 @@ void CreateReview(const std::filesystem::path& outputFolder, const InpDataProvid
 
 Replacement ReadHash(InpDataProvider& inpDataProvider, Archives& archives)
 {
+	const TraceSpan                           span("ReadHash");
 	Replacement                               replacement;
 	std::vector<FileHashParser::ParseStorage> storage;
 	storage.reserve(archives.size());
 
 	{
-		Util::Progress   progress(archives.size(), "parsing");
+		FliLib::Progress progress(archives.size(), "parsing");
 		Util::ThreadPool threadPool({ .maxQueueSize = std::thread::hardware_concurrency() });
 
 		for (auto& archive : archives | std::views::filter([](const auto& item) {
@@ -1225,23 +1244,43 @@ Replacement ReadHash(InpDataProvider& inpDataProvider, Archives& archives)
 			}
 
 			threadPool.enqueue([&](auto) {
+				const TraceSpan                       parseSpan("ParseHash", QFileInfo(archive.hashPath).fileName());
 				[[maybe_unused]] const FileHashParser parser(storageItem);
-				progress.Increment(1, QFileInfo(archive.hashPath).fileName().toStdString());
+				progress.Increment(1, [&] {
+					return QFileInfo(archive.hashPath).fileName();
+				});
 			});
 		}
 
 		threadPool.wait();
 	}
 	{
-		Util::Progress progress(storage.size(), "store parsed data");
+		FliLib::Progress progress(storage.size(), "store parsed data");
+
+		// one library at a time: archive numbers of different libraries overlap, so the name order interleaves them
+		const auto libKey = [](const FileHashParser::ParseStorage& item) {
+			return item.archive.get().sourceLib.toLower();
+		};
+		std::ranges::stable_sort(storage, {}, libKey);
+		const auto release = !storage.empty() && libKey(storage.front()) != libKey(storage.back());
 
-		for (auto&& storageItem : storage)
+		PLOGI << "peak rss before binding: " << ResourceReporter::PeakRss() / 1024 / 1024 << " MB";
+		for (size_t n = 0; auto&& storageItem : storage)
 		{
+			const auto& sourceLib = storageItem.archive.get().sourceLib;
 			std::ranges::move(storageItem.replacement, std::inserter(replacement, replacement.end()));
-			inpDataProvider.SetSourceLib(storageItem.archive.get().sourceLib);
+			inpDataProvider.SetSourceLib(sourceLib);
 			for (auto&& [uid, storageDataItem] : storageItem.data)
 				inpDataProvider.SetFile(uid, std::move(storageDataItem.uid), storageDataItem.size);
-			progress.Increment(1, QString("%1 (%2)").arg(QFileInfo(storageItem.archive.get().hashPath).fileName()).arg(storageItem.data.size()).toStdString());
+			if (++n == storage.size() || libKey(storage[n]) != libKey(storageItem))
+			{
+				PLOGI << sourceLib << " bound, peak rss: " << ResourceReporter::PeakRss() / 1024 / 1024 << " MB";
+				if (release)
+					inpDataProvider.Release(sourceLib);
+			}
+			progress.Increment(1, [&] {
+				return QString("%1 (%2)").arg(QFileInfo(storageItem.archive.get().hashPath).fileName()).arg(storageItem.data.size());
+			});
 		}
 	}
 
@@ -1250,6 +1289,8 @@ Replacement ReadHash(InpDataProvider& inpDataProvider, Archives& archives)
 
 void MergeBookData(const InpDataProvider& inpDataProvider, const Replacement& replacement)
 {
+	const TraceSpan span("MergeBookData");
+
 	struct BookIndexItem
 	{
 		BookItem                    uid;
@@ -1325,14 +1366,18 @@ int main(int argc, char* argv[])
 			{ COLLECTION_INFO_DATE_FORMAT, "Date format for collection.info", QString("[%1]").arg(settings.collectionInfoDateFormat) },
     }
 	);
-	const auto defaultLogPath = QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID);
-	const auto logOption      = Log::LoggingInitializer::AddLogFileOption(parser, defaultLogPath);
+	const auto defaultLogPath  = QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID);
+	const auto logOption       = Log::LoggingInitializer::AddLogFileOption(parser, defaultLogPath);
+	const auto traceOption     = TraceInitializer::AddTraceFileOption(parser);
+	const auto metricsOption   = MetricsPublisher::AddMetricsFileOption(parser);
+	const auto resourcesOption = ResourceReporter::AddResourceReportOption(parser);
 	parser.process(app);
 
-	Log::LoggingInitializer                          logging(parser.isSet(logOption) ? parser.value(logOption) : defaultLogPath);
-	plog::ConsoleAppender<Util::LogConsoleFormatter> consoleAppender;
-	Log::LogAppender                                 logConsoleAppender(&consoleAppender);
-	Util::GenreFixerInitializer                      genreFixerInitializer;
+	FliLib::AsyncLoggingInitializer<Util::LogConsoleFormatter> logging(parser.isSet(logOption) ? parser.value(logOption) : defaultLogPath);
+	TraceInitializer                                           trace(parser.value(traceOption));
+	MetricsPublisher                                           metrics(parser.value(metricsOption));
+	ResourceReporter                                           resources(parser.value(resourcesOption));
+	Util::GenreFixerInitializer                                genreFixerInitializer;
 	try
 	{
 		PLOGI << QString("%1 started").arg(APP_ID);
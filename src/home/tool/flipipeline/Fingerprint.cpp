@@ -0,0 +1,116 @@
+#include "Fingerprint.h"
+
+#include <algorithm>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+#include "util/files.h"
+
+#include "log.h"
+
+using namespace HomeCompa;
+using namespace flipipeline;
+
+namespace
+{
+
+bool IsWildcard(const QString& path)
+{
+	return path.contains('*') || path.contains('?');
+}
+
+void AddFile(QCryptographicHash& hash, const QString& path)
+{
+	const QFileInfo fileInfo(path);
+	hash.addData(fileInfo.absoluteFilePath().toUtf8());
+	hash.addData(QByteArray::number(fileInfo.exists() ? fileInfo.size() : -1));
+	hash.addData(QByteArray::number(fileInfo.exists() ? fileInfo.lastModified().toMSecsSinceEpoch() : -1));
+}
+
+} // namespace
+
+namespace HomeCompa::flipipeline
+{
+
+QString CalculateFingerprint(const QString& program, const QStringList& arguments, const QStringList& inputs)
+{
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	AddFile(hash, program);
+	for (const auto& argument : arguments)
+	{
+		hash.addData(argument.toUtf8());
+		hash.addData(QByteArray(1, '\0'));
+	}
+
+	QStringList files;
+	for (const auto& input : inputs)
+	{
+		if (IsWildcard(input))
+			files << Util::ResolveWildcard(input);
+		else
+			files << input;
+	}
+
+	files.sort();
+	files.removeDuplicates();
+	for (const auto& file : files)
+		AddFile(hash, file);
+
+	return QString::fromLatin1(hash.result().toHex());
+}
+
+bool OutputsExist(const QStringList& outputs)
+{
+	return !outputs.isEmpty() && std::ranges::all_of(outputs, [](const QString& output) {
+		return IsWildcard(output) ? !Util::ResolveWildcard(output).isEmpty() : QFileInfo::exists(output);
+	});
+}
+
+} // namespace HomeCompa::flipipeline
+
+FingerprintStore::FingerprintStore(QString path)
+	: m_path { std::move(path) }
+{
+	QFile file(m_path);
+	if (m_path.isEmpty() || !file.exists())
+		return;
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		PLOGW << "cannot read " << m_path;
+		return;
+	}
+
+	QJsonParseError jsonParseError;
+	const auto      doc = QJsonDocument::fromJson(file.readAll(), &jsonParseError);
+	if (jsonParseError.error != QJsonParseError::NoError)
+	{
+		PLOGW << m_path << ": " << jsonParseError.errorString();
+		return;
+	}
+
+	m_state = doc.object();
+}
+
+FingerprintStore::~FingerprintStore() = default;
+
+QString FingerprintStore::Get(const QString& key) const
+{
+	return m_state.value(key).toString();
+}
+
+void FingerprintStore::Set(const QString& key, const QString& fingerprint)
+{
+	m_state.insert(key, fingerprint);
+	if (m_path.isEmpty())
+		return;
+
+	QSaveFile file(m_path);
+	if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(m_state).toJson()) < 0 || !file.commit())
+		PLOGW << "cannot write " << m_path;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+
+#include "fnd/NonCopyMovable.h"
+
+namespace HomeCompa::flipipeline
+{
+
+QString CalculateFingerprint(const QString& program, const QStringList& arguments, const QStringList& inputs);
+bool    OutputsExist(const QStringList& outputs);
+
+class FingerprintStore
+{
+	NON_COPY_MOVABLE(FingerprintStore)
+
+public:
+	explicit FingerprintStore(QString path);
+	~FingerprintStore();
+
+	QString Get(const QString& key) const;
+	void    Set(const QString& key, const QString& fingerprint);
+
+private:
+	const QString m_path;
+	QJsonObject   m_state;
+};
+
+} // namespace HomeCompa::flipipeline
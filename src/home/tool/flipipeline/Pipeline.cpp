@@ -0,0 +1,617 @@
+#include "Pipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ranges>
+#include <set>
+#include <tuple>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QStandardPaths>
+
+#include "util/files.h"
+
+#include "Fingerprint.h"
+#include "log.h"
+
+using namespace HomeCompa;
+using namespace flipipeline;
+
+namespace
+{
+
+constexpr auto ARCHIVE      = "%archive%";
+constexpr auto ARCHIVE_NAME = "%archive_name%";
+constexpr auto ARCHIVE_DIR  = "%archive_dir%";
+constexpr auto STAGE        = "%stage%";
+
+constexpr auto DEFAULT_JOBS = 2;
+
+enum class Scope
+{
+	Global,
+	Archive,
+};
+
+enum class State
+{
+	Pending,
+	Ready,
+	Running,
+	Done,
+	Failed,
+	Blocked,
+};
+
+struct Stage;
+
+struct Task
+{
+	Stage&                                stage;
+	ptrdiff_t                             archive { -1 };
+	QString                               key;
+	QStringList                           outputs;
+	std::vector<const Task*>              dependencies;
+	std::vector<Task*>                    dependents;
+	size_t                                waiting { 0 };
+	State                                 state { State::Pending };
+	bool                                  upToDate { false };
+	std::chrono::steady_clock::time_point start;
+};
+
+struct Stage
+{
+	size_t                             index { 0 };
+	QString                            name;
+	QString                            program;
+	QStringList                        arguments;
+	QStringList                        directories;
+	QStringList                        inputs;
+	QStringList                        outputs;
+	std::vector<Stage*>                depends;
+	Scope                              scope { Scope::Global };
+	int                                concurrency { 1 };
+	int                                running { 0 };
+	bool                               expanded { false };
+	std::vector<std::unique_ptr<Task>> tasks;
+
+	bool IsFinished() const noexcept
+	{
+		return expanded && std::ranges::all_of(tasks, [](const auto& task) {
+				   return task->state == State::Done || task->state == State::Failed || task->state == State::Blocked;
+			   });
+	}
+};
+
+struct TaskOrder
+{
+	bool operator()(const Task* lhs, const Task* rhs) const noexcept
+	{
+		return std::tie(lhs->archive, lhs->stage.index) < std::tie(rhs->archive, rhs->stage.index);
+	}
+};
+
+QStringList ToStringList(const QJsonValue& value)
+{
+	if (value.isString())
+		return { value.toString() };
+
+	return value.toArray() | std::views::transform([](const auto& item) {
+			   return item.toString();
+		   })
+	     | std::ranges::to<QStringList>();
+}
+
+bool IsArchiveArgument(const QString& argument)
+{
+	return argument.contains(ARCHIVE) || argument.contains(ARCHIVE_NAME) || argument.contains(ARCHIVE_DIR);
+}
+
+Scope ToScope(const QString& name, const QString& value)
+{
+	if (value.isEmpty() || value == "global")
+		return Scope::Global;
+	if (value == "archive")
+		return Scope::Archive;
+
+	throw std::invalid_argument(QString("%1: unknown scope %2").arg(name, value).toStdString());
+}
+
+} // namespace
+
+class Pipeline::Impl
+{
+	NON_COPY_MOVABLE(Impl)
+
+public:
+	Impl(const QJsonObject& config, Settings settings)
+		: m_variables { ReadVariables(config) }
+		, m_settings { ReadSettings(config, std::move(settings)) }
+		, m_fingerprints { m_settings.state }
+		, m_archiveWildcards { ToStringList(config["archives"]) }
+	{
+		for (const auto stageValue : config["stages"].toArray())
+			AddStage(stageValue.toObject());
+
+		if (m_stages.empty())
+			throw std::invalid_argument("no stages defined");
+
+		if (!m_settings.logs.isEmpty() && !QDir(m_settings.logs).mkpath("."))
+			throw std::ios_base::failure(QString("Cannot create %1").arg(m_settings.logs).toStdString());
+
+		PLOGI << m_stages.size() << " stage(s) loaded, jobs: " << m_settings.jobs;
+	}
+
+	size_t Run()
+	{
+		Expand();
+		Pump();
+		if (!IsIdle())
+			m_eventLoop.exec();
+
+		return Report();
+	}
+
+private:
+	std::vector<std::pair<QString, QString>> ReadVariables(const QJsonObject& config) const
+	{
+		std::vector<std::pair<QString, QString>> result;
+		const auto                               variables = config["variables"].toObject();
+		for (auto it = variables.begin(); it != variables.end(); ++it)
+			result.emplace_back(QString("%%1%").arg(it.key()), it.value().toString());
+
+		return result;
+	}
+
+	Settings ReadSettings(const QJsonObject& config, Settings settings) const
+	{
+		if (settings.state.isEmpty())
+			settings.state = Substitute(config["state"].toString());
+		if (settings.logs.isEmpty())
+			settings.logs = Substitute(config["logs"].toString());
+		if (settings.jobs <= 0)
+			settings.jobs = std::max(config["jobs"].toInt(DEFAULT_JOBS), 1);
+		if (settings.tools.isEmpty())
+			settings.tools = QCoreApplication::applicationDirPath();
+
+		return settings;
+	}
+
+	void AddStage(const QJsonObject& obj)
+	{
+		auto& stage = *m_stages.emplace_back(std::make_unique<Stage>());
+		stage.index = m_stages.size() - 1;
+		stage.name  = obj["name"].toString();
+		if (stage.name.isEmpty())
+			throw std::invalid_argument(QString("stage #%1 has no name").arg(stage.index).toStdString());
+		if (std::ranges::count(m_stages, stage.name, [](const auto& item) { return item->name; }) > 1)
+			throw std::invalid_argument(QString("%1: duplicate stage name").arg(stage.name).toStdString());
+
+		stage.program     = obj["program"].toString(stage.name);
+		stage.arguments   = ToStringList(obj["arguments"]);
+		stage.directories = ToStringList(obj["directories"]);
+		stage.inputs      = ToStringList(obj["inputs"]);
+		stage.outputs     = ToStringList(obj["outputs"]);
+		stage.scope       = ToScope(stage.name, obj["scope"].toString());
+		stage.concurrency = std::max(obj["concurrency"].toInt(1), 1);
+
+		// tasks of later stages are expanded only when their dependencies finish, so a bad variable must fail the run now
+		for (const auto& value : QStringList { stage.program } + stage.arguments + stage.directories + stage.inputs + stage.outputs)
+			CheckVariables(stage.name, value);
+
+		for (const auto& depend : ToStringList(obj["depends"]))
+		{
+			const auto end = std::next(m_stages.begin(), static_cast<ptrdiff_t>(stage.index));
+			const auto it  = std::find_if(m_stages.begin(), end, [&](const auto& item) {
+				return item->name == depend;
+			});
+			if (it == end)
+				throw std::invalid_argument(QString("%1: unknown dependency %2, a stage may depend only on stages declared above it").arg(stage.name, depend).toStdString());
+			stage.depends.push_back(it->get());
+		}
+	}
+
+	void CheckVariables(const QString& stageName, const QString& value) const
+	{
+		static const QRegularExpression rx(R"(%[a-z_][a-z0-9_]*%)", QRegularExpression::CaseInsensitiveOption);
+		for (auto matches = rx.globalMatch(value); matches.hasNext();)
+		{
+			const auto name = matches.next().captured();
+			if (name == ARCHIVE || name == ARCHIVE_NAME || name == ARCHIVE_DIR || name == STAGE)
+				continue;
+
+			const auto it = std::ranges::find(m_variables, name, &std::pair<QString, QString>::first);
+			if (it == m_variables.end())
+				throw std::invalid_argument(QString("%1: unknown variable %2").arg(stageName, name).toStdString());
+			if (it->second.isEmpty())
+				throw std::invalid_argument(QString("%1: variable %2 is empty, set it with -D %3=value").arg(stageName, name, name.mid(1, name.size() - 2)).toStdString());
+		}
+	}
+
+	const QStringList& GetArchives()
+	{
+		if (m_archivesResolved)
+			return m_archives;
+
+		m_archivesResolved = true;
+		for (const auto& wildcard : m_archiveWildcards)
+			m_archives << Util::ResolveWildcard(Substitute(wildcard));
+
+		m_archives.sort();
+		m_archives.removeDuplicates();
+		PLOGI << m_archives.size() << " archive(s) found";
+		return m_archives;
+	}
+
+	QString Substitute(QString value) const
+	{
+		for (const auto& [name, substitution] : m_variables)
+		{
+			if (!value.contains(name))
+				continue;
+
+			if (substitution.isEmpty())
+				throw std::invalid_argument(QString("variable %1 is empty, set it with -D %1=value").arg(name.mid(1, name.size() - 2)).toStdString());
+
+			value.replace(name, substitution);
+		}
+		return value;
+	}
+
+	QString Substitute(QString value, const Task& task) const
+	{
+		return Substitute(std::move(value), task.stage, task.archive);
+	}
+
+	QString Substitute(QString value, const Stage& stage, const ptrdiff_t archive) const
+	{
+		value.replace(STAGE, stage.name);
+		if (archive >= 0)
+		{
+			const QFileInfo fileInfo(m_archives[archive]);
+			value.replace(ARCHIVE_NAME, fileInfo.completeBaseName()).replace(ARCHIVE_DIR, fileInfo.absolutePath()).replace(ARCHIVE, fileInfo.absoluteFilePath());
+		}
+
+		return Substitute(std::move(value));
+	}
+
+	bool CanExpand(const Stage& stage) const
+	{
+		return std::ranges::all_of(stage.depends, [&](const Stage* depend) {
+			return stage.scope == Scope::Archive && depend->scope == Scope::Global ? depend->IsFinished() : depend->expanded;
+		});
+	}
+
+	void Expand()
+	{
+		for (auto& stage : m_stages | std::views::transform([](const auto& item) -> Stage& { return *item; }))
+		{
+			if (stage.expanded || !CanExpand(stage))
+				continue;
+
+			stage.expanded = true;
+			if (stage.scope == Scope::Global)
+			{
+				AddTask(stage, -1);
+				continue;
+			}
+
+			for (ptrdiff_t archive = 0, size = GetArchives().size(); archive < size; ++archive)
+				AddTask(stage, archive);
+		}
+	}
+
+	void AddTask(Stage& stage, const ptrdiff_t archive)
+	{
+		auto& task   = *stage.tasks.emplace_back(std::make_unique<Task>(stage, archive));
+		task.key     = archive < 0 ? stage.name : QString("%1/%2").arg(stage.name, QFileInfo(m_archives[archive]).fileName());
+		task.outputs = stage.outputs | std::views::transform([&](const auto& item) {
+						   return Substitute(item, task);
+					   })
+		             | std::ranges::to<QStringList>();
+
+		for (const auto* depend : stage.depends)
+		{
+			for (const auto& dependency : depend->tasks)
+			{
+				if (stage.scope == Scope::Archive && depend->scope == Scope::Archive && dependency->archive != archive)
+					continue;
+
+				task.dependencies.push_back(dependency.get());
+				if (dependency->state == State::Failed || dependency->state == State::Blocked)
+					task.state = State::Blocked;
+				else if (dependency->state != State::Done)
+				{
+					++task.waiting;
+					dependency->dependents.push_back(&task);
+				}
+			}
+		}
+
+		if (task.state == State::Blocked)
+			PLOGW << task.key << " skipped: dependency failed";
+		else if (task.waiting == 0)
+			SetReady(task);
+	}
+
+	void SetReady(Task& task)
+	{
+		task.state = State::Ready;
+		m_ready.insert(&task);
+	}
+
+	void Pump()
+	{
+		if (m_pumping)
+			return;
+
+		m_pumping = true;
+		for (auto started = true; started;)
+		{
+			started = false;
+			for (auto it = m_ready.begin(); it != m_ready.end() && m_running < m_settings.jobs; ++it)
+			{
+				auto* task = *it;
+				if (task->stage.running >= task->stage.concurrency)
+					continue;
+
+				m_ready.erase(it);
+				try
+				{
+					Start(*task);
+				}
+				catch (const std::exception& ex)
+				{
+					Fail(*task, ex.what());
+				}
+				started = true;
+				break;
+			}
+		}
+		m_pumping = false;
+
+		if (IsIdle())
+			m_eventLoop.exit();
+	}
+
+	bool IsIdle() const noexcept
+	{
+		return m_running == 0 && m_ready.empty();
+	}
+
+	QString ResolveProgram(const QString& program) const
+	{
+		if (QFileInfo(program).isAbsolute())
+			return program;
+
+		if (auto path = QStandardPaths::findExecutable(program, { m_settings.tools }); !path.isEmpty())
+			return path;
+
+		if (auto path = QStandardPaths::findExecutable(program); !path.isEmpty())
+			return path;
+
+		return program;
+	}
+
+	QStringList GetArguments(const Task& task)
+	{
+		QStringList result;
+		for (const auto& argument : task.stage.arguments)
+		{
+			if (task.archive >= 0 || !IsArchiveArgument(argument))
+			{
+				result << Substitute(argument, task);
+				continue;
+			}
+
+			for (ptrdiff_t archive = 0, size = GetArchives().size(); archive < size; ++archive)
+				result << Substitute(argument, task.stage, archive);
+		}
+
+		return result;
+	}
+
+	QStringList GetInputs(const Task& task)
+	{
+		auto result = task.stage.inputs | std::views::transform([&](const auto& item) {
+						  return Substitute(item, task);
+					  })
+		            | std::ranges::to<QStringList>();
+
+		if (task.archive >= 0)
+			result << m_archives[task.archive];
+
+		if (task.archive < 0 && std::ranges::any_of(task.stage.arguments, &IsArchiveArgument))
+			result << GetArchives();
+
+		for (const auto* dependency : task.dependencies)
+			result << dependency->outputs;
+
+		return result;
+	}
+
+	void Start(Task& task)
+	{
+		auto&      stage       = task.stage;
+		const auto program     = ResolveProgram(Substitute(stage.program, task));
+		const auto arguments   = GetArguments(task);
+		const auto fingerprint = CalculateFingerprint(program, arguments, GetInputs(task));
+
+		if (!m_settings.force && m_fingerprints.Get(task.key) == fingerprint && OutputsExist(task.outputs))
+		{
+			PLOGI << task.key << " is up to date";
+			task.upToDate = true;
+			return Finish(task, true);
+		}
+
+		const auto commandLine = (QStringList { program } + arguments).join(' ');
+		if (m_settings.dryRun)
+		{
+			PLOGI << task.key << ": " << commandLine;
+			return Finish(task, true);
+		}
+
+		for (const auto& directory : stage.directories)
+		{
+			if (const auto path = Substitute(directory, task); !QDir(path).mkpath("."))
+			{
+				PLOGE << task.key << ": cannot create " << path;
+				return Finish(task, false);
+			}
+		}
+
+		++m_running;
+		++stage.running;
+		task.state = State::Running;
+		task.start = std::chrono::steady_clock::now();
+
+		auto* process = new QProcess;
+		process->setProgram(program);
+		process->setArguments(arguments);
+		if (m_settings.logs.isEmpty())
+		{
+			process->setProcessChannelMode(QProcess::ForwardedChannels);
+		}
+		else
+		{
+			process->setProcessChannelMode(QProcess::MergedChannels);
+			process->setStandardOutputFile(QDir(m_settings.logs).filePath(QString(task.key).replace('/', '.') + ".log"));
+		}
+
+		const auto onFinished = [this, &task, process, fingerprint](const bool success, const QString& message) {
+			process->disconnect();
+			process->deleteLater();
+			--m_running;
+			--task.stage.running;
+
+			const auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - task.start).count();
+			if (success)
+			{
+				PLOGI << task.key << " " << message << " in " << elapsed << " s";
+				m_fingerprints.Set(task.key, fingerprint);
+			}
+			else
+			{
+				PLOGE << task.key << " " << message << " in " << elapsed << " s";
+			}
+
+			// the handler runs inside a Qt slot, an exception must not leave it
+			try
+			{
+				Finish(task, success);
+			}
+			catch (const std::exception& ex)
+			{
+				Fail(task, ex.what());
+			}
+			Pump();
+		};
+
+		QObject::connect(process, &QProcess::finished, [=](const int exitCode, const QProcess::ExitStatus exitStatus) {
+			onFinished(exitStatus == QProcess::NormalExit && exitCode == 0, exitStatus == QProcess::NormalExit ? QString("finished with code %1").arg(exitCode) : QString("crashed"));
+		});
+		QObject::connect(process, &QProcess::errorOccurred, [=](const QProcess::ProcessError error) {
+			if (error == QProcess::FailedToStart)
+				onFinished(false, QString("failed to start: %1").arg(process->errorString()));
+		});
+
+		PLOGI << task.key << " started: " << commandLine;
+		process->start();
+	}
+
+	void Finish(Task& task, const bool success)
+	{
+		task.state = success ? State::Done : State::Failed;
+		if (success)
+		{
+			for (auto* dependent : task.dependents)
+				if (dependent->state == State::Pending && --dependent->waiting == 0)
+					SetReady(*dependent);
+		}
+		else
+		{
+			Block(task);
+		}
+
+		Expand();
+	}
+
+	void Fail(Task& task, const char* message)
+	{
+		PLOGE << task.key << ": " << message;
+		task.state = State::Failed;
+		Block(task);
+	}
+
+	void Block(const Task& task)
+	{
+		for (auto* dependent : task.dependents)
+		{
+			if (dependent->state != State::Pending)
+				continue;
+
+			dependent->state = State::Blocked;
+			PLOGW << dependent->key << " skipped: " << task.key << " failed";
+			Block(*dependent);
+		}
+	}
+
+	size_t Report() const
+	{
+		size_t result = 0;
+		for (const auto& stage : m_stages)
+		{
+			if (!stage->expanded)
+			{
+				PLOGW << stage->name << " not started";
+				++result;
+				continue;
+			}
+
+			const auto count = [&](const auto& pred) {
+				return static_cast<size_t>(std::ranges::count_if(stage->tasks, [&](const auto& task) { return pred(*task); }));
+			};
+			const auto done     = count([](const Task& task) { return task.state == State::Done && !task.upToDate; });
+			const auto upToDate = count([](const Task& task) { return task.upToDate; });
+			const auto failed   = count([](const Task& task) { return task.state == State::Failed; });
+			const auto blocked  = count([](const Task& task) { return task.state != State::Done && task.state != State::Failed; });
+
+			PLOGI << QString("%1: %2 done, %3 up to date, %4 failed, %5 skipped").arg(stage->name).arg(done).arg(upToDate).arg(failed).arg(blocked);
+			result += failed + blocked;
+		}
+
+		return result;
+	}
+
+private:
+	const std::vector<std::pair<QString, QString>> m_variables;
+	const Settings                                 m_settings;
+	FingerprintStore                               m_fingerprints;
+	const QStringList                              m_archiveWildcards;
+	QStringList                                    m_archives;
+	bool                                           m_archivesResolved { false };
+	std::vector<std::unique_ptr<Stage>>            m_stages;
+	std::set<Task*, TaskOrder>                     m_ready;
+	int                                            m_running { 0 };
+	bool                                           m_pumping { false };
+	QEventLoop                                     m_eventLoop;
+};
+
+Pipeline::Pipeline(const QJsonObject& config, Settings settings)
+	: m_impl { std::make_unique<Impl>(config, std::move(settings)) }
+{
+}
+
+Pipeline::~Pipeline() = default;
+
+size_t Pipeline::Run()
+{
+	return m_impl->Run();
+}
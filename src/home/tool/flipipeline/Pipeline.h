@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+
+#include <QString>
+
+#include "fnd/NonCopyMovable.h"
+
+class QJsonObject;
+
+namespace HomeCompa::flipipeline
+{
+
+class Pipeline
+{
+	NON_COPY_MOVABLE(Pipeline)
+
+public:
+	struct Settings
+	{
+		QString tools;
+		QString state;
+		QString logs;
+		int     jobs { 0 };
+		bool    force { false };
+		bool    dryRun { false };
+	};
+
+public:
+	Pipeline(const QJsonObject& config, Settings settings);
+	~Pipeline();
+
+	size_t Run();
+
+private:
+	class Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace HomeCompa::flipipeline
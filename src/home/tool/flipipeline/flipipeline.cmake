@@ -0,0 +1,11 @@
+AddTarget(flipipeline	app_console
+	PROJECT_GROUP Tool
+	SOURCE_DIRECTORY
+		"${CMAKE_CURRENT_LIST_DIR}"
+	LINK_LIBRARIES
+		Qt${QT_MAJOR_VERSION}::Core
+	LINK_TARGETS
+		lib
+		logging
+		util
+)
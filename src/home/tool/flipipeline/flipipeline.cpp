@@ -0,0 +1,141 @@
+﻿#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+
+#include "lib/AsyncAppender.h"
+#include "lib/Resources.h"
+#include "logging/init.h"
+#include "util/LogConsoleFormatter.h"
+
+#include "Pipeline.h"
+#include "log.h"
+
+#include "config/version.h"
+
+using namespace HomeCompa;
+using namespace flipipeline;
+
+namespace
+{
+
+constexpr auto APP_ID = "flipipeline";
+
+constexpr auto CONFIG  = "config";
+constexpr auto DEFINE  = "define";
+constexpr auto TOOLS   = "tools";
+constexpr auto STATE   = "state";
+constexpr auto LOGS    = "logs";
+constexpr auto JOBS    = "jobs";
+constexpr auto FORCE   = "force";
+constexpr auto DRY_RUN = "dry-run";
+
+constexpr auto DEFAULT_CONFIG = ":/config/pipeline.json";
+
+QJsonObject ReadConfig(const QString& path)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+		throw std::ios_base::failure(QString("Cannot open %1").arg(path).toStdString());
+
+	QJsonParseError jsonParseError;
+	const auto      doc = QJsonDocument::fromJson(file.readAll(), &jsonParseError);
+	if (jsonParseError.error != QJsonParseError::NoError)
+		throw std::invalid_argument(QString("%1: %2").arg(path, jsonParseError.errorString()).toStdString());
+
+	return doc.object();
+}
+
+void AddDefines(QJsonObject& config, const QStringList& defines)
+{
+	auto variables = config["variables"].toObject();
+	for (const auto& define : defines)
+	{
+		const auto pos = define.indexOf('=');
+		if (pos <= 0)
+			throw std::invalid_argument(QString("invalid definition %1, name=value expected").arg(define).toStdString());
+
+		variables.insert(define.left(pos), define.mid(pos + 1));
+	}
+
+	config.insert("variables", variables);
+}
+
+size_t run(const QCommandLineParser& parser)
+{
+	auto config = ReadConfig(parser.isSet(CONFIG) ? parser.value(CONFIG) : DEFAULT_CONFIG);
+	AddDefines(config, parser.values(DEFINE));
+
+	Pipeline pipeline(
+		config,
+		{
+			.tools  = parser.value(TOOLS),
+			.state  = parser.value(STATE),
+			.logs   = parser.value(LOGS),
+			.jobs   = parser.value(JOBS).toInt(),
+			.force  = parser.isSet(FORCE),
+			.dryRun = parser.isSet(DRY_RUN),
+    }
+	);
+
+	return pipeline.Run();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	const QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName(APP_ID);
+	QCoreApplication::setApplicationVersion(PRODUCT_VERSION);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QString("%1 runs library update tools as an incremental per archive pipeline").arg(APP_ID));
+	parser.addHelpOption();
+	parser.addVersionOption();
+	parser.addOptions(
+		{
+			{ { "c", CONFIG }, "Pipeline config file [embedded]", "path" },
+			{ { "D", DEFINE }, "Set config variable, may be repeated", "name=value" },
+			{ TOOLS, "Folder with tool executables [flipipeline folder]", "folder" },
+			{ STATE, "Fingerprint state file [config state]", "path" },
+			{ LOGS, "Folder for tool output logs [config logs]", "folder" },
+			{ { "j", JOBS }, "Maximum number of simultaneously running tools [config jobs]", "number" },
+			{ FORCE, "Ignore fingerprints and run every step" },
+			{ DRY_RUN, "Print commands without running them" },
+    }
+	);
+
+	const auto defaultLogPath  = QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID);
+	const auto logOption       = Log::LoggingInitializer::AddLogFileOption(parser, defaultLogPath);
+	const auto resourcesOption = FliLib::ResourceReporter::AddResourceReportOption(parser);
+	parser.process(app);
+
+	FliLib::AsyncLoggingInitializer<Util::LogConsoleFormatter> logging(parser.isSet(logOption) ? parser.value(logOption) : defaultLogPath);
+	FliLib::ResourceReporter                                   resources(parser.value(resourcesOption));
+	PLOGI << QString("%1 started").arg(APP_ID);
+
+	try
+	{
+		if (const auto failed = run(parser); failed != 0)
+		{
+			PLOGE << QString("%1 finished with %2 failed step(s)").arg(APP_ID).arg(failed);
+			return 1;
+		}
+
+		PLOGI << QString("%1 finished").arg(APP_ID);
+		return 0;
+	}
+	catch (const std::exception& ex)
+	{
+		PLOGE << QString("%1 failed: %2").arg(APP_ID).arg(ex.what());
+	}
+	catch (...)
+	{
+		PLOGE << QString("%1 failed").arg(APP_ID);
+	}
+
+	return 1;
+}
@@ -0,0 +1,296 @@
+#include "Transfer.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QTimer>
+
+#include "log.h"
+
+using namespace HomeCompa::fliscaner;
+
+namespace
+{
+
+constexpr auto TRANSFER_TIMEOUT     = std::chrono::minutes(1);
+constexpr auto VALIDATORS_EXTENSION = ".validators";
+
+constexpr int HTTP_OK                    = 200;
+constexpr int HTTP_PARTIAL_CONTENT       = 206;
+constexpr int HTTP_NOT_MODIFIED          = 304;
+constexpr int HTTP_RANGE_NOT_SATISFIABLE = 416;
+
+struct ContentRange
+{
+	int64_t start { -1 };
+	int64_t total { -1 };
+};
+
+ContentRange ParseContentRange(const QByteArray& value)
+{
+	// bytes 100-199/1000, bytes */1000, bytes 100-199/*
+	ContentRange result;
+	const auto   range = value.trimmed();
+	if (!range.startsWith("bytes "))
+		return result;
+
+	const auto slash = range.indexOf('/');
+	if (slash < 0)
+		return result;
+
+	bool       ok    = false;
+	const auto total = range.mid(slash + 1).toLongLong(&ok);
+	if (ok)
+		result.total = total;
+
+	const auto dash  = range.indexOf('-');
+	const auto start = dash < 0 || dash > slash ? -1 : range.mid(6, dash - 6).toLongLong(&ok);
+	if (dash >= 0 && dash < slash && ok)
+		result.start = start;
+
+	return result;
+}
+
+Transfer::Validators ReadValidators(const QString& fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return {};
+
+	const auto obj = QJsonDocument::fromJson(file.readAll()).object();
+	return { obj.value("etag").toString(), obj.value("lastModified").toString() };
+}
+
+QByteArray GetIfRange(const Transfer::Validators& validators)
+{
+	// If-Range accepts only a strong entity tag
+	return (!validators.etag.isEmpty() && !validators.etag.startsWith("W/") ? validators.etag : validators.lastModified).toUtf8();
+}
+
+} // namespace
+
+class Transfer::Impl
+{
+	NON_COPY_MOVABLE(Impl)
+
+public:
+	Impl(QNetworkAccessManager& manager, const QString& url, const QString& fileName, Callback callback, Progress progress, const Validators& validators)
+		: m_file { fileName }
+		, m_callback { std::move(callback) }
+		, m_progress { std::move(progress) }
+	{
+		if (!m_file.open(QIODevice::ReadWrite))
+		{
+			QTimer::singleShot(0, &m_context, [this] {
+				Finish(Status::Failed, QString("cannot open %1").arg(m_file.fileName()));
+			});
+			return;
+		}
+
+		m_offset = m_file.size();
+
+		QNetworkRequest request(url);
+		request.setTransferTimeout(TRANSFER_TIMEOUT);
+		request.setRawHeader("Accept-Encoding", "identity");
+		if (m_offset > 0)
+		{
+			if (const auto ifRange = GetIfRange(ReadValidators(GetValidatorsFileName())); !ifRange.isEmpty())
+			{
+				request.setRawHeader("Range", QString("bytes=%1-").arg(m_offset).toUtf8());
+				request.setRawHeader("If-Range", ifRange);
+				PLOGI << url << " resumed from " << m_offset;
+			}
+			else
+			{
+				PLOGW << url << ": partial download has no validators, restarting from the beginning";
+				Restart();
+			}
+		}
+
+		m_file.seek(m_offset);
+		if (m_offset == 0)
+		{
+			if (!validators.etag.isEmpty())
+				request.setRawHeader("If-None-Match", validators.etag.toUtf8());
+			if (!validators.lastModified.isEmpty())
+				request.setRawHeader("If-Modified-Since", validators.lastModified.toUtf8());
+		}
+
+		m_reply = manager.get(request);
+		QObject::connect(m_reply, &QNetworkReply::readyRead, &m_context, [this] {
+			OnReadyRead();
+		});
+		QObject::connect(m_reply, &QNetworkReply::downloadProgress, &m_context, [this](const qint64 bytesReceived, const qint64 bytesTotal) {
+			if (m_progress)
+				m_progress(m_offset + bytesReceived, bytesTotal < 0 ? -1 : m_offset + bytesTotal);
+		});
+		QObject::connect(m_reply, &QNetworkReply::finished, &m_context, [this] {
+			OnFinished();
+		});
+	}
+
+	~Impl()
+	{
+		if (!m_reply)
+			return;
+
+		m_reply->disconnect();
+		m_reply->abort();
+		m_reply->deleteLater();
+	}
+
+private:
+	bool CheckStatus()
+	{
+		if (m_checked)
+			return m_accepted;
+
+		m_checked = true;
+
+		switch (m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt())
+		{
+			case HTTP_PARTIAL_CONTENT:
+			{
+				const auto range = ParseContentRange(m_reply->rawHeader("Content-Range"));
+				if (range.start != m_offset)
+				{
+					m_error = QString("unexpected content range %1").arg(QString::fromUtf8(m_reply->rawHeader("Content-Range")));
+					Restart();
+					m_reply->abort();
+					return false;
+				}
+
+				m_total = range.total;
+				return m_accepted = true;
+			}
+
+			case HTTP_OK:
+			{
+				if (m_offset > 0)
+				{
+					PLOGW << m_reply->url().toString() << " changed or does not support range requests, restarting from the beginning";
+					Restart();
+				}
+
+				const auto contentLength = m_reply->header(QNetworkRequest::ContentLengthHeader);
+				m_total                  = contentLength.isValid() ? contentLength.toLongLong() : -1;
+				WriteValidators();
+				return m_accepted = true;
+			}
+
+			default:
+				return false;
+		}
+	}
+
+	void Restart()
+	{
+		m_offset = 0;
+		m_file.resize(0);
+		m_file.seek(0);
+		QFile::remove(GetValidatorsFileName());
+	}
+
+	QString GetValidatorsFileName() const
+	{
+		return m_file.fileName() + VALIDATORS_EXTENSION;
+	}
+
+	void WriteValidators() const
+	{
+		const QJsonObject obj {
+			{         "etag",         QString::fromUtf8(m_reply->rawHeader("ETag")) },
+			{ "lastModified", QString::fromUtf8(m_reply->rawHeader("Last-Modified")) },
+		};
+
+		QFile file(GetValidatorsFileName());
+		if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(obj).toJson(QJsonDocument::Compact)) < 0)
+			PLOGW << "cannot write " << file.fileName();
+	}
+
+	void OnReadyRead()
+	{
+		if (!CheckStatus())
+			return;
+
+		if (const auto bytes = m_reply->readAll(); m_file.write(bytes) != bytes.size())
+		{
+			m_error = QString("cannot write to %1: %2").arg(m_file.fileName(), m_file.errorString());
+			m_reply->abort();
+		}
+	}
+
+	void OnFinished()
+	{
+		OnReadyRead();
+
+		if (!m_error.isEmpty())
+			return Finish(Status::Failed, m_error);
+
+		const auto status = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+		if (status == HTTP_NOT_MODIFIED)
+			return Finish(Status::NotModified, {});
+
+		if (status == HTTP_RANGE_NOT_SATISFIABLE)
+		{
+			if (const auto range = ParseContentRange(m_reply->rawHeader("Content-Range")); m_offset > 0 && range.total == m_offset)
+				return Finish(Status::Completed, {});
+
+			Restart();
+			return Finish(Status::Failed, "requested range not satisfiable");
+		}
+
+		if (m_reply->error() != QNetworkReply::NoError)
+			return Finish(Status::Failed, m_reply->errorString());
+
+		if (!m_accepted)
+			return Finish(Status::Failed, QString("unexpected HTTP status %1").arg(status));
+
+		if (m_total >= 0 && m_file.size() != m_total)
+			return Finish(Status::Failed, QString("%1 of %2 bytes received").arg(m_file.size()).arg(m_total));
+
+		Finish(Status::Completed, {});
+	}
+
+	void Finish(const Status status, const QString& message)
+	{
+		if (!m_callback)
+			return;
+
+		m_file.close();
+		if (status != Status::Failed)
+			QFile::remove(GetValidatorsFileName());
+
+		Result result;
+		result.status  = status;
+		result.message = message;
+		if (m_reply)
+		{
+			result.validators.etag         = QString::fromUtf8(m_reply->rawHeader("ETag"));
+			result.validators.lastModified = QString::fromUtf8(m_reply->rawHeader("Last-Modified"));
+		}
+
+		std::exchange(m_callback, {})(result);
+	}
+
+private:
+	QObject        m_context;
+	QFile          m_file;
+	Callback       m_callback;
+	Progress       m_progress;
+	QNetworkReply* m_reply { nullptr };
+	int64_t        m_offset { 0 };
+	int64_t        m_total { -1 };
+	bool           m_checked { false };
+	bool           m_accepted { false };
+	QString        m_error;
+};
+
+Transfer::Transfer(QNetworkAccessManager& manager, const QString& url, const QString& fileName, Callback callback, Progress progress, const Validators& validators)
+	: m_impl { std::make_unique<Impl>(manager, url, fileName, std::move(callback), std::move(progress), validators) }
+{
+}
+
+Transfer::~Transfer() = default;
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include <QString>
+
+#include "fnd/NonCopyMovable.h"
+
+class QNetworkAccessManager;
+
+namespace HomeCompa::fliscaner
+{
+
+class Transfer
+{
+	NON_COPY_MOVABLE(Transfer)
+
+public:
+	enum class Status
+	{
+		Failed,
+		Completed,
+		NotModified,
+	};
+
+	struct Validators
+	{
+		QString etag;
+		QString lastModified;
+	};
+
+	struct Result
+	{
+		Status     status { Status::Failed };
+		QString    message;
+		Validators validators;
+	};
+
+	using Callback = std::function<void(const Result& result)>;
+	using Progress = std::function<void(int64_t bytesReceived, int64_t bytesTotal)>;
+
+public:
+	Transfer(QNetworkAccessManager& manager, const QString& url, const QString& fileName, Callback callback, Progress progress = {}, const Validators& validators = {});
+	~Transfer();
+
+private:
+	class Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace HomeCompa::fliscaner
@@ -0,0 +1,110 @@
+#include "Verifier.h"
+
+#include <vector>
+
+#include <QFile>
+#include <QString>
+
+#include <boost/crc.hpp>
+#include <zlib.h>
+
+#include "fnd/ScopedCall.h"
+
+#include "lib/Trace.h"
+#include "lib/ZipTail.h"
+
+#include "zip.h"
+
+using namespace HomeCompa;
+
+namespace
+{
+
+constexpr qint64 BUFFER_SIZE = 1024 * 1024;
+
+void VerifyZip(const QString& path)
+{
+	const auto tail    = FliLib::ReadZipTail(path);
+	const auto entries = FliLib::ParseCentralDirectory(FliLib::ReadCentralDirectory(path, tail));
+	if (entries.size() != tail.entryCount)
+		throw std::ios_base::failure(QString("%1: %2 entries expected, %3 found").arg(path).arg(tail.entryCount).arg(entries.size()).toStdString());
+
+	const Zip zip(path);
+	for (const auto& entry : entries)
+	{
+		if (entry.fileName.endsWith('/'))
+			continue;
+
+		const auto input  = zip.Read(entry.fileName);
+		auto&      stream = input->GetStream();
+
+		boost::crc_32_type crc;
+		uint64_t           size = 0;
+		for (auto bytes = stream.read(BUFFER_SIZE); !bytes.isEmpty(); bytes = stream.read(BUFFER_SIZE))
+		{
+			crc.process_bytes(bytes.constData(), static_cast<size_t>(bytes.size()));
+			size += static_cast<uint64_t>(bytes.size());
+		}
+
+		if (size != entry.size || crc.checksum() != entry.crc)
+			throw std::ios_base::failure(QString("%1: %2 is corrupted").arg(path, entry.fileName).toStdString());
+	}
+}
+
+void VerifyGzip(const QString& path)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+		throw std::ios_base::failure(QString("Cannot open %1").arg(path).toStdString());
+
+	z_stream stream {};
+	if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+		throw std::ios_base::failure("Cannot initialize zlib");
+
+	const ScopedCall streamGuard([&] {
+		inflateEnd(&stream);
+	});
+
+	std::vector<Bytef> output(BUFFER_SIZE);
+	auto               result = Z_OK;
+	for (auto input = file.read(BUFFER_SIZE); !input.isEmpty(); input = file.read(BUFFER_SIZE))
+	{
+		stream.next_in  = reinterpret_cast<Bytef*>(input.data());
+		stream.avail_in = static_cast<uInt>(input.size());
+		do
+		{
+			// concatenated gzip members
+			if (result == Z_STREAM_END)
+			{
+				if (stream.avail_in == 0)
+					break;
+				if (inflateReset(&stream) != Z_OK)
+					throw std::ios_base::failure(QString("%1: cannot reset zlib stream").arg(path).toStdString());
+			}
+
+			stream.next_out  = output.data();
+			stream.avail_out = static_cast<uInt>(output.size());
+			result           = inflate(&stream, Z_NO_FLUSH);
+			if (result == Z_BUF_ERROR)
+				break;
+			if (result != Z_OK && result != Z_STREAM_END)
+				throw std::ios_base::failure(QString("%1: %2").arg(path, stream.msg ? stream.msg : "corrupted gzip stream").toStdString());
+		}
+		while (stream.avail_in > 0 || stream.avail_out == 0);
+	}
+
+	if (result != Z_STREAM_END)
+		throw std::ios_base::failure(QString("%1: unexpected end of gzip stream").arg(path).toStdString());
+}
+
+} // namespace
+
+void fliscaner::VerifyArchive(const QString& path, const QString& ext)
+{
+	const FliLib::TraceSpan span("VerifyArchive", path);
+
+	if (ext == "zip")
+		return VerifyZip(path);
+	if (ext == "gz")
+		return VerifyGzip(path);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+class QString;
+
+namespace HomeCompa::fliscaner
+{
+
+void VerifyArchive(const QString& path, const QString& ext);
+
+}
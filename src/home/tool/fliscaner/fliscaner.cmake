@@ -3,9 +3,13 @@
 	SOURCE_DIRECTORY
 		"${CMAKE_CURRENT_LIST_DIR}"
 	LINK_LIBRARIES
+		Boost::headers
 		Qt${QT_MAJOR_VERSION}::Core
 		Qt${QT_MAJOR_VERSION}::Network
+		ZLIB::ZLIB
 	LINK_TARGETS
+		lib
 		logging
 		network
+		zip
 )
@@ -1,3 +1,4 @@
+﻿#include <filesystem>
 #include <queue>
 #include <unordered_set>
 
@@ -11,20 +12,26 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QSaveFile>
 #include <QStandardPaths>
 #include <QString>
-#include <QThread>
+#include <QThreadPool>
 #include <QTimer>
 
-#include <plog/Appenders/ConsoleAppender.h>
-
 #include "fnd/FindPair.h"
 
-#include "logging/LogAppender.h"
+#include "lib/AsyncAppender.h"
+#include "lib/Resources.h"
+#include "lib/Trace.h"
 #include "logging/init.h"
 #include "network/network/downloader.h"
 #include "util/LogConsoleFormatter.h"
 
+#include "Transfer.h"
+#include "Verifier.h"
 #include "log.h"
 
 #include "config/version.h"
@@ -41,6 +48,9 @@ constexpr auto CONFIG        = "config";
 constexpr auto ATTEMPTS      = "attempts";
 constexpr auto COUNT         = "count";
 constexpr auto READY_LIST    = "ready-list";
+constexpr auto CHANGED_LIST  = "changed-list";
+
+constexpr auto METADATA_FILE_NAME = "fliscaner.metadata.json";
 
 constexpr auto DEFAULT_COUNT   = 3;
 constexpr auto DEFAULT_TIMEOUT = 5000;
@@ -48,29 +58,280 @@ int            MAX_ATTEMPTS    = 10;
 
 QString           DST_PATH;
 std::set<QString> UNIQUE_FILES;
+std::set<QString> CHANGED_FILES;
+QJsonObject       METADATA;
+
+constexpr auto MAX_BACKOFF = 10 * 60 * 1000;
+
+constexpr auto DEFAULT_HOOK_CONCURRENCY = 1;
+constexpr auto DEFAULT_HOOK_CAPACITY    = 16;
+
+class HookQueue
+{
+	NON_COPY_MOVABLE(HookQueue)
+
+	struct Hook
+	{
+		QRegularExpression regexp;
+		QString            program;
+		QStringList        arguments;
+	};
+
+	struct Command
+	{
+		QString     program;
+		QStringList arguments;
+	};
+
+public:
+	explicit HookQueue(std::function<void()> onFinished)
+		: m_onFinished { std::move(onFinished) }
+	{
+	}
+
+	void Load(const QJsonValue& value)
+	{
+		if (!value.isObject())
+			return;
+
+		const auto obj = value.toObject();
+		m_concurrency  = std::max(obj["concurrency"].toInt(DEFAULT_HOOK_CONCURRENCY), 1);
+		m_capacity     = static_cast<size_t>(std::max(obj["capacity"].toInt(DEFAULT_HOOK_CAPACITY), 1));
+
+		for (const auto hookValue : obj["commands"].toArray())
+		{
+			const auto hookObj = hookValue.toObject();
+			auto&      hook    = m_hooks.emplace_back();
+			hook.regexp.setPattern(hookObj["regexp"].toString());
+			hook.program = hookObj["program"].toString();
+			for (const auto argument : hookObj["arguments"].toArray())
+				hook.arguments << argument.toString();
+
+			if (!hook.regexp.isValid() || hook.program.isEmpty())
+			{
+				PLOGE << "invalid hook: " << QJsonDocument(hookObj).toJson(QJsonDocument::Compact);
+				m_hooks.pop_back();
+			}
+		}
+
+		if (!m_hooks.empty())
+			PLOGI << m_hooks.size() << " hook(s) loaded, concurrency: " << m_concurrency;
+	}
+
+	void Enqueue(const QString& file, const QString& path)
+	{
+		const auto substitute = [&](QString value) {
+			return value.replace("%file%", file).replace("%path%", path).replace("%dir%", QFileInfo(path).absolutePath());
+		};
+
+		for (const auto& hook : m_hooks)
+		{
+			if (!hook.regexp.match(file).hasMatch())
+				continue;
+
+			auto& command   = m_queue.emplace();
+			command.program = substitute(hook.program);
+			std::ranges::transform(hook.arguments, std::back_inserter(command.arguments), substitute);
+		}
+
+		Pump();
+	}
+
+	bool IsFull() const noexcept
+	{
+		return m_queue.size() >= m_capacity;
+	}
+
+	bool IsIdle() const noexcept
+	{
+		return m_running == 0 && m_queue.empty();
+	}
+
+private:
+	void Pump()
+	{
+		while (m_running < m_concurrency && !m_queue.empty())
+		{
+			const auto command = std::move(m_queue.front());
+			m_queue.pop();
+			Start(command);
+		}
+	}
+
+	void Start(const Command& command)
+	{
+		++m_running;
+
+		auto* process = new QProcess;
+		process->setProgram(command.program);
+		process->setArguments(command.arguments);
+		process->setProcessChannelMode(QProcess::ForwardedChannels);
+
+		const auto commandLine = (QStringList { command.program } + command.arguments).join(' ');
+		const auto onFinished  = [this, process, commandLine](const QString& message) {
+			PLOGI << commandLine << " " << message;
+			process->disconnect();
+			process->deleteLater();
+			--m_running;
+			Pump();
+			m_onFinished();
+		};
+
+		QObject::connect(process, &QProcess::finished, [=](const int exitCode, const QProcess::ExitStatus exitStatus) {
+			onFinished(exitStatus == QProcess::NormalExit ? QString("finished with code %1").arg(exitCode) : QString("crashed"));
+		});
+		QObject::connect(process, &QProcess::errorOccurred, [=](const QProcess::ProcessError error) {
+			if (error == QProcess::FailedToStart)
+				onFinished(QString("failed to start: %1").arg(process->errorString()));
+		});
+
+		PLOGI << commandLine << " started";
+		process->start();
+	}
+
+private:
+	std::function<void()> m_onFinished;
+	std::vector<Hook>     m_hooks;
+	int                   m_concurrency { DEFAULT_HOOK_CONCURRENCY };
+	size_t                m_capacity { DEFAULT_HOOK_CAPACITY };
+	int                   m_running { 0 };
+	std::queue<Command>   m_queue;
+};
 
-class EventLooper
+class Scheduler
 {
+	NON_COPY_MOVABLE(Scheduler)
+
+public:
+	using Job = std::function<void()>;
+
 public:
+	Scheduler(const int maxInFlight, const int baseDelay)
+		: m_maxInFlight { std::max(maxInFlight, 1) }
+		, m_baseDelay { std::max(baseDelay, 0) }
+		, m_hookQueue { [this] {
+			Pump();
+		} }
+	{
+	}
+
+	void Enqueue(Job job)
+	{
+		m_queue.push(std::move(job));
+		Pump();
+	}
+
+	void Retry(Job job, const int attempt)
+	{
+		const auto delay = GetBackoff(attempt);
+		PLOGI << "retry in " << delay << " ms";
+
+		++m_delayed;
+		QTimer::singleShot(delay, [this, job = std::move(job)]() mutable {
+			--m_delayed;
+			Enqueue(std::move(job));
+		});
+	}
+
+	QNetworkAccessManager& GetNetworkAccessManager() noexcept
+	{
+		return m_networkAccessManager;
+	}
+
+	void Verify(const QString& path, const QString& ext, std::function<void(bool)> callback)
+	{
+		++m_verifying;
+		m_threadPool.start([this, path, ext, callback = std::move(callback)]() mutable {
+			auto success = true;
+			try
+			{
+				fliscaner::VerifyArchive(path, ext);
+			}
+			catch (const std::exception& ex)
+			{
+				PLOGE << ex.what();
+				success = false;
+			}
+			catch (...)
+			{
+				PLOGE << path << ": unknown error";
+				success = false;
+			}
+
+			QMetaObject::invokeMethod(
+				&m_context,
+				[this, success, callback = std::move(callback)] {
+					--m_verifying;
+					callback(success);
+					Pump();
+				},
+				Qt::QueuedConnection
+			);
+		});
+	}
+
+	HookQueue& GetHookQueue() noexcept
+	{
+		return m_hookQueue;
+	}
+
 	void Add()
 	{
-		++m_counter;
+		++m_inFlight;
 	}
 
 	void Release()
 	{
-		if (--m_counter == 0)
+		--m_inFlight;
+		Pump();
+	}
+
+	int Run()
+	{
+		Pump();
+		return IsIdle() ? 0 : m_eventLoop.exec();
+	}
+
+private:
+	void Pump()
+	{
+		while (m_inFlight < m_maxInFlight && !m_hookQueue.IsFull() && !m_queue.empty())
+		{
+			auto job = std::move(m_queue.front());
+			m_queue.pop();
+			job();
+		}
+
+		if (IsIdle())
 			m_eventLoop.exit();
 	}
 
-	int Start()
+	bool IsIdle() const noexcept
+	{
+		return m_inFlight == 0 && m_delayed == 0 && m_verifying == 0 && m_queue.empty() && m_hookQueue.IsIdle();
+	}
+
+	int GetBackoff(const int attempt) const
 	{
-		return m_counter ? m_eventLoop.exec() : 0;
+		const auto exponent = std::clamp(attempt - 1, 0, 16);
+		const auto delay    = std::min<long long>(static_cast<long long>(m_baseDelay) << exponent, MAX_BACKOFF);
+		const auto jitter   = delay / 5;
+		return static_cast<int>(delay + (jitter > 0 ? QRandomGenerator::global()->bounded(jitter) : 0));
 	}
 
 private:
-	size_t     m_counter { 0 };
-	QEventLoop m_eventLoop;
+	const int       m_maxInFlight;
+	const int       m_baseDelay;
+	int             m_inFlight { 0 };
+	int             m_delayed { 0 };
+	int             m_verifying { 0 };
+	std::queue<Job> m_queue;
+	QEventLoop      m_eventLoop;
+
+	QNetworkAccessManager m_networkAccessManager;
+	QObject               m_context;
+	QThreadPool           m_threadPool;
+	HookQueue             m_hookQueue;
 };
 
 QJsonObject ReadConfig(QFile& file)
@@ -105,6 +366,65 @@ QString GetDownloadFileName(const QString& fileName)
 	return QDir(DST_PATH).filePath(fileName);
 }
 
+void ReadMetadata()
+{
+	QFile file(GetDownloadFileName(METADATA_FILE_NAME));
+	if (!file.exists())
+		return;
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		PLOGW << "cannot read " << file.fileName();
+		return;
+	}
+
+	QJsonParseError jsonParseError;
+	const auto      doc = QJsonDocument::fromJson(file.readAll(), &jsonParseError);
+	if (jsonParseError.error != QJsonParseError::NoError)
+	{
+		PLOGW << file.fileName() << ": " << jsonParseError.errorString();
+		return;
+	}
+
+	METADATA = doc.object();
+}
+
+fliscaner::Transfer::Validators GetValidators(const QString& file)
+{
+	const auto                      obj = METADATA.value(file).toObject();
+	fliscaner::Transfer::Validators validators;
+	validators.etag         = obj.value("etag").toString();
+	validators.lastModified = obj.value("lastModified").toString();
+	return validators;
+}
+
+void SetValidators(const QString& file, const fliscaner::Transfer::Validators& validators)
+{
+	if (validators.etag.isEmpty() && validators.lastModified.isEmpty())
+		METADATA.remove(file);
+	else
+		METADATA.insert(
+			file,
+			QJsonObject {
+				{         "etag",         validators.etag },
+				{ "lastModified", validators.lastModified },
+        }
+		);
+
+	QSaveFile metadataFile(GetDownloadFileName(METADATA_FILE_NAME));
+	if (!metadataFile.open(QIODevice::WriteOnly) || metadataFile.write(QJsonDocument(METADATA).toJson()) < 0 || !metadataFile.commit())
+		PLOGW << "cannot write " << metadataFile.fileName();
+}
+
+bool Replace(const QString& src, const QString& dst)
+{
+	std::error_code ec;
+	std::filesystem::rename(std::filesystem::path(src.toStdWString()), std::filesystem::path(dst.toStdWString()), ec);
+	if (ec)
+		PLOGE << "cannot rename " << src << " to " << dst << ": " << ec.message();
+	return !ec;
+}
+
 template <typename T>
 void KillMe(T* obj);
 
@@ -117,35 +437,31 @@ bool Validate(const QByteArray& page, const QJsonArray& regexps)
 	});
 }
 
-bool Validate(const QString& path, const QString& ext)
+auto CreateProgressLogger(const QString& file)
 {
-	using namespace std::literals;
-	static constexpr auto                                                      empty = "";
-	static constexpr std::pair<const char* /*ext*/, std::string_view /*sign*/> signatures[] {
-		{ "zip",       "PK\x03\x04"sv },
-		{  "gz", "\x1F\x8B\x08\x00"sv },
-	};
-	const auto signature = FindSecond(signatures, ext.toStdString().data(), empty, PszComparer {});
+	return [file, pct = int64_t { 0 }](const int64_t bytesReceived, const int64_t bytesTotal) mutable {
+		if (bytesTotal <= 0)
+			return;
 
-	QFile file(path);
-	if (!file.open(QIODevice::ReadOnly))
-		return false;
-
-	const auto content = file.read(static_cast<qsizetype>(signature.size()));
-	return content.startsWith(signature);
+		if (const auto currentPct = 100LL * bytesReceived / bytesTotal; currentPct != pct)
+		{
+			pct = currentPct;
+			PLOGI << file << " " << bytesReceived << " (" << bytesTotal << ") " << pct << "%";
+		}
+	};
 }
 
 struct Task
 {
-	EventLooper&               eventLooper;
+	Scheduler&                 scheduler;
 	Network::Downloader        downloader;
 	std::unique_ptr<QIODevice> stream;
 
-	Task(const QString& path, const QString& file, EventLooper& eventLooper, std::unique_ptr<QIODevice> stream, std::function<void(bool)> callback)
-		: eventLooper { eventLooper }
+	Task(const QString& path, const QString& file, Scheduler& scheduler, std::unique_ptr<QIODevice> stream, std::function<void(bool)> callback)
+		: scheduler { scheduler }
 		, stream { std::move(stream) }
 	{
-		eventLooper.Add();
+		scheduler.Add();
 
 		downloader.Download(
 			path + file,
@@ -157,15 +473,8 @@ struct Task
 
 				KillMe(this_);
 			},
-			[this, file, pct = int64_t { 0 }](const int64_t bytesReceived, const int64_t bytesTotal, bool& /*stopped*/) mutable {
-				if (bytesTotal > 0)
-				{
-					if (const auto currentPct = 100LL * bytesReceived / bytesTotal; currentPct != pct)
-					{
-						pct = currentPct;
-						PLOGI << file << " " << bytesReceived << " (" << bytesTotal << ") " << pct << "%";
-					}
-				}
+			[progress = CreateProgressLogger(file)](const int64_t bytesReceived, const int64_t bytesTotal, bool& /*stopped*/) mutable {
+				progress(bytesReceived, bytesTotal);
 			}
 		);
 
@@ -174,12 +483,45 @@ struct Task
 
 	~Task()
 	{
-		eventLooper.Release();
+		scheduler.Release();
 	}
 
 	NON_COPY_MOVABLE(Task)
 };
 
+struct FileTask
+{
+	Scheduler&           scheduler;
+	fliscaner::Transfer transfer;
+
+	FileTask(const QString& path, const QString& file, const QString& tmpFile, const bool conditional, Scheduler& scheduler, std::function<void(const fliscaner::Transfer::Result&)> callback)
+		: scheduler { scheduler }
+		, transfer {
+			scheduler.GetNetworkAccessManager(),
+			path + file,
+			tmpFile,
+			[this, file, callback = std::move(callback)](const fliscaner::Transfer::Result& result) {
+				PLOGI << file << " finished " << (result.status == fliscaner::Transfer::Status::Failed ? "with " + result.message : "successfully");
+				callback(result);
+
+				KillMe(this);
+			},
+			CreateProgressLogger(file),
+			conditional ? GetValidators(file) : fliscaner::Transfer::Validators {},
+		}
+	{
+		scheduler.Add();
+		PLOGI << file << " started";
+	}
+
+	~FileTask()
+	{
+		scheduler.Release();
+	}
+
+	NON_COPY_MOVABLE(FileTask)
+};
+
 template <typename T>
 void KillMe(T* obj)
 {
@@ -188,39 +530,71 @@ void KillMe(T* obj)
 	});
 }
 
-using TaskQueue = std::queue<std::function<void()>>;
-
-void GetFile(const QString& path, const QString& file, const QString& tmpFile, const QString& dstFile, EventLooper& eventLooper, TaskQueue& taskQueue, const int count = 1)
+void GetFile(const QString& path, const QString& file, const QString& tmpFile, const QString& dstFile, Scheduler& scheduler, const int count = 1)
 {
 	if (UNIQUE_FILES.contains(file))
 		return;
 
-	auto stream = std::make_unique<QFile>(tmpFile);
-	if (!stream->open(QIODevice::WriteOnly))
-	{
-		PLOGW << "cannot open " << tmpFile;
-		return;
-	}
+	const auto conditional = QFile::exists(dstFile);
+	PLOGI << (conditional ? "revalidate " : "download ") << path + file << " try " << count;
 
-	PLOGI << "download " << path + file << " try " << count;
+	const auto retry = [path, file, tmpFile, dstFile, &scheduler, count] {
+		if (count <= MAX_ATTEMPTS)
+			return scheduler.Retry(
+				[path, file, tmpFile, dstFile, &scheduler, count] {
+					GetFile(path, file, tmpFile, dstFile, scheduler, count + 1);
+				},
+				count
+			);
+
+		PLOGE << "download " << path + file << " failed";
+	};
 
-	new Task(path, file, eventLooper, std::move(stream), [path, file = file, tmpFile, dstFile, &eventLooper, &taskQueue, count](const bool success) mutable {
-		if (success && Validate(tmpFile, QFileInfo(dstFile).suffix().toLower()))
+	new FileTask(path, file, tmpFile, conditional, scheduler, [file, tmpFile, dstFile, &scheduler, retry](const fliscaner::Transfer::Result& result) {
+		if (result.status == fliscaner::Transfer::Status::NotModified)
 		{
-			UNIQUE_FILES.emplace(std::move(file));
-			return (void)QFile::rename(tmpFile, dstFile);
+			if (!QFile::exists(dstFile))
+			{
+				PLOGW << file << ": unexpected not modified response without a local copy";
+				return retry();
+			}
+
+			PLOGI << file << " not modified";
+			QFile::remove(tmpFile);
+			UNIQUE_FILES.emplace(file);
+			return;
 		}
 
-		if (count <= MAX_ATTEMPTS)
-			return taskQueue.push([path, file, tmpFile, dstFile, &eventLooper, &taskQueue, count] {
-				GetFile(path, file, tmpFile, dstFile, eventLooper, taskQueue, count + 1);
-			});
+		if (result.status != fliscaner::Transfer::Status::Completed)
+			return retry();
 
-		PLOGE << "download " << path + file << " failed";
+		scheduler.Verify(tmpFile, QFileInfo(dstFile).suffix().toLower(), [file, tmpFile, dstFile, validators = result.validators, &scheduler, retry](const bool success) {
+			if (success)
+			{
+				PLOGI << file << " verified";
+
+				// the validators describe the new content, so they are stored only once it has replaced the local copy
+				if (!Replace(tmpFile, dstFile))
+				{
+					QFile::remove(tmpFile);
+					return retry();
+				}
+
+				SetValidators(file, validators);
+				CHANGED_FILES.emplace(file);
+				UNIQUE_FILES.emplace(file);
+				scheduler.GetHookQueue().Enqueue(file, dstFile);
+				return;
+			}
+
+			PLOGW << tmpFile << " is corrupted and will be downloaded again from the beginning";
+			QFile::remove(tmpFile);
+			retry();
+		});
 	});
 }
 
-void GetFiles(const QJsonValue& value, EventLooper& eventLooper, TaskQueue& taskQueue)
+void GetFiles(const QJsonValue& value, Scheduler& scheduler)
 {
 	assert(value.isObject());
 	const auto obj  = value.toObject();
@@ -229,19 +603,19 @@ void GetFiles(const QJsonValue& value, EventLooper& eventLooper, TaskQueue& task
 	{
 		const auto file    = fileObj.toString();
 		auto       tmpFile = GetDownloadFileName(file + ".tmp"), dstFile = GetDownloadFileName(file);
-		if (QFile::exists(dstFile))
+		if (const auto validators = GetValidators(file); QFile::exists(dstFile) && validators.etag.isEmpty() && validators.lastModified.isEmpty())
 		{
 			PLOGW << file << " already exists";
 			continue;
 		}
 
-		taskQueue.push([path, file, tmpFile, dstFile, &eventLooper, &taskQueue] {
-			GetFile(path, file, tmpFile, dstFile, eventLooper, taskQueue);
+		scheduler.Enqueue([path, file, tmpFile, dstFile, &scheduler] {
+			GetFile(path, file, tmpFile, dstFile, scheduler);
 		});
 	}
 }
 
-void GetDaily(const QJsonArray& regexps, EventLooper& eventLooper, const QString& path, const QString& data, TaskQueue& taskQueue)
+void GetDaily(const QJsonArray& regexps, Scheduler& scheduler, const QString& path, const QString& data)
 {
 	std::unordered_set<QString> files;
 	for (const auto regexpObj : regexps)
@@ -259,10 +633,10 @@ void GetDaily(const QJsonArray& regexps, EventLooper& eventLooper, const QString
 		{ "file", filesArray }
 	};
 
-	GetFiles(obj, eventLooper, taskQueue);
+	GetFiles(obj, scheduler);
 }
 
-void GetDaily(const QString& path, const QString& file, const QJsonArray& regexps, EventLooper& eventLooper, TaskQueue& taskQueue, const int count = 1)
+void GetDaily(const QString& path, const QString& file, const QJsonArray& regexps, Scheduler& scheduler, const int count = 1)
 {
 	auto page   = std::make_shared<QByteArray>();
 	auto stream = std::make_unique<QBuffer>(page.get());
@@ -270,20 +644,23 @@ void GetDaily(const QString& path, const QString& file, const QJsonArray& regexp
 
 	PLOGI << "download " << path + file << " try " << count;
 
-	new Task(path, file, eventLooper, std::move(stream), [path, file, regexps, &eventLooper, &taskQueue, count, page = std::move(page)](const bool success) {
+	new Task(path, file, scheduler, std::move(stream), [path, file, regexps, &scheduler, count, page = std::move(page)](const bool success) {
 		if (success && Validate(*page, regexps))
-			return GetDaily(regexps, eventLooper, path + file, QString::fromUtf8(*page), taskQueue);
+			return GetDaily(regexps, scheduler, path + file, QString::fromUtf8(*page));
 
 		if (count <= MAX_ATTEMPTS)
-			return taskQueue.push([path, file, regexps, &eventLooper, &taskQueue, count] {
-				GetDaily(path, file, regexps, eventLooper, taskQueue, count + 1);
-			});
+			return scheduler.Retry(
+				[path, file, regexps, &scheduler, count] {
+					GetDaily(path, file, regexps, scheduler, count + 1);
+				},
+				count
+			);
 
 		PLOGE << "download " << path + file << " failed";
 	});
 }
 
-void GetDaily(const QJsonValue& value, EventLooper& eventLooper, TaskQueue& taskQueue)
+void GetDaily(const QJsonValue& value, Scheduler& scheduler)
 {
 	assert(value.isObject());
 	const auto obj    = value.toObject();
@@ -291,17 +668,17 @@ void GetDaily(const QJsonValue& value, EventLooper& eventLooper, TaskQueue& task
 	const auto file   = obj["file"].toString();
 	const auto regexp = obj["regexp"];
 	assert(regexp.isArray());
-	taskQueue.push([path, file, regexps = regexp.toArray(), &eventLooper, &taskQueue] {
-		GetDaily(path, file, regexps, eventLooper, taskQueue);
+	scheduler.Enqueue([path, file, regexps = regexp.toArray(), &scheduler] {
+		GetDaily(path, file, regexps, scheduler);
 	});
 }
 
-void ScanStub(const QJsonValue&, EventLooper&, TaskQueue&)
+void ScanStub(const QJsonValue&, Scheduler&)
 {
 	PLOGE << "unexpected parameter";
 }
 
-constexpr std::pair<const char*, void (*)(const QJsonValue&, EventLooper&, TaskQueue&)> SCANNERS[] {
+constexpr std::pair<const char*, void (*)(const QJsonValue&, Scheduler&)> SCANNERS[] {
 	{ "zip", &GetDaily },
 	{ "sql", &GetFiles },
 };
@@ -324,22 +701,25 @@ int main(int argc, char* argv[])
 		{
 			{ { "o", OUTPUT_FOLDER },                                "Output folder",                         DST_PATH },
 			{        { "c", CONFIG },                  "Config file path (required)",                         "config" },
-			{				TIMEOUT,          "Pause between download attempts, ms", QString::number(DEFAULT_TIMEOUT) },
+			{				TIMEOUT,  "Initial pause before a download retry, ms", QString::number(DEFAULT_TIMEOUT) },
 			{			   ATTEMPTS, "Maximum number of download attempts per file",    QString::number(MAX_ATTEMPTS) },
 			{				  COUNT,    "Number of files downloaded simultaneously",   QString::number(DEFAULT_COUNT) },
 			{             READY_LIST,           "Already downloaded files list file",                           "file" },
+			{           CHANGED_LIST,          "Output list of new or changed files",                           "file" },
     }
 	);
 	parser.addPositionalArgument("sql", "Download dump files");
 	parser.addPositionalArgument("zip", "Download book archives");
 
-	const auto defaultLogPath = QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID);
-	const auto logOption      = Log::LoggingInitializer::AddLogFileOption(parser, defaultLogPath);
+	const auto defaultLogPath  = QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID);
+	const auto logOption       = Log::LoggingInitializer::AddLogFileOption(parser, defaultLogPath);
+	const auto traceOption     = FliLib::TraceInitializer::AddTraceFileOption(parser);
+	const auto resourcesOption = FliLib::ResourceReporter::AddResourceReportOption(parser);
 	parser.process(app);
 
-	Log::LoggingInitializer                          logging(parser.isSet(logOption) ? parser.value(logOption) : defaultLogPath);
-	plog::ConsoleAppender<Util::LogConsoleFormatter> consoleAppender;
-	Log::LogAppender                                 logConsoleAppender(&consoleAppender);
+	FliLib::AsyncLoggingInitializer<Util::LogConsoleFormatter> logging(parser.isSet(logOption) ? parser.value(logOption) : defaultLogPath);
+	FliLib::TraceInitializer                                   trace(parser.value(traceOption));
+	FliLib::ResourceReporter                                   resources(parser.value(resourcesOption));
 	PLOGI << QString("%1 started").arg(APP_ID);
 
 	if (parser.positionalArguments().empty())
@@ -354,6 +734,8 @@ int main(int argc, char* argv[])
 		parser.showHelp(1);
 	}
 
+	ReadMetadata();
+
 	if (!parser.isSet(CONFIG))
 		parser.showHelp(1);
 	const auto config = ReadConfig(parser.value(CONFIG));
@@ -366,38 +748,23 @@ int main(int argc, char* argv[])
 			UNIQUE_FILES = QString::fromUtf8(file.readAll()).split('\n') | std::ranges::to<std::set>();
 	}
 
-	EventLooper evenLooper;
-	TaskQueue   taskQueue;
-
-	for (const auto& arg : parser.positionalArguments())
-	{
-		const auto invoker = FindSecond(SCANNERS, arg.toStdString().data(), &ScanStub, PszComparer {});
-		PLOGI << arg << " in process";
-		std::invoke(invoker, config[arg], std::ref(evenLooper), std::ref(taskQueue));
-	}
-
 	const auto fileCount = parser.isSet(COUNT) ? parser.value(COUNT).toInt() : DEFAULT_COUNT;
 	const auto timeout   = parser.isSet(TIMEOUT) ? parser.value(TIMEOUT).toInt() : DEFAULT_TIMEOUT;
 	if (parser.isSet(ATTEMPTS))
 		MAX_ATTEMPTS = parser.value(ATTEMPTS).toInt();
 
-	while (true)
-	{
-		for (int i = 0; i < fileCount && !taskQueue.empty(); ++i)
-		{
-			auto task = std::move(taskQueue.front());
-			taskQueue.pop();
-			task();
-		}
+	Scheduler scheduler(fileCount, timeout);
+	scheduler.GetHookQueue().Load(config["hooks"]);
 
-		evenLooper.Start();
-
-		if (taskQueue.empty())
-			break;
-
-		QThread::sleep(std::chrono::milliseconds(timeout));
+	for (const auto& arg : parser.positionalArguments())
+	{
+		const auto invoker = FindSecond(SCANNERS, arg.toStdString().data(), &ScanStub, PszComparer {});
+		PLOGI << arg << " in process";
+		std::invoke(invoker, config[arg], std::ref(scheduler));
 	}
 
+	scheduler.Run();
+
 	if (!readyFiles.isEmpty())
 	{
 		QFile file(readyFiles);
@@ -405,5 +772,12 @@ int main(int argc, char* argv[])
 			file.write((UNIQUE_FILES | std::ranges::to<QStringList>()).join('\n').toUtf8());
 	}
 
+	if (parser.isSet(CHANGED_LIST))
+	{
+		QFile file(parser.value(CHANGED_LIST));
+		if (file.open(QIODevice::WriteOnly))
+			file.write((CHANGED_FILES | std::ranges::to<QStringList>()).join('\n').toUtf8());
+	}
+
 	return 0;
 }
@@ -1,16 +1,24 @@
-﻿#include <QFile>
-#include <QStandardPaths>
-#include <QTextStream>
+﻿#include <charconv>
+#include <deque>
+#include <future>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <thread>
 
-#include <plog/Appenders/ConsoleAppender.h>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
 
 #include "database/interface/ICommand.h"
 #include "database/interface/IDatabase.h"
+#include "database/interface/IQuery.h"
 #include "database/interface/ITransaction.h"
 
 #include "database/factory/Factory.h"
-#include "logging/LogAppender.h"
-#include "logging/init.h"
+#include "lib/AsyncAppender.h"
+#include "lib/Resources.h"
 #include "util/LogConsoleFormatter.h"
 
 #include "log.h"
@@ -24,6 +32,102 @@ namespace
 
 constexpr auto APP_ID = "flistat";
 
+constexpr size_t CHUNK_SIZE         = 8ULL * 1024 * 1024;
+constexpr size_t ROWS_PER_STATEMENT = 99;
+constexpr size_t FIELD_COUNT        = 10;
+constexpr size_t HEAD_SIZE          = 4096;
+
+constexpr const char* INSERT_PREFIX = "INSERT INTO Image (Folder, FileName, ImageID, FailInfo, IsCover, PixelType, Size, Width, Height, Hash) VALUES ";
+constexpr const char* INSERT_VALUES = "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+constexpr const char* UPSERT_SUFFIX = " ON CONFLICT (Folder, FileName, ImageID) DO UPDATE SET "
+                                      "FailInfo = excluded.FailInfo, IsCover = excluded.IsCover, PixelType = excluded.PixelType, "
+                                      "Size = excluded.Size, Width = excluded.Width, Height = excluded.Height, Hash = excluded.Hash";
+
+constexpr auto UNIQUE_INDEX_NAME = "UX_Image";
+constexpr auto DEDUPLICATE       = "DELETE FROM Image WHERE rowid NOT IN (SELECT MAX(rowid) FROM Image GROUP BY Folder, FileName, ImageID)";
+constexpr auto UPDATE_SOURCE     = "INSERT INTO Source (Path, Offset, Head) VALUES (?, ?, ?) ON CONFLICT (Path) DO UPDATE SET Offset = excluded.Offset, Head = excluded.Head";
+
+constexpr const char* BULK_LOAD_PRAGMAS[] {
+	"PRAGMA journal_mode = MEMORY",
+	"PRAGMA synchronous = OFF",
+	"PRAGMA temp_store = MEMORY",
+	"PRAGMA cache_size = -262144",
+	"PRAGMA locking_mode = EXCLUSIVE",
+};
+
+constexpr const char* INCREMENTAL_PRAGMAS[] {
+	"PRAGMA journal_mode = WAL",
+	"PRAGMA synchronous = NORMAL",
+	"PRAGMA temp_store = MEMORY",
+	"PRAGMA cache_size = -262144",
+};
+
+constexpr const char* INDICES[] {
+	"CREATE UNIQUE INDEX IF NOT EXISTS UX_Image ON Image (Folder, FileName, ImageID)",
+	"CREATE INDEX IF NOT EXISTS IX_Image_Hash ON Image (Hash)",
+	"CREATE INDEX IF NOT EXISTS IX_Image_Folder ON Image (Folder)",
+	"CREATE INDEX IF NOT EXISTS IX_Image_FileName ON Image (FileName)",
+};
+
+constexpr const char* MIGRATIONS[] {
+	"CREATE TABLE IF NOT EXISTS Source (Path VARCHAR (1024) NOT NULL PRIMARY KEY, Offset BIGINT NOT NULL, Head VARCHAR (50) NOT NULL)",
+	"CREATE TABLE IF NOT EXISTS FolderStat (Folder VARCHAR (200) NOT NULL PRIMARY KEY, ImageCount BIGINT NOT NULL, CoverCount BIGINT NOT NULL, FailCount BIGINT NOT NULL, TotalSize BIGINT NOT NULL)",
+	"CREATE TABLE IF NOT EXISTS FolderDimension (Folder VARCHAR (200) NOT NULL, Bucket INTEGER NOT NULL, ImageCount BIGINT NOT NULL, PRIMARY KEY (Folder, Bucket))",
+	"CREATE TABLE IF NOT EXISTS FolderSize (Folder VARCHAR (200) NOT NULL, Bucket BIGINT NOT NULL, ImageCount BIGINT NOT NULL, PRIMARY KEY (Folder, Bucket))",
+	"CREATE TABLE IF NOT EXISTS FolderFail (Folder VARCHAR (200) NOT NULL, FailInfo VARCHAR (20) NOT NULL, ImageCount BIGINT NOT NULL, PRIMARY KEY (Folder, FailInfo))",
+	"CREATE TABLE IF NOT EXISTS HashStat (Hash VARCHAR (50) NOT NULL PRIMARY KEY, ImageCount BIGINT NOT NULL, TotalSize BIGINT NOT NULL)",
+};
+
+constexpr const char* TOUCH_TRACKING[] {
+	"CREATE TEMP TABLE IF NOT EXISTS TouchedFolder (Value VARCHAR (200) NOT NULL PRIMARY KEY) WITHOUT ROWID",
+	"CREATE TEMP TABLE IF NOT EXISTS TouchedHash (Value VARCHAR (50) NOT NULL PRIMARY KEY) WITHOUT ROWID",
+	"CREATE TEMP TRIGGER IF NOT EXISTS ImageInserted AFTER INSERT ON main.Image BEGIN "
+	"INSERT INTO TouchedFolder SELECT new.Folder WHERE NOT EXISTS (SELECT 1 FROM TouchedFolder WHERE Value = new.Folder); "
+	"INSERT INTO TouchedHash SELECT new.Hash WHERE NOT EXISTS (SELECT 1 FROM TouchedHash WHERE Value = new.Hash); END",
+	"CREATE TEMP TRIGGER IF NOT EXISTS ImageUpdated AFTER UPDATE ON main.Image BEGIN "
+	"INSERT INTO TouchedFolder SELECT new.Folder WHERE NOT EXISTS (SELECT 1 FROM TouchedFolder WHERE Value = new.Folder); "
+	"INSERT INTO TouchedHash SELECT old.Hash WHERE NOT EXISTS (SELECT 1 FROM TouchedHash WHERE Value = old.Hash); "
+	"INSERT INTO TouchedHash SELECT new.Hash WHERE NOT EXISTS (SELECT 1 FROM TouchedHash WHERE Value = new.Hash); END",
+};
+
+struct Aggregate
+{
+	const char* table;
+	const char* key;
+	const char* touched;
+	const char* select;
+};
+
+constexpr Aggregate AGGREGATES[] {
+	{ "FolderStat",      "Folder", "TouchedFolder", "SELECT Folder, count(*), sum(IsCover), count(FailInfo), coalesce(sum(Size), 0) FROM Image WHERE {} GROUP BY Folder" },
+	{ "FolderDimension", "Folder", "TouchedFolder", "SELECT Folder, min(max(Width, Height) / 256, 16) * 256, count(*) FROM Image WHERE Width IS NOT NULL AND Height IS NOT NULL AND {} GROUP BY 1, 2" },
+	{ "FolderSize",      "Folder", "TouchedFolder", "SELECT Folder, min(Size / 65536, 32) * 65536, count(*) FROM Image WHERE Size IS NOT NULL AND {} GROUP BY 1, 2" },
+	{ "FolderFail",      "Folder", "TouchedFolder", "SELECT Folder, FailInfo, count(*) FROM Image WHERE FailInfo IS NOT NULL AND {} GROUP BY 1, 2" },
+	{ "HashStat",        "Hash",   "TouchedHash",   "SELECT Hash, count(*), coalesce(sum(Size), 0) FROM Image WHERE {} GROUP BY Hash" },
+};
+
+struct Row
+{
+	const char*              folder;
+	const char*              fileName;
+	const char*              imageId;
+	const char*              failInfo;
+	int                      isCover { 0 };
+	std::optional<int>       pixelType;
+	std::optional<long long> size;
+	std::optional<int>       width;
+	std::optional<int>       height;
+	const char*              hash;
+};
+
+struct Chunk
+{
+	std::vector<char> text;
+	std::vector<Row>  rows;
+	size_t            errorCount { 0 };
+	size_t            size { 0 };
+};
+
 void CreateDatabaseSchema(DB::IDatabase& db)
 {
 	static constexpr const char* COMMANDS[] {
@@ -41,9 +145,6 @@ CREATE TABLE Image (
     Hash      VARCHAR (50)  NOT NULL
 )
 )",
-		"CREATE INDEX IX_Image_Hash ON Image (Hash)",
-		"CREATE INDEX IX_Image_Folder ON Image (Folder)",
-		"CREATE INDEX IX_Image_FileName ON Image (FileName)",
 	};
 
 	const auto tr = db.CreateTransaction();
@@ -62,90 +163,380 @@ std::unique_ptr<DB::IDatabase> CreateDatabase(const std::string_view fileName)
 	return db;
 }
 
-template <std::integral T>
-using FromString = T (QString::*)(bool*, int) const;
+void UpdateDatabaseSchema(DB::IDatabase& db)
+{
+	const auto tr = db.CreateTransaction();
+	for (const auto* command : MIGRATIONS)
+		tr->CreateCommand(command)->Execute();
+	tr->Commit();
+}
+
+bool HasObject(DB::IDatabase& db, const std::string_view type, const std::string_view name)
+{
+	const auto query = db.CreateQuery(std::format("SELECT count(*) FROM sqlite_master WHERE type = '{}' AND name = '{}'", type, name));
+	query->Execute();
+	return !query->Eof() && query->Get<int>(0) > 0;
+}
+
+void RefreshAggregates(DB::ITransaction& tr, const bool full)
+{
+	for (const auto& [table, key, touched, select] : AGGREGATES)
+	{
+		const auto filter = full ? std::string("1") : std::format("{} IN (SELECT Value FROM temp.{})", key, touched);
+		tr.CreateCommand(full ? std::format("DELETE FROM {}", table) : std::format("DELETE FROM {} WHERE {}", table, filter))->Execute();
+		tr.CreateCommand(std::format("INSERT INTO {} {}", table, std::vformat(select, std::make_format_args(filter))))->Execute();
+	}
+}
+
+std::string GetHead(const std::string_view data)
+{
+	const auto head = data.substr(0, std::min(data.size(), HEAD_SIZE));
+	return QCryptographicHash::hash(QByteArrayView(head.data(), static_cast<qsizetype>(head.size())), QCryptographicHash::Sha1).toHex().toStdString();
+}
+
+size_t GetOffset(DB::IDatabase& db, const std::string& path, const std::string_view data)
+{
+	std::string escaped;
+	for (const auto ch : path)
+		(ch == '\'' ? escaped.append(2, ch) : escaped.push_back(ch));
+
+	const auto query = db.CreateQuery(std::format("SELECT Offset, Head FROM Source WHERE Path = '{}'", escaped));
+	query->Execute();
+	if (query->Eof())
+		return 0;
+
+	const auto offset = static_cast<size_t>(query->Get<long long>(0));
+	if (offset > data.size() || GetHead(data.substr(0, offset)) != query->Get<const char*>(1))
+	{
+		PLOGW << path << " was replaced since the previous import, it will be imported from the beginning";
+		return 0;
+	}
+
+	return offset;
+}
 
 template <std::integral T>
-void Bind(DB::ICommand& command, const size_t index, const QString& str, const FromString<T>& functor, const T nullValue = 0)
+std::optional<T> ToInt(const std::string_view str, const T nullValue = 0)
+{
+	T value {};
+	if (const auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value); ec != std::errc {} || ptr != str.data() + str.size() || value == nullValue)
+		return std::nullopt;
+	return value;
+}
+
+template <typename T>
+void Bind(DB::ICommand& command, const size_t index, const std::optional<T>& value)
 {
-	bool ok = false;
-	if (const auto value = std::invoke(functor, std::cref(str), &ok, 10); ok && value != nullValue)
-		command.Bind(index, value);
+	if (value)
+		command.Bind(index, *value);
 	else
 		command.Bind(index);
 }
 
-void go(const int argc, char* argv[])
+Chunk Parse(const std::string_view data)
 {
-	if (argc < 3)
-		throw std::invalid_argument("usage:\nflistat.exe database_path statistics_path");
+	Chunk chunk;
+	chunk.size = data.size();
+	chunk.text.reserve(data.size() + 1);
+
+	const auto store = [&](const std::string_view value) {
+		const auto* result = chunk.text.data() + chunk.text.size();
+		chunk.text.insert(chunk.text.end(), value.begin(), value.end());
+		chunk.text.push_back('\0');
+		return result;
+	};
+
+	std::array<std::string_view, FIELD_COUNT> fields;
+	for (const auto lineRange : data | std::views::split('\n'))
+	{
+		std::string_view line(lineRange.begin(), lineRange.end());
+		if (line.ends_with('\r'))
+			line.remove_suffix(1);
+
+		if (line.empty() || line.starts_with('#'))
+			continue;
 
-	QFile inp(argv[2]);
+		size_t count = 0;
+		for (const auto field : line | std::views::split('|'))
+		{
+			if (count < FIELD_COUNT)
+				fields[count] = std::string_view(field.begin(), field.end());
+			++count;
+		}
+
+		if (count != FIELD_COUNT)
+		{
+			if (chunk.errorCount++ < 10)
+				PLOGE << "bad line: " << line;
+			continue;
+		}
+
+		chunk.rows.emplace_back(
+			store(fields[0]),
+			store(fields[1]),
+			store(fields[2]),
+			fields[3].empty() ? nullptr : store(fields[3]),
+			ToInt<int>(fields[4]).value_or(0),
+			ToInt<int>(fields[5], -1),
+			ToInt<long long>(fields[6]),
+			ToInt<int>(fields[7]),
+			ToInt<int>(fields[8]),
+			store(fields[9])
+		);
+	}
+
+	return chunk;
+}
+
+std::vector<std::string_view> Split(const std::string_view data)
+{
+	std::vector<std::string_view> result;
+	for (size_t pos = 0; pos < data.size();)
+	{
+		auto end = std::min(pos + CHUNK_SIZE, data.size());
+		if (const auto lineEnd = data.find('\n', end); end < data.size())
+			end = lineEnd == std::string_view::npos ? data.size() : lineEnd + 1;
+
+		result.emplace_back(data.substr(pos, end - pos));
+		pos = end;
+	}
+	return result;
+}
+
+class Writer
+{
+public:
+	Writer(DB::ITransaction& tr, const bool upsert)
+		: m_batchCommand { tr.CreateCommand(CreateInsertStatement(ROWS_PER_STATEMENT, upsert)) }
+		, m_command { tr.CreateCommand(CreateInsertStatement(1, upsert)) }
+	{
+	}
+
+public:
+	size_t Write(const std::vector<Row>& rows)
+	{
+		size_t errorCount = 0;
+
+		size_t index = 0;
+		for (; index + ROWS_PER_STATEMENT <= rows.size(); index += ROWS_PER_STATEMENT)
+		{
+			for (size_t n = 0; n < ROWS_PER_STATEMENT; ++n)
+				BindRow(*m_batchCommand, n * FIELD_COUNT, rows[index + n]);
+			if (m_batchCommand->Execute())
+				continue;
+
+			// a bad row fails the whole statement, the batch is inserted again row by row so only the bad rows are lost
+			for (size_t n = 0; n < ROWS_PER_STATEMENT; ++n)
+				errorCount += WriteRow(rows[index + n]);
+		}
+
+		for (; index < rows.size(); ++index)
+			errorCount += WriteRow(rows[index]);
+
+		return errorCount;
+	}
+
+private:
+	static std::string CreateInsertStatement(const size_t rowCount, const bool upsert)
+	{
+		std::string result = INSERT_PREFIX;
+		for (size_t n = 0; n < rowCount; ++n)
+			result.append(n ? ", " : "").append(INSERT_VALUES);
+		if (upsert)
+			result.append(UPSERT_SUFFIX);
+		return result;
+	}
+
+	size_t WriteRow(const Row& row)
+	{
+		BindRow(*m_command, 0, row);
+		if (m_command->Execute())
+			return 0;
+
+		if (m_errorCount++ < 10)
+			PLOGE << "cannot insert row: " << row.folder << '|' << row.fileName << '|' << row.imageId;
+		return 1;
+	}
+
+	static void BindRow(DB::ICommand& command, const size_t offset, const Row& row)
+	{
+		command.Bind(offset + 0, row.folder);
+		command.Bind(offset + 1, row.fileName);
+		command.Bind(offset + 2, row.imageId);
+		if (row.failInfo)
+			command.Bind(offset + 3, row.failInfo);
+		else
+			command.Bind(offset + 3);
+		command.Bind(offset + 4, row.isCover);
+		Bind(command, offset + 5, row.pixelType);
+		Bind(command, offset + 6, row.size);
+		Bind(command, offset + 7, row.width);
+		Bind(command, offset + 8, row.height);
+		command.Bind(offset + 9, row.hash);
+	}
+
+private:
+	std::unique_ptr<DB::ICommand> m_batchCommand;
+	std::unique_ptr<DB::ICommand> m_command;
+	size_t                        m_errorCount { 0 };
+};
+
+void Import(const char* dbPath, const char* statisticsPath)
+{
+	QFile inp(statisticsPath);
 	if (!inp.open(QIODevice::ReadOnly))
-		throw std::invalid_argument(std::format("cannot read {}", argv[1]));
+		throw std::invalid_argument(std::format("cannot read {}", statisticsPath));
+
+	const auto  totalSize = inp.size();
+	const auto* mapped    = totalSize > 0 ? inp.map(0, totalSize) : nullptr;
+	if (totalSize > 0 && !mapped)
+		throw std::ios_base::failure(std::format("cannot map {}", statisticsPath));
+
+	const std::string_view data(reinterpret_cast<const char*>(mapped), static_cast<size_t>(totalSize));
+
+	const auto isNew = !QFile::exists(dbPath);
+	const auto db    = CreateDatabase(dbPath);
+	for (const auto* pragma : isNew ? std::span<const char* const>(BULK_LOAD_PRAGMAS) : std::span<const char* const>(INCREMENTAL_PRAGMAS))
+		db->CreateQuery(pragma)->Execute();
+
+	const auto hasAggregates = HasObject(*db, "table", "FolderStat");
+	UpdateDatabaseSchema(*db);
+
+	const auto sourcePath = QFileInfo(inp).canonicalFilePath().toStdString();
+	const auto offset     = GetOffset(*db, sourcePath, data);
+	const auto lineEnd    = data.rfind('\n');
+	const auto end        = lineEnd == std::string_view::npos ? 0 : lineEnd + 1;
+	if (offset >= end && hasAggregates)
+	{
+		PLOGI << "nothing new in " << sourcePath;
+		return;
+	}
+
+	PLOGI << "importing " << sourcePath << " from offset " << offset;
+	const auto length = end > offset ? end - offset : 0;
+	const auto chunks = Split(data.substr(offset, length));
+	const auto upsert      = HasObject(*db, "index", UNIQUE_INDEX_NAME);
+	const auto fullRefresh = !upsert || !hasAggregates;
+	if (!fullRefresh)
+		for (const auto* command : TOUCH_TRACKING)
+			db->CreateQuery(command)->Execute();
+
+	const auto maxInFlight = std::max<size_t>(std::thread::hardware_concurrency(), 1) * 2;
+
+	std::deque<std::future<Chunk>> parsed;
+	auto                           nextChunk = chunks.cbegin();
+
+	const auto enqueue = [&] {
+		for (; nextChunk != chunks.cend() && parsed.size() < maxInFlight; ++nextChunk)
+			parsed.emplace_back(std::async(std::launch::async, &Parse, *nextChunk));
+	};
 
-	const auto totalSize = inp.size();
+	size_t rowCount   = 0;
+	size_t errorCount = 0;
+	size_t processed  = 0;
 
-	const auto db = CreateDatabase(argv[1]);
 	const auto tr = db->CreateTransaction();
 	{
-		const auto command = tr->CreateCommand(R"(INSERT INTO Image (Folder, FileName, ImageID, FailInfo, IsCover, PixelType, Size, Width, Height, Hash) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?))");
+		Writer writer(*tr, upsert);
 
 		long long percents = 0;
 
-		QTextStream stream(&inp);
-		QString     line;
-		size_t      counter = 0;
-		while (stream.readLineInto(&line))
+		for (enqueue(); !parsed.empty(); enqueue())
 		{
-			if (line.startsWith('#'))
-				continue;
+			const auto chunk = parsed.front().get();
+			parsed.pop_front();
 
-			const auto data = line.split('|');
-			if (data.size() != 10)
-			{
-				PLOGE << line;
-				assert(false && "bad line");
-				continue;
-			}
-			command->Bind(0, data[0].toStdString());
-			command->Bind(1, data[1].toStdString());
-			command->Bind(2, data[2].toStdString());
-			if (data[3].isEmpty())
-				command->Bind(3);
-			else
-				command->Bind(3, data[3].toStdString());
-			command->Bind(4, data[4].toInt());
-			Bind(*command, 5, data[5], qOverload<bool*, int>(&QString::toInt), -1);
-			Bind(*command, 6, data[6], qOverload<bool*, int>(&QString::toLongLong));
-			Bind(*command, 7, data[7], qOverload<bool*, int>(&QString::toInt));
-			Bind(*command, 8, data[8], qOverload<bool*, int>(&QString::toInt));
-			command->Bind(9, data[9].toStdString());
-			if (!command->Execute())
-			{
-				PLOGE << "error line: " << counter;
-			}
-			++counter;
+			errorCount += chunk.errorCount + writer.Write(chunk.rows);
+			rowCount += chunk.rows.size();
+			processed += chunk.size;
 
-			const auto position        = inp.pos();
-			const auto currentPercents = 100LL * position / totalSize;
+			const auto currentPercents = 100LL * static_cast<long long>(processed) / static_cast<long long>(std::max<size_t>(length, 1));
 			if (percents == currentPercents)
 				continue;
 
 			percents = currentPercents;
-			PLOGV << counter << " rows inserted " << percents << "%";
+			PLOGV << rowCount << " rows inserted " << percents << "%";
 		}
 	}
+
+	if (!upsert)
+	{
+		PLOGI << "removing duplicates";
+		tr->CreateCommand(DEDUPLICATE)->Execute();
+	}
+
+	PLOGI << "creating indices";
+	for (const auto* command : INDICES)
+		tr->CreateCommand(command)->Execute();
+
+	PLOGI << (fullRefresh ? "rebuilding" : "updating") << " aggregates";
+	RefreshAggregates(*tr, fullRefresh);
+
+	{
+		const auto command = tr->CreateCommand(UPDATE_SOURCE);
+		command->Bind(0, sourcePath);
+		command->Bind(1, static_cast<long long>(end));
+		command->Bind(2, GetHead(data.substr(0, end)));
+		command->Execute();
+	}
+
 	tr->Commit();
+
+	PLOGI << rowCount << " rows inserted, errors: " << errorCount;
+}
+
+void Report(const char* dbPath)
+{
+	if (!QFile::exists(dbPath))
+		throw std::invalid_argument(std::format("{} not found", dbPath));
+
+	const auto db = CreateDatabase(dbPath);
+	if (!HasObject(*db, "table", "FolderStat"))
+		throw std::invalid_argument("database has no aggregates, import statistics first");
+
+	const auto print = [&](const std::string_view title, const std::string_view sql, const size_t columnCount) {
+		PLOGI << title;
+		const auto query = db->CreateQuery(sql.data());
+		for (query->Execute(); !query->Eof(); query->Next())
+		{
+			std::string line;
+			for (size_t i = 0; i < columnCount; ++i)
+			{
+				const auto* value = query->Get<const char*>(i);
+				line.append(i ? "\t" : "    ").append(value ? value : "");
+			}
+			PLOGI << line;
+		}
+	};
+
+	print("total: images, covers, fails, bytes", "SELECT sum(ImageCount), sum(CoverCount), sum(FailCount), sum(TotalSize) FROM FolderStat", 4);
+	print("folders: folder, images, covers, fails, bytes", "SELECT Folder, ImageCount, CoverCount, FailCount, TotalSize FROM FolderStat ORDER BY Folder", 5);
+	print("dimensions: max side from, images", "SELECT Bucket, sum(ImageCount) FROM FolderDimension GROUP BY Bucket ORDER BY Bucket", 2);
+	print("sizes: bytes from, images", "SELECT Bucket, sum(ImageCount) FROM FolderSize GROUP BY Bucket ORDER BY Bucket", 2);
+	print("fails: type, images", "SELECT FailInfo, sum(ImageCount) FROM FolderFail GROUP BY FailInfo ORDER BY 2 DESC", 2);
+	print("duplicates: hashes, images, redundant bytes",
+	      "SELECT count(*), coalesce(sum(ImageCount), 0), coalesce(sum(TotalSize - TotalSize / ImageCount), 0) FROM HashStat WHERE ImageCount > 1",
+	      3);
+	print("top duplicates: hash, images, bytes", "SELECT Hash, ImageCount, TotalSize FROM HashStat WHERE ImageCount > 1 ORDER BY ImageCount DESC, TotalSize DESC LIMIT 20", 3);
+}
+
+void go(const int argc, char* argv[])
+{
+	if (argc == 3 && std::string_view(argv[1]) == "report")
+		return Report(argv[2]);
+
+	if (argc < 3)
+		throw std::invalid_argument("usage:\nflistat.exe database_path statistics_path\nflistat.exe report database_path");
+
+	Import(argv[1], argv[2]);
 }
 
 } // namespace
 
 int main(const int argc, char* argv[])
 {
-	Log::LoggingInitializer                          logging(QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID));
-	plog::ConsoleAppender<Util::LogConsoleFormatter> consoleAppender;
-	Log::LogAppender                                 logConsoleAppender(&consoleAppender);
+	FliLib::AsyncLoggingInitializer<Util::LogConsoleFormatter> logging(QString("%1/%2.%3.log").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), COMPANY_ID, APP_ID));
+	FliLib::ResourceReporter                                   resources(QString {});
 
 	try
 	{